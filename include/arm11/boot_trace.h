@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BOOT_TRACE_PATH      "boottrace.log"     // Relative to work dir.
+#define BOOT_TRACE_OLD_PATH  "boottrace.old.log" // Previous log after rolling over.
+#define BOOT_TRACE_MAX_LOG   (1024u * 16)        // Roll over when bigger.
+#define BOOT_TRACE_PHASES    (24u)              // Extra marks are dropped.
+
+
+
+/**
+ * @brief      Marks the end of a boot phase. The phase started at the previous mark
+ *             (or perfInit()). Cheap enough to always be called.
+ *
+ * @param[in]  phase  The phase name. Must be a string literal.
+ * @param[in]  bytes  The number of bytes processed in this phase or 0.
+ */
+void bootTraceMark(const char *const phase, const u32 bytes);
+
+/**
+ * @brief      Appends the recorded phases to the boot trace log and prints
+ *             a summary if enabled in the config. Later marks are ignored.
+ */
+void bootTraceFinish(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Keep in sync with tools/borderConv.
+#define BORDER_MAGIC       (0x4442414Fu) // "OABD"
+#define BORDER_VERSION     (2u)
+#define BORDER_WIDTH       (240u)        // Rotated like the frame buffer.
+#define BORDER_HEIGHT      (400u)
+#define BORDER_SIZE        (BORDER_WIDTH * BORDER_HEIGHT * 3)
+#define BORDER_MAX_SLOT    (9u)
+
+// Run-length coded BGR8 pixels in frame buffer layout (same as border.bgr).
+// Control byte bit 7 set: (ctrl & 0x7F) + 1 copies of the following pixel.
+// Bit 7 clear: ctrl + 1 literal pixels follow.
+#define BORDER_FMT_RLE_BGR8  (0u)
+
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 format;   // BORDER_FMT_*.
+	u32 dataSize; // Compressed size following the header.
+} BorderHeader;
+static_assert(sizeof(BorderHeader) == 12, "Error: Border header struct is not packed!");
+
+
+
+/**
+ * @brief      Loads border.oab (slot 0) or borderN.oab to the GPU render buffer.
+ *             Falls back to the raw border.bgr/borderN.bgr if there is no .oab file.
+ *             Nothing is loaded if neither exists. The render buffer is cleared on errors.
+ *
+ * @param[in]  slot          The border slot (0-9). Out of range slots use slot 0.
+ * @param[in]  displayGamma  The display gamma from the color profile or 0 for none.
+ */
+void loadBorder(const u8 slot, const float displayGamma);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -30,6 +30,15 @@ extern "C"
 #define OAF_WORK_DIR        "sdmc:/3ds/open_agb_firm"
 #define OAF_SAVE_DIR        "saves"       // Relative to work dir.
 #define OAF_SCREENSHOT_DIR  "screenshots" // Relative to work dir.
+#define OAF_CACHE_DIR       "cache"       // Relative to work dir.
+
+// colorProfile flags. Converts with small per channel tables instead of the 3D LUT
+// or in the GPU without core 1.
+#define COLOR_PROFILE_SEPARABLE  (0x80u)
+#define COLOR_PROFILE_GPU        (0x40u)
+
+// Max number of options in one (per-game) config. At least the number of options.
+#define CFG_MAX_VALUES  (48u)
 
 
 typedef struct
@@ -47,6 +56,9 @@ typedef struct
 	float contrast;
 	float brightness;
 	u8 colorProfile;    // 0 = none, 1 = GBA, 2 = DS phat, 3 = DS phat white.
+	                    // Can be ORed with COLOR_PROFILE_SEPARABLE or COLOR_PROFILE_GPU.
+	u8 framePacing;     // 0 = lowest latency, 1 = smooth, 2 = sync LCD to GBA.
+	u8 border;          // 0 = border.oab/.bgr, 1-9 = borderN.oab/.bgr.
 
 	// [audio]
 	u8 audioOut;        // 0 = auto, 1 = speakers, 2 = headphones.
@@ -63,15 +75,46 @@ typedef struct
 	// [advanced]
 	bool saveOverride;
 	u16 defaultSave;
+	bool patchCache;    // Keep patched ROMs in the cache dir.
+	bool bootTrace;     // Log boot phase timings.
+	u16 inputRate;      // Button sampling rate in Hz. 0 = once per frame.
+	bool profileStore;  // Per-game configs from profiles.bin instead of saves/*.ini.
+	u8 n3dsBoost;       // Non-zero = 804 MHz on New 3DS while loading.
 } OafConfig;
 //static_assert(sizeof(OafConfig) == 76, "nope");
 
+// Parsed config options without the names. Used for per-game configs.
+typedef struct
+{
+	u8 num;
+	u8 keys[CFG_MAX_VALUES];   // Option index. Never changes for an option.
+	u32 values[CFG_MAX_VALUES];
+} OafConfigValues;
+
 extern OafConfig g_oafConfig;
 
 
 
 Result parseOafConfig(const char *const path, OafConfig *cfg, const bool newCfgOnError);
 
+/**
+ * @brief      Parses a config file without applying it.
+ *
+ * @param[in]  path    The config file path.
+ * @param      values  The parsed options output.
+ *
+ * @return     Returns the result.
+ */
+Result parseOafConfigValues(const char *const path, OafConfigValues *const values);
+
+/**
+ * @brief      Applies parsed config options.
+ *
+ * @param      cfg     The config to change.
+ * @param[in]  values  The options (parseOafConfigValues()).
+ */
+void applyOafConfigValues(OafConfig *const cfg, const OafConfigValues *const values);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
\ No newline at end of file
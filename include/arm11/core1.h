@@ -0,0 +1,70 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef void (*Core1Job)(void *arg);
+
+
+
+/**
+ * @brief      Boots core 1 into the job loop. Call once at boot.
+ */
+void core1Init(void);
+
+/**
+ * @brief      Runs a job on core 1. Waits for the previous job first.
+ *             Runs the job on the calling core if core 1 is not available.
+ *             Job results must only be read after core1Wait().
+ *
+ * @param[in]  job   The job function.
+ * @param      arg   The job argument.
+ */
+void core1Submit(Core1Job job, void *arg);
+
+/**
+ * @brief      Checks if core 1 is still working on a job.
+ *
+ * @return     Returns true if busy.
+ */
+bool core1Busy(void);
+
+/**
+ * @brief      Waits until core 1 has finished the current job.
+ */
+void core1Wait(void);
+
+/**
+ * @brief      Hands core 1 over to a function that never returns.
+ *             No more jobs can be submitted afterwards.
+ *
+ * @param[in]  entry  The entry function.
+ */
+void core1Handover(void (*entry)(void));
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -18,6 +18,7 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "types.h"
 
 
 #ifdef __cplusplus
@@ -25,9 +26,19 @@ extern "C"
 {
 #endif
 
+// Convert with the 3D LUT.
 void convert160pFrameFast(void);
 void convert240pFrameFast(void);
 
+// Convert with the separable tables (per channel gamma, matrix and display gamma).
+void convert160pFrameSep(void);
+void convert240pFrameSep(void);
+
+#ifndef NDEBUG
+// Core 1 conversion timing. [0] = start ticks, [1] = duration of the last frame.
+extern vu32 g_convTicks[2];
+#endif
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
\ No newline at end of file
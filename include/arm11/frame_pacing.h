@@ -0,0 +1,86 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// [video] framePacing values.
+#define PACING_LOW_LATENCY  (0u) // Present as soon as possible. GBA and LCD drift freely.
+#define PACING_SMOOTH       (1u) // Wait for VBlank when a present would race the buffer latch.
+#define PACING_LCD_SYNC     (2u) // Stretch LCD frames by 1 line when needed to lock to the GBA.
+
+// PDC0 (top LCD) timing registers.
+#define PDC0_REGS_BASE      (0x10400400u)
+#define REG_PDC0_V_TOTAL    *((vu32*)(PDC0_REGS_BASE + 0x24))
+#define REG_PDC0_V_COUNT    *((vu32*)(PDC0_REGS_BASE + 0x54))
+
+
+typedef struct
+{
+	u16 phase;     // LCD lines from VBlank to the last GBA frame.
+	u16 minPhase;  // Since the last reset.
+	u16 maxPhase;
+	u16 lines;     // LCD lines per frame.
+	u16 target;    // Locked phase for PACING_LCD_SYNC.
+	u16 stretched; // Frames with an extra line since the last reset.
+	u32 frames;    // Frames since the last reset.
+} FramePacingStats;
+
+
+
+/**
+ * @brief      Calibrates the VBlank line and selects the policy.
+ *             Must be called before the first GBA frame.
+ *
+ * @param[in]  policy  The PACING_* policy.
+ */
+void framePacingInit(const u8 policy);
+
+/**
+ * @brief      Measures the phase of a new GBA frame. Call as soon as
+ *             the frame is ready. May wait for VBlank depending on policy.
+ */
+void framePacingFrameReady(void);
+
+/**
+ * @brief      Returns the phase measurements.
+ *
+ * @return     The frame pacing stats.
+ */
+const FramePacingStats* framePacingGetStats(void);
+
+/**
+ * @brief      Resets the min/max phase and counters.
+ */
+void framePacingResetStats(void);
+
+/**
+ * @brief      Restores the original LCD timing.
+ */
+void framePacingExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
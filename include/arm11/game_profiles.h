@@ -0,0 +1,62 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/config.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define GAME_PROFILES_PATH  "profiles.bin" // Relative to work dir.
+#define GAME_PROFILES_MAX   (4096u)
+
+
+typedef struct
+{
+	u64 nameHash;           // 64 bit FNV-1a over the per-game config file name.
+	OafConfigValues values; // 0 values = game has no config file.
+} GameProfile;
+static_assert(sizeof(GameProfile) == 256, "Error: Game profile struct is not packed!");
+
+
+
+/**
+ * @brief      Applies the per-game config from profiles.bin.
+ *             If the game has no profile yet (or reimport is set)
+ *             cfgPath is parsed and stored as the new profile.
+ *             Games without config file get an empty profile so
+ *             the saves dir is not searched again on the next launch.
+ *
+ * @param[in]  cfgPath   The per-game config path (saves/romName.ini).
+ * @param      cfg       The config to change.
+ * @param[in]  reimport  Ignore the stored profile and parse cfgPath again.
+ *
+ * @return     Returns RES_FR_NO_FILE if the game has no per-game config.
+ */
+Result loadGameProfile(const char *const cfgPath, OafConfig *const cfg, const bool reimport);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -29,16 +29,44 @@ extern "C"
 #define GPU_RENDER_BUF_ADDR  (0x18180000)
 #define GPU_TEXTURE_ADDR     (0x18200000)
 #define GPU_TEXTURE2_ADDR    (0x18300000)
-#define GBA_INIT_LIST_SIZE   (1136)
-#define GBA_LIST2_SIZE       (448)
+#define GPU_INIT_LIST_MAX    (1152)       // In bytes.
+#define GPU_FRAME_LIST_MAX   (256)        // In bytes.
 
 
-extern u8 gbaGpuInitList[GBA_INIT_LIST_SIZE];
-extern u8 gbaGpuList2[GBA_LIST2_SIZE];
+typedef struct
+{
+	u32 size;                             // In bytes. Multiple of 16.
+	alignas(16) u32 cmd[GPU_INIT_LIST_MAX / 4];
+} GpuInitList;
+
+typedef struct
+{
+	u32 size;                             // In bytes. Multiple of 16.
+	alignas(16) u32 cmd[GPU_FRAME_LIST_MAX / 4];
+} GpuFrameList;
+
+// Color correction in the texture combiners. Output gamma is applied by the LCD color LUT.
+typedef struct
+{
+	u32 columns[3];                       // Matrix columns for input r, g, b as RGBA8 (red in the low byte).
+	bool gamma25;                         // Linearize with ~2.5 gamma instead of 2.0.
+} GpuColorCorrection;
+
+extern GpuInitList gbaGpuInitList;
+extern GpuFrameList gbaGpuFrameList;
 
 
 
-void patchGbaGpuCmdList(const u8 scaleType, const bool useSecondTexture);
+/**
+ * @brief      Builds the command lists for a scaler mode.
+ *             The init list sets up all GPU state and draws the first frame.
+ *             The frame list only draws and relies on the state from the init list.
+ *
+ * @param[in]  scaleType         The scaler (config scaler value).
+ * @param[in]  useSecondTexture  Use the RGBA8 texture written by core 1 color conversion.
+ * @param[in]  cc                Color correction in the GPU or NULL.
+ */
+void makeGbaGpuCmdLists(const u8 scaleType, const bool useSecondTexture, const GpuColorCorrection *const cc);
 
 #ifdef __cplusplus
 } // extern "C"
@@ -0,0 +1,56 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define OAF_INPUT_MAX_RATE  (4000u) // Hz.
+
+
+
+/**
+ * @brief      Sets up the GBA button overrides from buttonMaps.
+ *             With a non-zero rate a timer task feeds the overridden
+ *             buttons to the GBA independently of the frame rate.
+ *
+ * @param[in]  buttonMaps  The button maps (A, B, Select, Start, Right, Left, Up, Down, R, L).
+ * @param[in]  rate        The sampling rate in Hz. 0 = once per frame in OAF_inputUpdate().
+ */
+void OAF_inputInit(const u32 buttonMaps[10], u16 rate);
+
+/**
+ * @brief      Per frame input update. Must be called after hidScanInput().
+ *             Extra buttons (ZL/ZR, circle pad ect.) are only sampled here.
+ */
+void OAF_inputUpdate(void);
+
+/**
+ * @brief      Stops the input task if running.
+ */
+void OAF_inputExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
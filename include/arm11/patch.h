@@ -25,6 +25,30 @@ extern "C"
 {
 #endif
 
+#define NUM_PATCH_TYPES  (3u) // IPS, UPS and BPS.
+
+
+typedef struct
+{
+	u32 size;
+	u16 fdate;  // FILINFO timestamp of the patch file.
+	u16 ftime;
+	u8 type;    // 0 = IPS, 1 = UPS, 2 = BPS.
+} PatchFileInfo;
+
+
+
+/**
+ * @brief      Looks for a patch file next to the ROM without applying it.
+ *             Returns false if X is held like patchRom() does.
+ *
+ * @param[in]  gamePath  The ROM path.
+ * @param      info      The patch file info output.
+ *
+ * @return     Returns true if a patch file was found.
+ */
+bool findRomPatch(const char *const gamePath, PatchFileInfo *const info);
+
 Result patchRom(const char *const gamePath, u32 *romSize);
 
 #ifdef __cplusplus
@@ -0,0 +1,75 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+#include "arm11/patch.h"
+#include "arm11/config.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define PATCH_CACHE_DIR       OAF_CACHE_DIR
+#define PATCH_CACHE_PATH_LEN  (64u)
+
+
+
+/**
+ * @brief      Builds the path of the cached patched ROM for a base ROM and patch file.
+ *             The key is encoded in the file name so no header is needed.
+ *
+ * @param[in]  sha1   The SHA1 of the unpatched ROM (RomInfo).
+ * @param[in]  patch  The patch file info.
+ * @param      path   The cache file path output.
+ *
+ * @return     Returns true if the cache file exists.
+ */
+bool patchCacheFind(const u32 sha1[5], const PatchFileInfo *const patch, char path[PATCH_CACHE_PATH_LEN]);
+
+/**
+ * @brief      Remembers the patched ROM at LGY_ROM_LOC for writing to the cache.
+ *             Nothing is written until patchCacheStart().
+ *
+ * @param[in]  sha1     The SHA1 of the unpatched ROM (RomInfo).
+ * @param[in]  patch    The patch file info.
+ * @param[in]  romSize  The patched ROM size. Mirroring not included.
+ */
+void patchCacheQueue(const u32 sha1[5], const PatchFileInfo *const patch, const u32 romSize);
+
+/**
+ * @brief      Writes the queued ROM to the cache from a low priority task.
+ *             Older cache files for the same base ROM are removed.
+ *             Call after GBA mode started so the write doesn't delay booting.
+ *             Does nothing if nothing was queued.
+ */
+void patchCacheStart(void);
+
+/**
+ * @brief      Stops an unfinished cache write and waits for the task.
+ *             An interrupted write leaves no cache file behind.
+ */
+void patchCacheExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,165 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "mem_map.h"
+#include "error_codes.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// The MPCore watchdog (in timer mode) is used as free running tick counter.
+// It's private to each core. Ticks from different cores can't be compared.
+#define PERF_TICK_FREQ      (268111856u / 2) // 134.055928 MHz.
+#define PERF_WDT_LOAD       *((vu32*)(MPCORE_PRIV_BASE + 0x620))
+#define PERF_WDT_COUNTER    *((vu32*)(MPCORE_PRIV_BASE + 0x624))
+#define PERF_WDT_CNT        *((vu32*)(MPCORE_PRIV_BASE + 0x628))
+
+#define PERF_TICKS2US(t)    ((u32)(((u64)(t) * 1000000u) / PERF_TICK_FREQ))
+
+
+// Tracepoints for debug builds. They compile to nothing with NDEBUG.
+// Usage:
+// PERF_VAR(t);
+// PERF_START(t); work(); PERF_STOP(t); // Can be repeated to accumulate.
+// PERF_PRINT("work", t);
+#ifndef NDEBUG
+#define PERF_VAR(v)         u32 v = 0
+#define PERF_START(v)       (v) -= perfGetTicks()
+#define PERF_STOP(v)        (v) += perfGetTicks()
+#define PERF_PRINT(name, v) perfPrint((name), (v))
+#else
+#define PERF_VAR(v)
+#define PERF_START(v)       ((void)0)
+#define PERF_STOP(v)        ((void)0)
+#define PERF_PRINT(name, v) ((void)0)
+#endif // #ifndef NDEBUG
+
+// Per-frame stages recorded into a ring buffer (debug builds only).
+enum
+{
+	PERF_FRAME_INTERVAL = 0u, // Frame ready to frame ready.
+	PERF_FRAME_CONVERT  = 1u, // Color conversion on core 1 (written to its own slot).
+	PERF_FRAME_PACING   = 2u, // Frame pacing wait.
+	PERF_FRAME_P3D      = 3u, // GPU rendering.
+	PERF_FRAME_PPF      = 4u, // Transfer to the frame buffer.
+	PERF_FRAME_TOTAL    = 5u, // Frame ready to swap.
+	PERF_FRAME_STAGES   = 6u
+};
+
+#define PERF_RING_SIZE      (256u) // Frames. Power of 2.
+
+// Usage:
+// PERF_FRAME_BEGIN(); wait(); PERF_FRAME_MARK(PERF_FRAME_PACING); render(); PERF_FRAME_MARK(PERF_FRAME_P3D);
+// PERF_FRAME_SET(PERF_FRAME_CONVERT, core1Ticks); PERF_FRAME_END();
+#ifndef NDEBUG
+#define PERF_FRAME_BEGIN()         perfFrameBegin()
+#define PERF_FRAME_MARK(stage)     perfFrameMark(stage)
+#define PERF_FRAME_SET(stage, t)   perfFrameSet((stage), (t))
+#define PERF_FRAME_END()           perfFrameEnd()
+#else
+#define PERF_FRAME_BEGIN()         ((void)0)
+#define PERF_FRAME_MARK(stage)     ((void)0)
+#define PERF_FRAME_SET(stage, t)   ((void)0)
+#define PERF_FRAME_END()           ((void)0)
+#endif // #ifndef NDEBUG
+
+
+
+/**
+ * @brief      Starts the tick counter on the current core. Wraps after ~32 seconds.
+ */
+void perfInit(void);
+
+/**
+ * @brief      Keeps the tick frequency at PERF_TICK_FREQ on the current core
+ *             after a CPU clock change. The MPCore timers run at half the CPU clock.
+ *
+ * @param[in]  clockMul  The CPU clock multiplier (1 = 268 MHz, 3 = 804 MHz).
+ */
+void perfSetClockMul(const u32 clockMul);
+
+/**
+ * @brief      Prints a tracepoint in microseconds.
+ *
+ * @param[in]  name   The tracepoint name.
+ * @param[in]  ticks  The ticks.
+ */
+void perfPrint(const char *const name, const u32 ticks);
+
+#ifndef NDEBUG
+/**
+ * @brief      Starts a new frame record. Only call from a single task.
+ */
+void perfFrameBegin(void);
+
+/**
+ * @brief      Sets the ticks since the last mark (or begin) for a stage.
+ *
+ * @param[in]  stage  The PERF_FRAME_* stage.
+ */
+void perfFrameMark(const u8 stage);
+
+/**
+ * @brief      Sets the ticks for a stage measured elsewhere (for example on core 1).
+ *
+ * @param[in]  stage  The PERF_FRAME_* stage.
+ * @param[in]  ticks  The ticks.
+ */
+void perfFrameSet(const u8 stage, const u32 ticks);
+
+/**
+ * @brief      Finishes the frame record and makes it visible to the overlay and dumps.
+ */
+void perfFrameEnd(void);
+
+/**
+ * @brief      Draws min/avg/max of the recorded frames on the console.
+ *             Rate limited internally so it can be called every frame.
+ */
+void perfOverlayUpdate(void);
+
+/**
+ * @brief      Writes the recorded frames as CSV (µs).
+ *
+ * @param[in]  path  The file path.
+ *
+ * @return     Returns the result.
+ */
+Result perfDumpCsv(const char *const path);
+#endif // #ifndef NDEBUG
+
+/**
+ * @brief      Returns the current tick count. Counts up.
+ *
+ * @return     The tick count.
+ */
+static inline u32 perfGetTicks(void)
+{
+	// The watchdog counts down.
+	return -PERF_WDT_COUNTER;
+}
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
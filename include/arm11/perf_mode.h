@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief      Raises the CPU clock to 804 MHz on New 3DS. Does nothing on Old 3DS.
+ *             Core 1 must still be in the job loop (before core1Handover()).
+ */
+void perfModeEnter(void);
+
+/**
+ * @brief      Restores the CPU clock from before perfModeEnter().
+ *             Must be called before core 1 is handed over. Can be called more than once.
+ *             Timers with a fixed prescaler run 3 times faster until then.
+ */
+void perfModeExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <assert.h>
+#include "types.h"
+#include "arm11/rom_loader.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ROM_CACHE_PATH     "romcache.bin" // Relative to work dir.
+#define ROM_CACHE_ENTRIES  (32u)
+
+
+typedef struct
+{
+	u32 pathHash;    // FNV-1a over the ROM path.
+	u32 fileSize;
+	u16 fdate;       // FILINFO timestamp of the ROM file.
+	u16 ftime;
+	u32 sha1[5];
+	u32 dbAttr;
+	u16 sdkSaveType;
+	u8 flags;        // RomInfo flags.
+	u8 reserved;
+} RomCacheEntry;
+static_assert(sizeof(RomCacheEntry) == 40, "Error: ROM cache entry struct is not packed!");
+
+
+
+/**
+ * @brief      Looks up ROM metadata from previous launches.
+ *             info is always initialized. On a miss info->flags is 0.
+ *
+ * @param[in]  romPath  The ROM path.
+ * @param      info     The ROM info output.
+ *
+ * @return     Returns true on cache hit.
+ */
+bool romCacheLookup(const char *const romPath, RomInfo *const info);
+
+/**
+ * @brief      Stores new or changed ROM metadata as newest entry.
+ *             The oldest entry is dropped when the cache is full.
+ *             Should only be called with info for the unpatched ROM.
+ *
+ * @param[in]  romPath  The ROM path.
+ * @param[in]  info     The ROM info.
+ */
+void romCacheUpdate(const char *const romPath, const RomInfo *const info);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "error_codes.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Work done on each chunk while the next one is read.
+#define ROM_LOAD_HASH  (1u)    // SHA1 over the padded (unmirrored) ROM.
+#define ROM_LOAD_SCAN  (1u<<1) // Search for SDK save strings.
+
+// Set by getSaveType().
+#define ROM_INFO_DB       (1u<<2) // gba_db.bin has been searched.
+#define ROM_INFO_DB_FOUND (1u<<3) // ROM found in gba_db.bin. dbAttr is valid.
+
+
+typedef struct
+{
+	u32 romSize;     // Padded size. Power of 2 and at least 1 MiB. Mirroring not included.
+	u32 sha1[5];     // Big endian. Only valid with ROM_LOAD_HASH.
+	u16 sdkSaveType; // Save type from SDK string or 0xFF if none found. Only valid with ROM_LOAD_SCAN.
+	u8 flags;        // ROM_LOAD_* work and ROM_INFO_* lookups that have been done.
+	u32 dbAttr;      // gba_db.bin attributes. Only valid with ROM_INFO_DB_FOUND.
+} RomInfo;
+
+
+
+/**
+ * @brief      Loads a GBA ROM to LGY_ROM_LOC and fixes up padding/mirroring.
+ *             Hashing and save string scanning are overlapped with the SD reads.
+ *             info must be initialized by the caller (for example from the
+ *             ROM cache). Only romSize and the fields for loadFlags are written.
+ *
+ * @param[in]  path       The ROM path.
+ * @param[in]  loadFlags  ROM_LOAD_* flags.
+ * @param      info       Output ROM info.
+ *
+ * @return     Returns the result.
+ */
+Result loadGbaRom(const char *const path, const u8 loadFlags, RomInfo *const info);
+
+/**
+ * @brief      Waits for the open bus padding after the ROM (done on core 1)
+ *             and the 8 Mbit ROM mirrors (copied by the GPU).
+ *             Must be called before writing to the ROM area again or
+ *             before handing the ROM to the GBA hardware.
+ */
+void waitForRomPadding(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -21,6 +21,7 @@
 #include <assert.h>
 #include "types.h"
 #include "arm11/config.h"
+#include "arm11/rom_loader.h"
 
 
 #ifdef __cplusplus
@@ -28,18 +29,35 @@ extern "C"
 {
 #endif
 
+#define GBA_DB_MAGIC    (0x4244414Fu) // "OADB"
+#define GBA_DB_VERSION  (5u)
+#define GBA_DB_FANOUT   (256u)        // Buckets indexed by sha1[7] (top byte of the little endian u64).
+
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 entrySize;
+	u32 numEntries;
+	u32 reserved;
+	u32 fanout[GBA_DB_FANOUT + 1];    // First entry index of each bucket. Last is numEntries.
+} GbaDbHeader;
+static_assert(sizeof(GbaDbHeader) == 16 + 4 * (GBA_DB_FANOUT + 1), "Error: GBA DB header struct is not packed!");
+
 typedef struct
 {
-	u8 sha1[20];
+	u8 sha1[8];                       // Only the first 8 bytes of the SHA1.
 	char serial[4];
 	u32 attr;
 } GbaDbEntry;
-static_assert(sizeof(GbaDbEntry) == 28, "Error: GBA DB entry struct is not packed!");
+static_assert(sizeof(GbaDbEntry) == 16, "Error: GBA DB entry struct is not packed!");
 
 
 
-u16 detectSaveType(const u32 romSize, const u16 defaultSave);
-u16 getSaveType(const OafConfig *const cfg, const u32 romSize, const char *const savePath);
+u16 scanSdkSaveType(const u32 *romPtr, const u32 *const romEnd, const u32 romSize);
+u16 detectSaveType(const u16 sdkSaveType, const u16 defaultSave);
+u16 getSaveType(const OafConfig *const cfg, RomInfo *const romInfo, const char *const savePath);
 
 #ifdef __cplusplus
 } // extern "C"
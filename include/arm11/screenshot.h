@@ -0,0 +1,63 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define SCREENSHOT_W             (240u)
+#define SCREENSHOT_H             (160u)
+#define SCREENSHOT_SLOTS         (16u)  // Staging buffers. Limits burst length.
+#define SCREENSHOT_BURST_FRAMES  (15u)  // Frames between burst shots while the combo is held.
+
+
+
+/**
+ * @brief      Prepares the staging buffers and starts the writer task.
+ */
+void screenshotInit(void);
+
+/**
+ * @brief      Returns the pixel destination (A1BGR5, 240x160) of the next free staging buffer.
+ *             The buffer is clean in the data cache so it can be written by PPF.
+ *
+ * @return     The pixel destination or NULL if all buffers are waiting to be written.
+ */
+u32* screenshotAcquire(void);
+
+/**
+ * @brief      Hands the buffer returned by screenshotAcquire() to the writer task.
+ *             Never waits for SD I/O.
+ */
+void screenshotQueue(void);
+
+/**
+ * @brief      Waits for all queued screenshots to be written and stops the writer task.
+ */
+void screenshotExit(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
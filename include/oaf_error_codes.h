@@ -34,8 +34,11 @@ enum
 	// Custom errors.
 	RES_ROM_TOO_BIG            = MAKE_CUSTOM_ERR(0u),
 	RES_INVALID_PATCH          = MAKE_CUSTOM_ERR(1u),
+	RES_INVALID_GBA_DB         = MAKE_CUSTOM_ERR(2u),
+	RES_PATCH_CORRUPT          = MAKE_CUSTOM_ERR(3u),
+	RES_INVALID_BORDER         = MAKE_CUSTOM_ERR(4u),
 
-	MAX_OAF_RES_VALUE          = RES_ROM_TOO_BIG
+	MAX_OAF_RES_VALUE          = RES_INVALID_BORDER
 };
 
 #undef MAKE_CUSTOM_ERR
@@ -0,0 +1,118 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "types.h"
+#include "arm11/boot_trace.h"
+#include "arm11/perf.h"
+#include "arm11/config.h"
+#include "arm11/drivers/mcu.h"
+#include "arm11/fmt.h"
+#include "fs.h"
+
+
+#define LOG_LINE_MAX  (64u)
+
+
+typedef struct
+{
+	const char *phase;
+	u32 ticks;         // Duration.
+	u32 bytes;
+} BootPhase;
+
+static BootPhase g_phases[BOOT_TRACE_PHASES];
+static u32 g_numPhases = 0;
+static u32 g_lastMark = 0; // perfGetTicks() starts counting at perfInit().
+static bool g_finished = false;
+
+
+
+void bootTraceMark(const char *const phase, const u32 bytes)
+{
+	// The ticks wrap after ~32 s. Only a problem for phases waiting on the user.
+	const u32 now = perfGetTicks();
+	if(!g_finished && g_numPhases < BOOT_TRACE_PHASES)
+		g_phases[g_numPhases++] = (BootPhase){phase, now - g_lastMark, bytes};
+	g_lastMark = now;
+}
+
+static Result writeLog(void)
+{
+	// Keep the log small. The previous one is kept as old log.
+	FILINFO fi;
+	if(fStat(BOOT_TRACE_PATH, &fi) == RES_OK && fi.fsize > BOOT_TRACE_MAX_LOG)
+	{
+		fUnlink(BOOT_TRACE_OLD_PATH);
+		fRename(BOOT_TRACE_PATH, BOOT_TRACE_OLD_PATH);
+	}
+
+	char *const buf = (char*)malloc(LOG_LINE_MAX * (BOOT_TRACE_PHASES + 3));
+	if(buf == NULL) return RES_OUT_OF_MEM;
+
+	RtcTimeDate td;
+	MCU_getRtcTimeDate(&td);
+	u32 len = ee_sprintf(buf, "boot %04X-%02X-%02X %02X:%02X:%02X\nphase,us,bytes\n",
+	                     td.year + 0x2000, td.mon, td.day, td.hour, td.min, td.sec);
+	u32 total = 0;
+	for(u32 i = 0; i < g_numPhases; i++)
+	{
+		const BootPhase *const p = &g_phases[i];
+		len += ee_snprintf(&buf[len], LOG_LINE_MAX, "%s,%" PRIu32 ",%" PRIu32 "\n",
+		                   p->phase, PERF_TICKS2US(p->ticks), p->bytes);
+		total += PERF_TICKS2US(p->ticks);
+	}
+	len += ee_sprintf(&buf[len], "total,%" PRIu32 ",0\n\n", total);
+
+	FHandle f;
+	Result res = fOpen(&f, BOOT_TRACE_PATH, FA_OPEN_APPEND | FA_WRITE);
+	if(res == RES_OK)
+	{
+		u32 written;
+		res = fWrite(f, buf, len, &written);
+		fClose(f);
+	}
+	free(buf);
+
+	return res;
+}
+
+static void printSummary(void)
+{
+	u32 total = 0;
+	ee_printf("\x1b[2J\x1b[1;1HBoot trace (ms)\n");
+	for(u32 i = 0; i < g_numPhases; i++)
+	{
+		const u32 us = PERF_TICKS2US(g_phases[i].ticks);
+		ee_printf("  %-16s %4" PRIu32 ".%02" PRIu32 "\n", g_phases[i].phase, us / 1000, (us % 1000) / 10);
+		total += us;
+	}
+	ee_printf("  %-16s %4" PRIu32 ".%02" PRIu32 "\n", "Total", total / 1000, (total % 1000) / 10);
+}
+
+void bootTraceFinish(void)
+{
+	if(g_finished) return;
+	g_finished = true;
+
+	if(!g_oafConfig.bootTrace) return;
+
+	const Result res = writeLog();
+	if(res != RES_OK) debug_printf("Failed to write boot trace: %s\n", result2String(res));
+	printSummary();
+}
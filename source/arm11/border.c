@@ -0,0 +1,218 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/border.h"
+#include "oaf_error_codes.h"
+#include "arm11/fmt.h"
+#include "drivers/cache.h"
+#include "arm11/drivers/gx.h"
+#include "drivers/gfx.h"
+#include "arm11/gpu_cmd_lists.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "arm11/perf.h"
+
+
+#define BORDER_CHUNK_SIZE  (1024u * 4)
+#define BORDER_PATH_LEN    (16u)
+
+
+typedef struct
+{
+	u8 *out;
+	u8 *end;
+	u32 left;     // Bytes left in the current packet. For runs the output size.
+	bool run;
+	u8 have;      // Bytes of the run pixel read so far.
+	u8 pixel[3];
+} BorderDecoder;
+
+
+
+static void makeBorderPath(char path[BORDER_PATH_LEN], const u8 slot, const char *const ext)
+{
+	if(slot == 0) ee_snprintf(path, BORDER_PATH_LEN, "border.%s", ext);
+	else          ee_snprintf(path, BORDER_PATH_LEN, "border%u.%s", slot, ext);
+}
+
+// The border passes through the display gamma in the LCD color LUT too.
+static void makeBorderGammaLut(u8 lut[256], const float displayGamma)
+{
+	if(displayGamma == 0.f)
+	{
+		for(u32 i = 0; i < 256; i++) lut[i] = i;
+		return;
+	}
+
+	const float invDisplayGamma = 1.f / displayGamma;
+	for(u32 i = 0; i < 256; i++)
+		lut[i] = lroundf(powf((float)i / 255, invDisplayGamma) * 255);
+}
+
+// Returns false on corrupted data. State is kept across chunks.
+static bool decodeBorderChunk(BorderDecoder *const d, const u8 *in, const u8 *const inEnd, const u8 lut[256])
+{
+	u8 *out = d->out;
+	while(in < inEnd)
+	{
+		if(d->left == 0)
+		{
+			const u8 ctrl = *in++;
+			d->run  = (ctrl & 0x80u) != 0;
+			d->left = ((ctrl & 0x7Fu) + 1) * 3;
+			d->have = 0;
+			if(d->left > (u32)(d->end - out)) return false; // Overflows the border.
+			continue;
+		}
+
+		if(!d->run)
+		{
+			u32 n = inEnd - in;
+			n = (n < d->left ? n : d->left);
+			d->left -= n;
+			while(n--) *out++ = lut[*in++];
+		}
+		else
+		{
+			while(d->have < 3 && in < inEnd) d->pixel[d->have++] = lut[*in++];
+			if(d->have < 3) break; // Pixel continues in the next chunk.
+
+			const u8 b = d->pixel[0], g = d->pixel[1], r = d->pixel[2];
+			for(u8 *const runEnd = out + d->left; out < runEnd; out += 3)
+			{
+				out[0] = b;
+				out[1] = g;
+				out[2] = r;
+			}
+			d->left = 0;
+		}
+	}
+	d->out = out;
+
+	return true;
+}
+
+// Copies the border in swizzled form to the GPU render buffer.
+// Both file formats use the frame buffer layout so the hardware does the tiling.
+static void swizzleBorder(const u8 *const borderBuf)
+{
+	GX_displayTransfer((const u32*)borderBuf, PPF_DIM(BORDER_WIDTH, BORDER_HEIGHT), (u32*)GPU_RENDER_BUF_ADDR,
+	                   PPF_DIM(BORDER_WIDTH, BORDER_HEIGHT), PPF_O_FMT(GX_BGR8) | PPF_I_FMT(GX_BGR8) | PPF_OUT_TILED);
+	GFX_waitForPPF();
+}
+
+static Result loadCompressedBorder(const char *const path, const float displayGamma, u8 *const out)
+{
+	FHandle f;
+	Result res = fOpen(&f, path, FA_OPEN_EXISTING | FA_READ);
+	if(res != RES_OK) return res;
+
+	u8 *const buf = (u8*)malloc(BORDER_CHUNK_SIZE);
+	if(buf == NULL)
+	{
+		fClose(f);
+		return RES_OUT_OF_MEM;
+	}
+
+	BorderHeader header;
+	u32 read;
+	res = fRead(f, &header, sizeof(header), &read);
+	if(res == RES_OK && (read != sizeof(header) || header.magic != BORDER_MAGIC ||
+	   header.version != BORDER_VERSION || header.format != BORDER_FMT_RLE_BGR8))
+		res = RES_INVALID_BORDER;
+
+	if(res == RES_OK)
+	{
+		u8 lut[256];
+		makeBorderGammaLut(lut, displayGamma);
+
+		BorderDecoder d = {out, out + BORDER_SIZE, 0, false, 0, {0}};
+		u32 dataLeft = header.dataSize;
+		while(dataLeft > 0)
+		{
+			const u32 chunkSize = (dataLeft < BORDER_CHUNK_SIZE ? dataLeft : BORDER_CHUNK_SIZE);
+			res = fRead(f, buf, chunkSize, &read);
+			if(res != RES_OK) break;
+			if(read != chunkSize || !decodeBorderChunk(&d, buf, buf + read, lut))
+			{
+				res = RES_INVALID_BORDER;
+				break;
+			}
+			dataLeft -= read;
+		}
+
+		if(res == RES_OK && (d.out != d.end || d.left != 0)) res = RES_INVALID_BORDER;
+		if(res == RES_OK) flushDCacheRange(out, BORDER_SIZE);
+	}
+
+	free(buf);
+	fClose(f);
+
+	return res;
+}
+
+static Result loadRawBorder(const char *const path, const float displayGamma, u8 *const borderBuf)
+{
+	const Result res = fsQuickRead(path, borderBuf, BORDER_SIZE);
+	if(res != RES_OK) return res;
+
+	if(displayGamma != 0.f)
+	{
+		u8 lut[256];
+		makeBorderGammaLut(lut, displayGamma);
+		for(u32 i = 0; i < BORDER_SIZE; i++) borderBuf[i] = lut[borderBuf[i]];
+		flushDCacheRange(borderBuf, BORDER_SIZE);
+	}
+
+	return RES_OK;
+}
+
+void loadBorder(const u8 slot, const float displayGamma)
+{
+	PERF_VAR(borderTicks);
+	PERF_START(borderTicks);
+
+	// Abuse currently invisible frame buffer as temporary buffer.
+	u8 *const borderBuf = (u8*)GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT);
+	const u8 borderSlot = (slot > BORDER_MAX_SLOT ? 0 : slot);
+	char path[BORDER_PATH_LEN];
+	makeBorderPath(path, borderSlot, "oab");
+	Result res = loadCompressedBorder(path, displayGamma, borderBuf);
+	if(res == RES_FR_NO_FILE)
+	{
+		makeBorderPath(path, borderSlot, "bgr");
+		res = loadRawBorder(path, displayGamma, borderBuf);
+	}
+
+	if(res == RES_OK) swizzleBorder(borderBuf);
+	else if(res != RES_FR_NO_FILE)
+	{
+		// Don't show half a border.
+		u8 *const renderBuf = (u8*)GPU_RENDER_BUF_ADDR;
+		memset(renderBuf, 0, BORDER_SIZE);
+		flushDCacheRange(renderBuf, BORDER_SIZE);
+		debug_printf("Failed to load border: %s\n", oafResult2String(res));
+	}
+
+	PERF_STOP(borderTicks);
+	PERF_PRINT("Border", borderTicks);
+}
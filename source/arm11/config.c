@@ -16,6 +16,8 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include "types.h"
@@ -26,6 +28,7 @@
 
 
 #define INI_BUF_SIZE    (1024u)
+#define CFG_KEY_BUCKETS (128u) // Power of 2 >= 2 * CFG_NUM_KEYS.
 #define DEFAULT_CONFIG  "[general]\n"             \
                         "backlight=64\n"          \
                         "backlightSteps=5\n"      \
@@ -37,13 +40,20 @@
                         "lcdGamma=1.54\n"         \
                         "contrast=1.0\n"          \
                         "brightness=0.0\n"        \
-                        "colorProfile=none\n\n"   \
+                        "colorProfile=none\n"     \
+                        "framePacing=0\n"         \
+                        "border=0\n\n"            \
                         "[audio]\n"               \
                         "audioOut=0\n"            \
                         "volume=127\n\n"          \
                         "[advanced]\n"            \
                         "saveOverride=false\n"    \
-                        "defaultSave=14"
+                        "defaultSave=14\n"       \
+                        "patchCache=false\n"      \
+                        "bootTrace=false\n"       \
+                        "inputRate=1000\n"        \
+                        "profileStore=false\n"    \
+                        "n3dsBoost=0"
 
 
 
@@ -63,6 +73,8 @@ OafConfig g_oafConfig =
 	1.f,   // contrast
 	0.f,   // brightness
 	0,     // colorProfile
+	0,     // framePacing
+	0,     // border
 
 	// [audio]
 	0,     // Automatic audio output.
@@ -88,9 +100,78 @@ OafConfig g_oafConfig =
 
 	// [advanced]
 	false, // saveOverride
-	14     // defaultSave
+	14,    // defaultSave
+	false, // patchCache
+	false, // bootTrace
+	1000,  // inputRate
+	false, // profileStore
+	0      // n3dsBoost
 };
 
+enum
+{
+	CFG_TYPE_U8 = 0,
+	CFG_TYPE_S8,
+	CFG_TYPE_U16,
+	CFG_TYPE_BOOL,           // Only "true" is true.
+	CFG_TYPE_BOOL_NOT_FALSE, // Everything except "false" is true.
+	CFG_TYPE_FLOAT,
+	CFG_TYPE_COLOR_PROFILE,
+	CFG_TYPE_BUTTONS
+};
+
+typedef struct
+{
+	const char *section;
+	const char *name;
+	u8 type;
+	u8 offset;           // In OafConfig.
+} OafConfigKey;
+
+#define CFG_KEY(section, name, type, field)  {section, name, type, offsetof(OafConfig, field)}
+
+// Append only. The index is stored in profiles.bin.
+static const OafConfigKey g_cfgKeys[] =
+{
+	CFG_KEY("general",  "backlight",      CFG_TYPE_U8,             backlight),
+	CFG_KEY("general",  "backlightSteps", CFG_TYPE_U8,             backlightSteps),
+	CFG_KEY("general",  "directBoot",     CFG_TYPE_BOOL_NOT_FALSE, directBoot),
+	CFG_KEY("general",  "useGbaDb",       CFG_TYPE_BOOL,           useGbaDb),
+	CFG_KEY("video",    "scaler",         CFG_TYPE_U8,             scaler),
+	CFG_KEY("video",    "gbaGamma",       CFG_TYPE_FLOAT,          gbaGamma),
+	CFG_KEY("video",    "lcdGamma",       CFG_TYPE_FLOAT,          lcdGamma),
+	CFG_KEY("video",    "contrast",       CFG_TYPE_FLOAT,          contrast),
+	CFG_KEY("video",    "brightness",     CFG_TYPE_FLOAT,          brightness),
+	CFG_KEY("video",    "colorProfile",   CFG_TYPE_COLOR_PROFILE,  colorProfile),
+	CFG_KEY("video",    "framePacing",    CFG_TYPE_U8,             framePacing),
+	CFG_KEY("audio",    "audioOut",       CFG_TYPE_U8,             audioOut),
+	CFG_KEY("audio",    "volume",         CFG_TYPE_S8,             volume),
+	CFG_KEY("input",    "A",              CFG_TYPE_BUTTONS,        buttonMaps[0]),
+	CFG_KEY("input",    "B",              CFG_TYPE_BUTTONS,        buttonMaps[1]),
+	CFG_KEY("input",    "SELECT",         CFG_TYPE_BUTTONS,        buttonMaps[2]),
+	CFG_KEY("input",    "START",          CFG_TYPE_BUTTONS,        buttonMaps[3]),
+	CFG_KEY("input",    "RIGHT",          CFG_TYPE_BUTTONS,        buttonMaps[4]),
+	CFG_KEY("input",    "LEFT",           CFG_TYPE_BUTTONS,        buttonMaps[5]),
+	CFG_KEY("input",    "UP",             CFG_TYPE_BUTTONS,        buttonMaps[6]),
+	CFG_KEY("input",    "DOWN",           CFG_TYPE_BUTTONS,        buttonMaps[7]),
+	CFG_KEY("input",    "R",              CFG_TYPE_BUTTONS,        buttonMaps[8]),
+	CFG_KEY("input",    "L",              CFG_TYPE_BUTTONS,        buttonMaps[9]),
+	CFG_KEY("game",     "saveSlot",       CFG_TYPE_U8,             saveSlot),
+	CFG_KEY("game",     "saveType",       CFG_TYPE_U8,             saveType),
+	CFG_KEY("advanced", "saveOverride",   CFG_TYPE_BOOL_NOT_FALSE, saveOverride),
+	CFG_KEY("advanced", "defaultSave",    CFG_TYPE_U16,            defaultSave),
+	CFG_KEY("advanced", "patchCache",     CFG_TYPE_BOOL,           patchCache),
+	CFG_KEY("advanced", "bootTrace",      CFG_TYPE_BOOL,           bootTrace),
+	CFG_KEY("advanced", "inputRate",      CFG_TYPE_U16,            inputRate),
+	CFG_KEY("advanced", "profileStore",   CFG_TYPE_BOOL,           profileStore),
+	CFG_KEY("advanced", "n3dsBoost",      CFG_TYPE_U8,             n3dsBoost),
+	CFG_KEY("video",    "border",         CFG_TYPE_U8,             border)
+};
+#define CFG_NUM_KEYS  (sizeof(g_cfgKeys) / sizeof(*g_cfgKeys))
+static_assert(CFG_NUM_KEYS * 2 <= CFG_KEY_BUCKETS, "Error: Too many config keys for CFG_KEY_BUCKETS!");
+static_assert(CFG_NUM_KEYS <= CFG_MAX_VALUES, "Error: Too many config keys for CFG_MAX_VALUES!");
+static_assert(sizeof(OafConfig) <= 256, "Error: OafConfig offsets don't fit in OafConfigKey!");
+
 
 
 static u32 parseButtons(const char *str)
@@ -129,84 +210,199 @@ static u32 parseButtons(const char *str)
 	return map & ~(1u<<12);
 }
 
-static int cfgIniCallback(void* user, const char* section, const char* name, const char* value)
+static bool parseColorProfile(const char *const value, u32 *const out)
 {
-	OafConfig *const config = (OafConfig*)user;
+	static const struct
+	{
+		const char *name;
+		u8 profile;
+	} profileLut[] =
+	{
+		{"none",           0},
+		{"gba",            1},
+		{"nds",            2},
+		{"nds_white",      3},
+		{"gba_fast",       1 | COLOR_PROFILE_SEPARABLE},
+		{"nds_fast",       2 | COLOR_PROFILE_SEPARABLE},
+		{"nds_white_fast", 3 | COLOR_PROFILE_SEPARABLE},
+		{"gba_gpu",        1 | COLOR_PROFILE_GPU},
+		{"nds_gpu",        2 | COLOR_PROFILE_GPU},
+		{"nds_white_gpu",  3 | COLOR_PROFILE_GPU}
+		//{"custom",         4} // TODO: Implement user provided profile.
+	};
 
-	if(strcmp(section, "general") == 0)
+	for(u32 i = 0; i < sizeof(profileLut) / sizeof(*profileLut); i++)
 	{
-		if(strcmp(name, "backlight") == 0)
-			config->backlight = (u8)strtoul(value, NULL, 10);
-		else if(strcmp(name, "backlightSteps") == 0)
-			config->backlightSteps = (u8)strtoul(value, NULL, 10);
-		else if(strcmp(name, "directBoot") == 0)
-			config->directBoot = (strcmp(value, "false") == 0 ? false : true);
-		else if(strcmp(name, "useGbaDb") == 0)
-			config->useGbaDb = (strcmp(value, "true") == 0 ? true : false);
+		if(strcmp(value, profileLut[i].name) == 0)
+		{
+			*out = profileLut[i].profile;
+			return true;
+		}
 	}
-	else if(strcmp(section, "video") == 0)
+
+	return false;
+}
+
+// Returns false if the value should be ignored.
+static bool parseKeyValue(const u8 type, const char *const value, u32 *const out)
+{
+	switch(type)
 	{
-		if(strcmp(name, "scaler") == 0)
-			config->scaler = (u8)strtoul(value, NULL, 10);
-		else if(strcmp(name, "gbaGamma") == 0)
-			config->gbaGamma = str2float(value);
-		else if(strcmp(name, "lcdGamma") == 0)
-			config->lcdGamma = str2float(value);
-		else if(strcmp(name, "contrast") == 0)
-			config->contrast = str2float(value);
-		else if(strcmp(name, "brightness") == 0)
-			config->brightness = str2float(value);
-		else if(strcmp(name, "colorProfile") == 0)
+		case CFG_TYPE_U8:
+		case CFG_TYPE_U16:
+			*out = strtoul(value, NULL, 10);
+			break;
+		case CFG_TYPE_S8:
+			*out = (u32)strtol(value, NULL, 10);
+			break;
+		case CFG_TYPE_BOOL:
+			*out = strcmp(value, "true") == 0;
+			break;
+		case CFG_TYPE_BOOL_NOT_FALSE:
+			*out = strcmp(value, "false") != 0;
+			break;
+		case CFG_TYPE_FLOAT:
 		{
-			if(strcmp(value, "none") == 0)
-				config->colorProfile = 0;
-			else if(strcmp(value, "gba") == 0)
-				config->colorProfile = 1;
-			else if(strcmp(value, "nds") == 0)
-				config->colorProfile = 2;
-			else if(strcmp(value, "nds_white") == 0)
-				config->colorProfile = 3;
-			//else if(strcmp(value, "custom") == 0) // TODO: Implement user provided profile.
-			//	config->colorProfile = 4;
+			const float f = str2float(value);
+			memcpy(out, &f, sizeof(f));
+			break;
 		}
+		case CFG_TYPE_COLOR_PROFILE:
+			return parseColorProfile(value, out);
+		case CFG_TYPE_BUTTONS:
+			*out = parseButtons(value);
+			break;
+		default:
+			return false;
 	}
-	else if(strcmp(section, "audio") == 0)
+
+	return true;
+}
+
+static u32 hashKey(const char *section, const char *name)
+{
+	// 32 bit FNV-1a over section and name.
+	u32 hash = 2166136261u;
+	for(; *section != '\0'; section++)
 	{
-		if(strcmp(name, "audioOut") == 0)
-			config->audioOut = (u8)strtoul(value, NULL, 10);
-		else if(strcmp(name, "volume") == 0)
-			config->volume = (s8)strtol(value, NULL, 10);
+		hash ^= (u8)*section;
+		hash *= 16777619u;
 	}
-	else if(strcmp(section, "input") == 0)
+	hash *= 16777619u; // Separator.
+	for(; *name != '\0'; name++)
 	{
-		const u32 button = parseButtons(name) & 0x3FFu; // Only allow GBA buttons.
-		if(button != 0)
+		hash ^= (u8)*name;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static s32 findOafConfigKey(const char *const section, const char *const name)
+{
+	// Open addressing hash table over g_cfgKeys. Built on first use.
+	// Index + 1, 0 = empty.
+	static u8 keyBuckets[CFG_KEY_BUCKETS] = {0};
+	static bool built = false;
+	if(!built)
+	{
+		for(u32 i = 0; i < CFG_NUM_KEYS; i++)
 		{
-			// If the config option happens to abuse parseButtons() we will only use the highest bit.
-			const u32 shift = 31u - __builtin_clzl(button);
-			const u32 map   = parseButtons(value);
-			config->buttonMaps[shift] = map;
+			u32 bucket = hashKey(g_cfgKeys[i].section, g_cfgKeys[i].name);
+			while(keyBuckets[bucket % CFG_KEY_BUCKETS] != 0) bucket++;
+			keyBuckets[bucket % CFG_KEY_BUCKETS] = i + 1;
 		}
+		built = true;
 	}
-	else if(strcmp(section, "game") == 0)
+
+	u32 bucket = hashKey(section, name);
+	u32 idx;
+	while((idx = keyBuckets[bucket++ % CFG_KEY_BUCKETS]) != 0)
 	{
-		if(strcmp(name, "saveSlot") == 0)
-			config->saveSlot = (u8)strtoul(value, NULL, 10);
-		if(strcmp(name, "saveType") == 0)
-			config->saveType = (u8)strtoul(value, NULL, 10);
+		const OafConfigKey *const key = &g_cfgKeys[idx - 1];
+		if(strcmp(key->name, name) == 0 && strcmp(key->section, section) == 0)
+			return idx - 1;
 	}
-	else if(strcmp(section, "advanced") == 0)
+
+	return -1;
+}
+
+static void setOafConfigValue(OafConfig *const cfg, const u8 keyIdx, const u32 value)
+{
+	if(keyIdx >= CFG_NUM_KEYS) return;
+
+	void *const field = (u8*)cfg + g_cfgKeys[keyIdx].offset;
+	switch(g_cfgKeys[keyIdx].type)
 	{
-		if(strcmp(name, "saveOverride") == 0)
-			config->saveOverride = (strcmp(value, "false") == 0 ? false : true);
-		if(strcmp(name, "defaultSave") == 0)
-			config->defaultSave = (u16)strtoul(value, NULL, 10);
+		case CFG_TYPE_U8:
+		case CFG_TYPE_S8:
+		case CFG_TYPE_COLOR_PROFILE:
+			*(u8*)field = (u8)value;
+			break;
+		case CFG_TYPE_BOOL:
+		case CFG_TYPE_BOOL_NOT_FALSE:
+			*(bool*)field = value != 0;
+			break;
+		case CFG_TYPE_U16:
+			*(u16*)field = (u16)value;
+			break;
+		case CFG_TYPE_FLOAT:
+		case CFG_TYPE_BUTTONS:
+			memcpy(field, &value, sizeof(u32));
+			break;
 	}
-	else return 0; // Error.
+}
+
+void applyOafConfigValues(OafConfig *const cfg, const OafConfigValues *const values)
+{
+	const u32 num = (values->num > CFG_MAX_VALUES ? CFG_MAX_VALUES : values->num);
+	for(u32 i = 0; i < num; i++)
+		setOafConfigValue(cfg, values->keys[i], values->values[i]);
+}
+
+static int isKnownSection(const char *const section)
+{
+	for(u32 i = 0; i < CFG_NUM_KEYS; i++)
+		if(strcmp(g_cfgKeys[i].section, section) == 0) return 1;
+
+	return 0;
+}
+
+static int cfgIniCallback(void* user, const char* section, const char* name, const char* value)
+{
+	OafConfig *const config = (OafConfig*)user;
+
+	const s32 keyIdx = findOafConfigKey(section, name);
+	if(keyIdx < 0) return isKnownSection(section); // Unknown sections are an error.
+
+	u32 parsed;
+	if(parseKeyValue(g_cfgKeys[keyIdx].type, value, &parsed))
+		setOafConfigValue(config, keyIdx, parsed);
 
 	return 1; // 1 is no error? Really?
 }
 
+static int cfgValuesIniCallback(void* user, const char* section, const char* name, const char* value)
+{
+	OafConfigValues *const values = (OafConfigValues*)user;
+
+	const s32 keyIdx = findOafConfigKey(section, name);
+	if(keyIdx < 0) return isKnownSection(section);
+
+	u32 parsed;
+	if(!parseKeyValue(g_cfgKeys[keyIdx].type, value, &parsed)) return 1;
+
+	// Later assignments of the same key win like in cfgIniCallback().
+	u32 i = 0;
+	while(i < values->num && values->keys[i] != keyIdx) i++;
+	if(i == CFG_MAX_VALUES) return 1;
+	values->keys[i]   = keyIdx;
+	values->values[i] = parsed;
+	values->num += (i == values->num);
+
+	return 1;
+}
+
 // TODO: Instead of writing a hardcoded string turn default config into a string.
 Result parseOafConfig(const char *const path, OafConfig *cfg, const bool newCfgOnError)
 {
@@ -225,4 +421,18 @@ Result parseOafConfig(const char *const path, OafConfig *cfg, const bool newCfgO
 	free(iniBuf);
 
 	return res;
-}
\ No newline at end of file
+}
+
+Result parseOafConfigValues(const char *const path, OafConfigValues *const values)
+{
+	char *iniBuf = (char*)calloc(INI_BUF_SIZE, 1);
+	if(iniBuf == NULL) return RES_OUT_OF_MEM;
+
+	memset(values, 0, sizeof(OafConfigValues));
+	const Result res = fsQuickRead(path, iniBuf, INI_BUF_SIZE - 1);
+	if(res == RES_OK) ini_parse_string(iniBuf, cfgValuesIniCallback, values);
+
+	free(iniBuf);
+
+	return res;
+}
@@ -0,0 +1,128 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/core1.h"
+#include "arm.h"
+#include "system.h"
+#include "arm11/perf.h"
+
+
+// Single slot mailbox. Core 0 only writes job/arg/submitted, core 1 only finished.
+// The L1 data caches are kept coherent by the SCU so barriers are enough.
+typedef struct
+{
+	Core1Job job;
+	void *arg;
+	vu32 submitted;
+	vu32 finished;
+} Core1Mailbox;
+
+static Core1Mailbox g_core1Mailbox = {0};
+static bool g_core1Running = false;
+static bool g_core1HandedOver = false;
+static void (*g_core1HandoverEntry)(void) = NULL;
+
+
+
+static void core1JobLoop(void)
+{
+	Core1Mailbox *const mb = &g_core1Mailbox;
+
+	// Ticks are per core.
+	perfInit();
+
+	u32 seen = 0;
+	while(1)
+	{
+		u32 submitted;
+		while((submitted = mb->submitted) == seen) __wfe();
+		__dmb(); // Read job after submitted.
+
+		mb->job(mb->arg);
+		seen = submitted;
+
+		__dmb(); // Job results visible before finished.
+		mb->finished = submitted;
+		__dsb();
+		__sev();
+	}
+}
+
+void core1Init(void)
+{
+	if(g_core1Running) return;
+
+	g_core1Running = true;
+	__systemBootCore1(core1JobLoop);
+}
+
+void core1Submit(Core1Job job, void *arg)
+{
+	Core1Mailbox *const mb = &g_core1Mailbox;
+	if(!g_core1Running || g_core1HandedOver)
+	{
+		job(arg);
+		return;
+	}
+
+	core1Wait();
+	mb->job = job;
+	mb->arg = arg;
+	__dmb(); // Job visible before submitted.
+	mb->submitted++;
+	__dsb();
+	__sev();
+}
+
+bool core1Busy(void)
+{
+	const Core1Mailbox *const mb = &g_core1Mailbox;
+	if(g_core1HandedOver) return false;
+
+	return mb->finished != mb->submitted;
+}
+
+void core1Wait(void)
+{
+	const Core1Mailbox *const mb = &g_core1Mailbox;
+	if(g_core1HandedOver) return;
+
+	while(mb->finished != mb->submitted) __wfe();
+	__dmb(); // Read job results after finished.
+}
+
+static void handoverJob(UNUSED void *arg)
+{
+	g_core1HandoverEntry();
+}
+
+void core1Handover(void (*entry)(void))
+{
+	if(!g_core1Running)
+	{
+		g_core1Running = true;
+		g_core1HandedOver = true;
+		__systemBootCore1(entry);
+		return;
+	}
+
+	g_core1HandoverEntry = entry;
+	core1Submit(handoverJob, NULL);
+	g_core1HandedOver = true;
+}
@@ -22,6 +22,29 @@
 .fpu vfpv2
 
 
+#ifndef NDEBUG
+@ Remembers the watchdog counter when the first 8 lines of a frame are converted.
+@ Expects r5 = MPCORE_PRIV_BASE and r11 = line number. Clobbers r6, r7 and flags.
+.macro CONV_TIMING_START
+	cmp  r11, #8                               @ r11 - 8; // Updates flags.
+	ldreq r6, [r5, #0x624]                     @ if(r11 == 8) r6 = REG_WDT_COUNTER; // u32.
+	ldreq r7, =g_convTicks                     @ if(r11 == 8) r7 = g_convTicks;
+	streq r6, [r7]                             @ if(r11 == 8) g_convTicks[0] = r6;  // u32.
+.endm
+
+@ Stores the conversion time of the frame. The watchdog counts down.
+@ Clobbers r4-r7.
+.macro CONV_TIMING_END
+	ldr  r4, =MPCORE_PRIV_BASE                 @ r4 = MPCORE_PRIV_BASE;  // u32.
+	ldr  r7, =g_convTicks                      @ r7 = g_convTicks;
+	ldr  r5, [r4, #0x624]                      @ r5 = REG_WDT_COUNTER;   // u32.
+	ldr  r6, [r7]                              @ r6 = g_convTicks[0];    // u32.
+	sub  r6, r6, r5                            @ r6 -= r5;
+	str  r6, [r7, #4]                          @ g_convTicks[1] = r6;    // u32.
+.endm
+#endif
+
+
 
 @ Whole frame converter.
 /*BEGIN_ASM_FUNC convertFrameFast
@@ -95,116 +118,126 @@
 	ldmfd sp!, {r4-r11, pc}             @ Restore registers and return.
 END_ASM_FUNC*/
 
-@ Converts a 160p frame while it's being DMAd to memory.
-BEGIN_ASM_FUNC convert160pFrameFast
-	@ Enable top LCD LgyCap IRQs.
-	mov  r0, #77                                   @ r0 = 77; // id     IRQ_LGYCAP_TOP.
-	mov  r1, #0                                    @ r1 = 0;  // prio   0 (highest).
-	mov  r2, #0                                    @ r2 = 0;  // target 0 (this CPU).
-	mov  r3, #0                                    @ r3 = 0;  // isr    NULL.
-	blx IRQ_registerIsr                            @ IRQ_registerIsr(IRQ_LGYCAP_TOP, 0, 0, (IrqIsr)NULL);
-
-	@ We will be using IRQs without our IRQ handler to minimize latency.
-	cpsid i                                        @ __disableIrq();
-
+@ 3D LUT setup. The table is a 15 to 32-bit 3D lookup table with color correction pre-applied.
+.macro CONV_SETUP_LUT
 	@ Load lookup table address and color mask.
 	ldr   r2, =0x1FF00000                          @ r2 = 0x1FF00000;
 	ldrh r12, =0x7FFF                              @ r12 = 0x7FFF;
-
-	convert160pFrameFast_frame_lp:
-		@ Load input and output addresses.
-		ldr  r0, =0x18200000                       @ r0 = 0x18200000;    // u32.
-		@ldr  r1, =0x18300000                       @ r1 = 0x18300000;    // u32.
-		add  r1,  r0, #0x100000                    @ r1 = r0 + 0x100000; // Note: ldr would be faster here (result latency). Saves 4 bytes.
-
-		@ Convert 8 lines each round until we have a whole frame.
-		convert160pFrameFast_8l_lp:
-			ldr  r4, =0x10111008                   @ r4 = &REG_LGYCAP1_STAT; // u32.
-			ldr  r5, =MPCORE_PRIV_BASE             @ r5 = MPCORE_PRIV_BASE;  // u32.
-
-			convert160pFrameFast_wait_irq:
-				@ Wait for LgyCap IRQs.
-				wfi                                @ __waitForInterrupt();
-
-				@ Acknowledge IRQ and extract line number.
-				ldr r11, [r4]                      @ r11 = REG_LGYCAP_STAT; // u32.
-				ldr  r7, [r5, #0x10C]              @ r7 = REG_GICC_INTACK;  // u32.
-				str r11, [r4]                      @ REG_LGYCAP_STAT = r11; // u32.
-				lsrs r11, r11, #16                 @ r11 >>= 16;            // Updates flags.
-				str  r7, [r5, #0x110]              @ REG_GICC_EOI = r7;     // u32.
-
-				@ Ignore DREQ IRQ for line 0.
-				beq convert160pFrameFast_wait_irq      @ if((r11>>16) == 0) goto convert160pFrameFast_wait_irq;
-
-			convert160pFrameFast_skip_irq_wait:
-			@ Load size of 8 lines in bytes.
-			mov  r3, #0xF00                        @ r3 = 0xF00;
-
-			@ Convert 8 pixels each round until we have 8 lines.
-			convert160pFrameFast_8p_lp:
-				@ Load 8 pixels from frame.
-				ldmia  r0!, {r8-r10, lr}           @ r8_to_r10_lr = *((_16BytesBlock*)r0); r0 += 16;
-
-				@ Decrement size and extract first 2 pixels.
-				subs r3,  r3, #16                  @ r3 -= 16;              // Updates flags.
-				and  r4, r12,  r8, lsr #1          @ r4 = 0x7FFF & (r8>>1); // r12 is 0x7FFF.
-				lsr  r5,  r8, #17                  @ r5 = r8>>17;
-
-				@ Look up pixel 1 and extract pixel 3.
-				ldr  r4, [r2,  r4, lsl #2]         @ r4 = r2[r4];           // u32.
-				and  r6, r12,  r9, lsr #1          @ r6 = 0x7FFF & (r9>>1); // r12 is 0x7FFF.
-
-				@ Look up pixel 2 and extract pixel 4.
-				ldr  r5, [r2,  r5, lsl #2]         @ r5 = r2[r5]; // u32.
-				lsr  r7,  r9, #17                  @ r7 = r9>>17;
-
-				@ Look up pixel 3 and extract pixel 5.
-				ldr  r6, [r2,  r6, lsl #2]         @ r6 = r2[r6];            // u32.
-				and  r8, r12, r10, lsr #1          @ r8 = 0x7FFF & (r10>>1); // r12 is 0x7FFF.
-
-				@ Look up pixel 4 and extract pixel 6.
-				ldr  r7, [r2,  r7, lsl #2]         @ r7 = r2[r7];  // u32.
-				lsr  r9, r10, #17                  @ r9 = r10>>17;
-
-				@ Look up pixel 5 and extract pixel 7.
-				ldr  r8, [r2,  r8, lsl #2]         @ r8 = r2[r8];            // u32.
-				and r10, r12,  lr, lsr #1          @ r10 = 0x7FFF & (lr>>1); // r12 is 0x7FFF.
-
-				@ Look up pixel 6 and extract pixel 8.
-				ldr  r9, [r2,  r9, lsl #2]         @ r9 = r2[r9]; // u32.
-				lsr  lr,  lr, #17                  @ lr = lr>>17;
-
-				@ Look up pixel 7 and 8.
-				ldr r10, [r2, r10, lsl #2]         @ r10 = r2[r10]; // u32.
-				ldr  lr, [r2,  lr, lsl #2]         @ lr = r2[lr];   // u32.
-
-				@ Prefetch next cache line, write 8 pixels and jump back if we are not done yet.
-				pld [r0, #32]                      @ Prefetch from r0 + 32. // Offset 32 is a tiny bit better. Most of the time the result is the same as 64.
-				stmia  r1!, {r4-r10, lr}           @ *((_32BytesBlock*)r1) = r4_to_r10_lr; r1 += 32;
-				bne convert160pFrameFast_8p_lp     @ if(r3 != 0) goto convert160pFrameFast_8p_lp;
-
-			@ Test if 8 line counter is 152, skip texture padding and jump back if we are not done yet.
-			cmp r11, #152                          @ r11 - 152; // Updates flags.
-			add  r0,  r0, #0x1100                  @ r0 += 0x1100;
-			add  r1,  r1, #0x2200                  @ r1 += 0x2200;
-			moveq r11, #160                        @ if(r11 == 152) r11 = 160;
-			beq convert160pFrameFast_skip_irq_wait @ if(r11 == 152) goto convert160pFrameFast_skip_irq_wait;
-			bls convert160pFrameFast_8l_lp         @ if(r11 <= 152) goto convert160pFrameFast_8l_lp;
-
-		@ Flush the D-Cache, wait for flush completion, notify core 0 and jump back.
-		@ Note: r3 has been decremented down to 0 previously and so it's safe to use.
-		mcr p15, 0, r3, c7, c14, 0                 @ Clean and Invalidate Entire Data Cache.
-		ldr  r4, =MPCORE_PRIV_BASE                 @ r4 = MPCORE_PRIV_BASE;  // u32.
-		mov  r5, #0x10000                          @ r5 = 0x10000;
-		orr  r5,  r5, #0xF                         @ r5 |= 0xF;
-		add  r4,  r4, #0x1F00                      @ r4 += 0x1F00; // REG_GICD_SOFTINT.
-		mcr p15, 0, r3, c7, c10, 4                 @ Data Synchronization Barrier.
-		str  r5, [r4]                              @ *r4 = r5; // u32.
-		b convert160pFrameFast_frame_lp            @ goto convert160pFrameFast_frame_lp;
-END_ASM_FUNC
-
-@ Converts the frame while it's being DMAd to memory.
-BEGIN_ASM_FUNC convert240pFrameFast
+.endm
+
+@ Converts r3 bytes of pixels from r0 to r1 with the 3D LUT.
+@ Expects r2 = LUT and r12 = 0x7FFF. Clobbers r4-r10 and lr.
+.macro CONV_PIXELS_LUT name
+	@ Convert 8 pixels each round until we have 8 lines.
+	\name\()_8p_lp:
+		@ Load 8 pixels from frame.
+		ldmia  r0!, {r8-r10, lr}                   @ r8_to_r10_lr = *((_16BytesBlock*)r0); r0 += 16;
+
+		@ Decrement size and extract first 2 pixels.
+		subs r3,  r3, #16                          @ r3 -= 16;              // Updates flags.
+		and  r4, r12,  r8, lsr #1                  @ r4 = 0x7FFF & (r8>>1); // r12 is 0x7FFF.
+		lsr  r5,  r8, #17                          @ r5 = r8>>17;
+
+		@ Look up pixel 1 and extract pixel 3.
+		ldr  r4, [r2,  r4, lsl #2]                 @ r4 = r2[r4];           // u32.
+		and  r6, r12,  r9, lsr #1                  @ r6 = 0x7FFF & (r9>>1); // r12 is 0x7FFF.
+
+		@ Look up pixel 2 and extract pixel 4.
+		ldr  r5, [r2,  r5, lsl #2]                 @ r5 = r2[r5]; // u32.
+		lsr  r7,  r9, #17                          @ r7 = r9>>17;
+
+		@ Look up pixel 3 and extract pixel 5.
+		ldr  r6, [r2,  r6, lsl #2]                 @ r6 = r2[r6];            // u32.
+		and  r8, r12, r10, lsr #1                  @ r8 = 0x7FFF & (r10>>1); // r12 is 0x7FFF.
+
+		@ Look up pixel 4 and extract pixel 6.
+		ldr  r7, [r2,  r7, lsl #2]                 @ r7 = r2[r7];  // u32.
+		lsr  r9, r10, #17                          @ r9 = r10>>17;
+
+		@ Look up pixel 5 and extract pixel 7.
+		ldr  r8, [r2,  r8, lsl #2]                 @ r8 = r2[r8];            // u32.
+		and r10, r12,  lr, lsr #1                  @ r10 = 0x7FFF & (lr>>1); // r12 is 0x7FFF.
+
+		@ Look up pixel 6 and extract pixel 8.
+		ldr  r9, [r2,  r9, lsl #2]                 @ r9 = r2[r9]; // u32.
+		lsr  lr,  lr, #17                          @ lr = lr>>17;
+
+		@ Look up pixel 7 and 8.
+		ldr r10, [r2, r10, lsl #2]                 @ r10 = r2[r10]; // u32.
+		ldr  lr, [r2,  lr, lsl #2]                 @ lr = r2[lr];   // u32.
+
+		@ Prefetch next cache line, write 8 pixels and jump back if we are not done yet.
+		pld [r0, #32]                              @ Prefetch from r0 + 32. // Offset 32 is a tiny bit better. Most of the time the result is the same as 64.
+		stmia  r1!, {r4-r10, lr}                   @ *((_32BytesBlock*)r1) = r4_to_r10_lr; r1 += 32;
+		bne \name\()_8p_lp                         @ if(r3 != 0) goto 8p_lp;
+.endm
+
+@ Separable table setup. Everything fits in the L1 D-Cache.
+@ 0x1FF00000: 3 input channel tables (bits 1-5, 6-10, 11-15) with 32 entries of
+@             {u32 R | G<<16, u32 B} (fixed point, linear, matrix applied).
+@ 0x1FF00300: u8 display gamma table indexed by the clamped 12 bit sums.
+.macro CONV_SETUP_SEP
+	@ Load table addresses and index mask.
+	ldr   r2, =0x1FF00000                          @ r2 = 0x1FF00000;
+	add  r10,  r2, #0x300                          @ r10 = r2 + 0x300;
+	mov  r12, #0xF8                                @ r12 = 0xF8; // 5 bit channel * 8 bytes per entry.
+.endm
+
+@ Converts the pixel in lr at the given channel shifts to ABGR8 in out.
+@ Expects r2 = channel tables, r10 = display gamma table and r12 = 0xF8. Clobbers r4-r7 and r9.
+.macro CONV_SEP_PIXEL out, opR, shR, shG, shB
+	@ Add up the entries for all 3 input channels.
+	and   r9, r12,  lr, \opR #\shR                 @ r9 = 0xF8 & (lr opR shR); // r12 is 0xF8.
+	ldrd  r4,  r5, [r2, r9]                        @ r4_r5 = *((u64*)(r2 + r9));
+	and   r9, r12,  lr, lsr #\shG                  @ r9 = 0xF8 & (lr>>shG);
+	add   r9,  r9, #0x100                          @ r9 += 0x100;
+	ldrd  r6,  r7, [r2, r9]                        @ r6_r7 = *((u64*)(r2 + r9));
+	and   r9, r12,  lr, lsr #\shB                  @ r9 = 0xF8 & (lr>>shB);
+	add   r9,  r9, #0x200                          @ r9 += 0x200;
+	add   r4,  r4, r6                              @ r4 += r6;
+	add   r5,  r5, r7                              @ r5 += r7;
+	ldrd  r6,  r7, [r2, r9]                        @ r6_r7 = *((u64*)(r2 + r9));
+	add   r4,  r4, r6                              @ r4 += r6; // R | G<<16.
+	add   r5,  r5, r7                              @ r5 += r7; // B.
+
+	@ Clamp, look up display gamma and merge to ABGR8.
+	uxth  r6,  r4                                  @ r6 = (u16)r4;
+	lsr   r4,  r4, #16                             @ r4 >>= 16;
+	usat  r6, #12, r6                              @ r6 = clamp(r6, 0, 4095);
+	usat  r4, #12, r4                              @ r4 = clamp(r4, 0, 4095);
+	usat  r5, #12, r5                              @ r5 = clamp(r5, 0, 4095);
+	ldrb  r6, [r10, r6]                            @ r6 = r10[r6]; // u8.
+	ldrb  r4, [r10, r4]                            @ r4 = r10[r4]; // u8.
+	ldrb  r5, [r10, r5]                            @ r5 = r10[r5]; // u8.
+	mov  \out, #0xFF                               @ out = 0xFF;   // Alpha.
+	orr  \out, \out, r5, lsl #8                    @ out |= r5<<8;
+	orr  \out, \out, r4, lsl #16                   @ out |= r4<<16;
+	orr  \out, \out, r6, lsl #24                   @ out |= r6<<24;
+.endm
+
+@ Converts r3 bytes of pixels from r0 to r1 with the separable tables.
+@ A pixel needs 3 ldrd and 3 ldrb which all hit L1. Clobbers r4-r9 and lr.
+.macro CONV_PIXELS_SEP name
+	@ Convert 2 pixels each round until we have 8 lines.
+	\name\()_2p_lp:
+		@ Load 2 pixels from frame and decrement size.
+		ldr   lr, [r0], #4                         @ lr = *((u32*)r0); r0 += 4;
+		subs  r3,  r3, #4                          @ r3 -= 4; // Updates flags.
+
+		CONV_SEP_PIXEL r8, lsl, 2, 3, 8           @ Pixel 1.
+		CONV_SEP_PIXEL r9, lsr, 14, 19, 24        @ Pixel 2.
+
+		@ Prefetch next cache line, write 2 pixels and jump back if we are not done yet.
+		pld [r0, #32]                              @ Prefetch from r0 + 32.
+		stmia  r1!, {r8, r9}                       @ *((_8BytesBlock*)r1) = r8_r9; r1 += 8;
+		bne \name\()_2p_lp                         @ if(r3 != 0) goto 2p_lp;
+.endm
+
+@ Converts frames with the given number of lines (160 or 240) while they are being DMAd to memory.
+@ bytes is the size of 8 input lines. Input and output are 512x512 textures.
+@ mode is LUT or SEP. Never returns.
+.macro CONVERT_FRAME name, lines, bytes, mode
+BEGIN_ASM_FUNC \name
 	@ Enable top LCD LgyCap IRQs.
 	mov  r0, #77                                   @ r0 = 77; // id     IRQ_LGYCAP_TOP.
 	mov  r1, #0                                    @ r1 = 0;  // prio   0 (highest).
@@ -215,22 +248,20 @@ BEGIN_ASM_FUNC convert240pFrameFast
 	@ We will be using IRQs without our IRQ handler to minimize latency.
 	cpsid i                                        @ __disableIrq();
 
-	@ Load lookup table address and color mask.
-	ldr   r2, =0x1FF00000                          @ r2 = 0x1FF00000;
-	ldrh r12, =0x7FFF                              @ r12 = 0x7FFF;
+	CONV_SETUP_\mode
 
-	convert240pFrameFast_frame_lp:
+	\name\()_frame_lp:
 		@ Load input and output addresses.
 		ldr  r0, =0x18200000                       @ r0 = 0x18200000;    // u32.
 		@ldr  r1, =0x18300000                       @ r1 = 0x18300000;    // u32.
 		add  r1,  r0, #0x100000                    @ r1 = r0 + 0x100000; // Note: ldr would be faster here (result latency). Saves 4 bytes.
 
 		@ Convert 8 lines each round until we have a whole frame.
-		convert240pFrameFast_8l_lp:
+		\name\()_8l_lp:
 			ldr  r4, =0x10111008                   @ r4 = &REG_LGYCAP1_STAT; // u32.
 			ldr  r5, =MPCORE_PRIV_BASE             @ r5 = MPCORE_PRIV_BASE;  // u32.
 
-			convert240pFrameFast_wait_irq:
+			\name\()_wait_irq:
 				@ Wait for LgyCap IRQs.
 				wfi                                @ __waitForInterrupt();
 
@@ -242,71 +273,58 @@ BEGIN_ASM_FUNC convert240pFrameFast
 				str  r7, [r5, #0x110]              @ REG_GICC_EOI = r7;     // u32.
 
 				@ Ignore DREQ IRQ for line 0.
-				beq convert240pFrameFast_wait_irq      @ if((r11>>16) == 0) goto convert240pFrameFast_wait_irq;
+				beq \name\()_wait_irq              @ if((r11>>16) == 0) goto wait_irq;
+#ifndef NDEBUG
+				CONV_TIMING_START
+#endif
 
-			convert240pFrameFast_skip_irq_wait:
+			\name\()_skip_irq_wait:
 			@ Load size of 8 lines in bytes.
-			mov  r3, #0x1680                       @ r3 = 0x1680;
-
-			@ Convert 8 pixels each round until we have 8 lines.
-			convert240pFrameFast_8p_lp:
-				@ Load 8 pixels from frame.
-				ldmia  r0!, {r8-r10, lr}           @ r8_to_r10_lr = *((_16BytesBlock*)r0); r0 += 16;
-
-				@ Decrement size and extract first 2 pixels.
-				subs r3,  r3, #16                  @ r3 -= 16;              // Updates flags.
-				and  r4, r12,  r8, lsr #1          @ r4 = 0x7FFF & (r8>>1); // r12 is 0x7FFF.
-				lsr  r5,  r8, #17                  @ r5 = r8>>17;
-
-				@ Look up pixel 1 and extract pixel 3.
-				ldr  r4, [r2,  r4, lsl #2]         @ r4 = r2[r4];           // u32.
-				and  r6, r12,  r9, lsr #1          @ r6 = 0x7FFF & (r9>>1); // r12 is 0x7FFF.
-
-				@ Look up pixel 2 and extract pixel 4.
-				ldr  r5, [r2,  r5, lsl #2]         @ r5 = r2[r5]; // u32.
-				lsr  r7,  r9, #17                  @ r7 = r9>>17;
-
-				@ Look up pixel 3 and extract pixel 5.
-				ldr  r6, [r2,  r6, lsl #2]         @ r6 = r2[r6];            // u32.
-				and  r8, r12, r10, lsr #1          @ r8 = 0x7FFF & (r10>>1); // r12 is 0x7FFF.
-
-				@ Look up pixel 4 and extract pixel 6.
-				ldr  r7, [r2,  r7, lsl #2]         @ r7 = r2[r7];  // u32.
-				lsr  r9, r10, #17                  @ r9 = r10>>17;
-
-				@ Look up pixel 5 and extract pixel 7.
-				ldr  r8, [r2,  r8, lsl #2]         @ r8 = r2[r8];            // u32.
-				and r10, r12,  lr, lsr #1          @ r10 = 0x7FFF & (lr>>1); // r12 is 0x7FFF.
-
-				@ Look up pixel 6 and extract pixel 8.
-				ldr  r9, [r2,  r9, lsl #2]         @ r9 = r2[r9]; // u32.
-				lsr  lr,  lr, #17                  @ lr = lr>>17;
-
-				@ Look up pixel 7 and 8.
-				ldr r10, [r2, r10, lsl #2]         @ r10 = r2[r10]; // u32.
-				ldr  lr, [r2,  lr, lsl #2]         @ lr = r2[lr];   // u32.
-
-				@ Prefetch next cache line, write 8 pixels and jump back if we are not done yet.
-				pld [r0, #32]                      @ Prefetch from r0 + 32. // Offset 32 is a tiny bit better. Most of the time the result is the same as 64.
-				stmia  r1!, {r4-r10, lr}           @ *((_32BytesBlock*)r1) = r4_to_r10_lr; r1 += 32;
-				bne convert240pFrameFast_8p_lp     @ if(r3 != 0) goto convert240pFrameFast_8p_lp;
-
-			@ Test if 8 line counter is 232, skip texture padding and jump back if we are not done yet.
-			cmp r11, #232                          @ r11 - 232; // Updates flags.
-			add  r0,  r0, #0x980                   @ r0 += 0x980;
-			add  r1,  r1, #0x1300                  @ r1 += 0x1300;
-			moveq r11, #240                        @ if(r11 == 232) r11 = 240;
-			beq convert240pFrameFast_skip_irq_wait @ if(r11 == 232) goto convert240pFrameFast_skip_irq_wait;
-			bls convert240pFrameFast_8l_lp         @ if(r11 <= 232) goto convert240pFrameFast_8l_lp;
-
-		@ Flush the D-Cache, wait for flush completion, notify core 0 and jump back.
+			mov  r3, #\bytes                       @ r3 = bytes;
+
+			CONV_PIXELS_\mode \name
+
+			@ Write back the converted lines and drop them and the input lines from the cache.
+			@ The LUT stays cached unlike with a whole cache clean.
+			sub  r4,  r1, #(\bytes * 2)            @ r4 = r1 - bytes * 2; // Start of the output lines.
+			sub  r5,  r0, #\bytes                  @ r5 = r0 - bytes;     // Start of the input lines.
+			\name\()_cache_lp:
+				mcr p15, 0, r4, c7, c14, 1         @ Clean and Invalidate Data Cache Line (using MVA).
+				add  r4,  r4, #32                  @ r4 += 32;
+				mcr p15, 0, r4, c7, c14, 1         @ Clean and Invalidate Data Cache Line (using MVA).
+				add  r4,  r4, #32                  @ r4 += 32;
+				mcr p15, 0, r5, c7, c6, 1          @ Invalidate Data Cache Line (using MVA).
+				add  r5,  r5, #32                  @ r5 += 32;
+				cmp  r5,  r0                       @ r5 - r0; // Updates flags.
+				blo \name\()_cache_lp              @ if(r5 < r0) goto cache_lp;
+			mcr p15, 0, r3, c7, c10, 4             @ Data Synchronization Barrier. // r3 is 0.
+
+			@ Test if 8 line counter is lines - 8, skip texture padding and jump back if we are not done yet.
+			cmp r11, #(\lines - 8)                 @ r11 - (lines - 8); // Updates flags.
+			add  r0,  r0, #(0x2000 - \bytes)       @ r0 += 512 * 8 * 2 - bytes;
+			add  r1,  r1, #(0x4000 - \bytes * 2)   @ r1 += 512 * 8 * 4 - bytes * 2;
+			moveq r11, #\lines                     @ if(r11 == lines - 8) r11 = lines;
+			beq \name\()_skip_irq_wait             @ if(r11 == lines - 8) goto skip_irq_wait;
+			bls \name\()_8l_lp                     @ if(r11 <= lines - 8) goto 8l_lp;
+
+#ifndef NDEBUG
+		CONV_TIMING_END
+#endif
+
+		@ Notify core 0. Lines have been written back already.
 		@ Note: r3 has been decremented down to 0 previously and so it's safe to use.
-		mcr p15, 0, r3, c7, c14, 0                 @ Clean and Invalidate Entire Data Cache.
 		ldr  r4, =MPCORE_PRIV_BASE                 @ r4 = MPCORE_PRIV_BASE;  // u32.
 		mov  r5, #0x10000                          @ r5 = 0x10000;
 		orr  r5,  r5, #0xF                         @ r5 |= 0xF;
 		add  r4,  r4, #0x1F00                      @ r4 += 0x1F00; // REG_GICD_SOFTINT.
 		mcr p15, 0, r3, c7, c10, 4                 @ Data Synchronization Barrier.
 		str  r5, [r4]                              @ *r4 = r5; // u32.
-		b convert240pFrameFast_frame_lp            @ goto convert240pFrameFast_frame_lp;
-END_ASM_FUNC
\ No newline at end of file
+		b \name\()_frame_lp                        @ goto frame_lp;
+END_ASM_FUNC
+.endm
+
+@ The 3D LUT and separable variants only differ in the pixel loop.
+CONVERT_FRAME convert160pFrameFast, 160, 0xF00,  LUT
+CONVERT_FRAME convert240pFrameFast, 240, 0x1680, LUT
+CONVERT_FRAME convert160pFrameSep,  160, 0xF00,  SEP
+CONVERT_FRAME convert240pFrameSep,  240, 0x1680, SEP
@@ -28,26 +28,47 @@
 
 
 // Notes on these settings:
-// MAX_ENT_BUF_SIZE should be big enough to hold the average file/dir name length * MAX_DIR_ENTRIES.
-#define MAX_ENT_BUF_SIZE  (1024u * 196) // 196 KiB.
-#define MAX_DIR_ENTRIES   (1000u)
-#define DIR_READ_BLOCKS   (10u)
+// DIR_LIST_BUF_SIZE is the same heap footprint as the old fixed 196 KiB entry buffer + 1000 pointers.
+// Names and pointers share it so there is no fixed entry limit. Allocated once since
+// growing with realloc() needs the old and new buffer at the same time.
+#define DIR_LIST_BUF_SIZE  (1024u * 196 + sizeof(char*) * 1000)
+#define DIR_READ_BLOCKS    (64u)
 #define SCREEN_COLS       (53u - 1) // - 1 because the console inserts a newline after the last line otherwise.
 #define SCREEN_ROWS       (24u)
 
 #define ENT_TYPE_FILE  (0)
 #define ENT_TYPE_DIR   (1)
 
+#define MAX_JUMPS           (2u * 256) // One per entry type and first character.
+#define MAX_PREFIX_LEN      (32u)
+#define SEARCH_CHARS        "abcdefghijklmnopqrstuvwxyz0123456789 -_.'!&()"
+
 
 typedef struct
 {
-	u32 num;                       // Total number of entries.
-	char entBuf[MAX_ENT_BUF_SIZE]; // Format: char entryType; char name[X]; // null terminated.
-	char *ptrs[MAX_DIR_ENTRIES];   // For fast sorting.
+	u32 num;        // Total number of entries.
+	bool truncated; // Not all entries fit.
+	char *entBuf;   // Format: char entryType; char name[X]; // null terminated. DIR_LIST_BUF_SIZE bytes.
+	char **ptrs;    // For fast sorting. Grows down from the end of entBuf.
+	u32 numDirs;   // Dirs are sorted before files.
+	u32 numJumps;
+	u16 jumps[MAX_JUMPS]; // First entry of each type + first character group. Used for L/R.
 } DirList;
 
+// A prefix match is one range in the dirs and one in the files.
+typedef struct
+{
+	u32 start[2];
+	u32 num[2];
+} DirView;
+
 
 
+static inline char lowerChar(const char c)
+{
+	return (c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c);
+}
+
 int dlistCompare(const void *a, const void *b)
 {
 	const char *entA = *(char**)a;
@@ -56,14 +77,52 @@ int dlistCompare(const void *a, const void *b)
 	// Compare the entry type. Dirs have priority over files.
 	if(*entA != *entB) return (int)*entB - *entA;
 
-	// Compare the string.
+	// Compare the string. Case insensitive so prefix matches are contiguous.
+	const char *const nameA = entA + 1;
+	const char *const nameB = entB + 1;
 	int res;
 	do
 	{
-		res = *++entA - *++entB;
+		res = (u8)lowerChar(*++entA) - (u8)lowerChar(*++entB);
 	} while(res == 0 && *entA != '\0' && *entB != '\0');
 
-	return res;
+	// Keep a stable order for names only differing in case.
+	return (res != 0 ? res : strcmp(nameA, nameB));
+}
+
+// Compares the first len characters of an entry name with a lowercase prefix.
+static int prefixCompare(const char *const entry, const char *const prefix, const u32 len)
+{
+	const char *name = &entry[1];
+	for(u32 i = 0; i < len; i++)
+	{
+		const int res = (u8)lowerChar(name[i]) - (u8)prefix[i];
+		if(res != 0 || name[i] == '\0') return res;
+	}
+
+	return 0;
+}
+
+// Builds the L/R jump table. The list must be sorted.
+static void dlistBuildJumps(DirList *const dList)
+{
+	u32 numDirs = 0;
+	u32 numJumps = 0;
+	const char *last = NULL;
+	for(u32 i = 0; i < dList->num; i++)
+	{
+		const char *const entry = dList->ptrs[i];
+		if(*entry == ENT_TYPE_DIR) numDirs++;
+
+		if(last == NULL || *last != *entry || lowerChar(last[1]) != lowerChar(entry[1]))
+		{
+			if(numJumps < MAX_JUMPS) dList->jumps[numJumps++] = i;
+			last = entry;
+		}
+	}
+
+	dList->numDirs  = numDirs;
+	dList->numJumps = numJumps;
 }
 
 static Result scanDir(const char *const path, DirList *const dList, const char *const filter)
@@ -72,6 +131,8 @@ static Result scanDir(const char *const path, DirList *const dList, const char *
 	if(fis == NULL) return RES_OUT_OF_MEM;
 
 	dList->num = 0;
+	dList->truncated = false;
+	dList->ptrs = (char**)&dList->entBuf[DIR_LIST_BUF_SIZE];
 
 	Result res;
 	DHandle dh;
@@ -80,11 +141,11 @@ static Result scanDir(const char *const path, DirList *const dList, const char *
 		u32 read;           // Number of entries read by fReadDir().
 		u32 numEntries = 0; // Total number of processed entries.
 		u32 entBufPos = 0;  // Entry buffer position/number of bytes used.
+		char **const ptrsEnd = dList->ptrs;
 		const u32 filterLen = strlen(filter);
 		do
 		{
 			if((res = fReadDir(dh, fis, DIR_READ_BLOCKS, &read)) != RES_OK) break;
-			read = (read <= MAX_DIR_ENTRIES - numEntries ? read : MAX_DIR_ENTRIES - numEntries);
 
 			for(u32 i = 0; i < read; i++)
 			{
@@ -98,44 +159,166 @@ static Result scanDir(const char *const path, DirList *const dList, const char *
 				}
 
 				// nameLen does not include the entry type and NULL termination.
-				if(entBufPos + nameLen + 2 > MAX_ENT_BUF_SIZE) goto scanEnd;
+				// The new pointer goes below the existing ones.
+				if(entBufPos + nameLen + 2 > DIR_LIST_BUF_SIZE - sizeof(char*) * (numEntries + 1))
+				{
+					dList->truncated = true;
+					goto scanEnd;
+				}
 
 				char *const entry = &dList->entBuf[entBufPos];
 				*entry = entType;
-				safeStrcpy(&entry[1], fis[i].fname, 256);
-				dList->ptrs[numEntries++] = entry;
+				safeStrcpy(&entry[1], fis[i].fname, nameLen + 1);
+				ptrsEnd[-(s32)++numEntries] = entry;
 				entBufPos += nameLen + 2;
 			}
 		} while(read == DIR_READ_BLOCKS);
 
 scanEnd:
 		dList->num = numEntries;
+		dList->ptrs = ptrsEnd - numEntries;
 
 		fCloseDir(dh);
 	}
 
 	free(fis);
 
+	return res;
+}
+
+static Result loadDirList(const char *const path, DirList *const dList, const char *const filter)
+{
+	const Result res = scanDir(path, dList, filter);
 	qsort(dList->ptrs, dList->num, sizeof(char*), dlistCompare);
+	dlistBuildJumps(dList);
 
 	return res;
 }
 
-static void showDirList(const DirList *const dList, u32 start)
+// Narrows a view down to the entries starting with prefix.
+// prefix[0 to len - 1] must already match all entries in the view.
+static void narrowView(const DirList *const dList, DirView *const view, const char *const prefix, const u32 len)
+{
+	for(u32 t = 0; t < 2; t++)
+	{
+		char *const *const ptrs = &dList->ptrs[view->start[t]];
+
+		// Lower bound.
+		u32 lo = 0, hi = view->num[t];
+		while(lo < hi)
+		{
+			const u32 mid = (lo + hi) / 2;
+			if(prefixCompare(ptrs[mid], prefix, len) < 0) lo = mid + 1;
+			else                                          hi = mid;
+		}
+		const u32 first = lo;
+
+		// Upper bound.
+		hi = view->num[t];
+		while(lo < hi)
+		{
+			const u32 mid = (lo + hi) / 2;
+			if(prefixCompare(ptrs[mid], prefix, len) <= 0) lo = mid + 1;
+			else                                           hi = mid;
+		}
+
+		view->start[t] += first;
+		view->num[t]    = lo - first;
+	}
+}
+
+static inline u32 viewCount(const DirView *const view)
+{
+	return view->num[0] + view->num[1];
+}
+
+// Returns the list index of a view entry.
+static inline u32 viewIndex(const DirView *const view, const u32 i)
+{
+	return (i < view->num[0] ? view->start[0] + i : view->start[1] + i - view->num[0]);
+}
+
+static void showDirList(const DirList *const dList, const DirView *const view, u32 start, const u32 rows)
 {
 	// Clear screen.
 	ee_printf("\x1b[2J");
 
-	const u32 listLength = (dList->num - start > SCREEN_ROWS ? start + SCREEN_ROWS : dList->num);
+	const u32 num = viewCount(view);
+	const u32 listLength = (num - start > rows ? start + rows : num);
 	for(u32 i = start; i < listLength; i++)
 	{
+		const char *const entry = dList->ptrs[viewIndex(view, i)];
 		const char *const printStr =
-			(*dList->ptrs[i] == ENT_TYPE_FILE ? "\x1b[%lu;H\x1b[37;1m %.52s" : "\x1b[%lu;H\x1b[33;1m %.52s");
+			(*entry == ENT_TYPE_FILE ? "\x1b[%lu;H\x1b[37;1m %.52s" : "\x1b[%lu;H\x1b[33;1m %.52s");
 
-		ee_printf(printStr, i - start + 1, &dList->ptrs[i][1]);
+		ee_printf(printStr, i - start + 1, &entry[1]);
 	}
 }
 
+// The search line replaces the truncation warning while searching.
+static void showStatusLine(const DirList *const dList, const char *const prefix, const char candidate,
+                           const bool searching)
+{
+	char line[SCREEN_COLS + 1];
+	u32 len;
+	if(searching || prefix[0] != '\0')
+		len = ee_snprintf(line, sizeof(line), (searching ? " Find: %s[%c]" : " Find: %s"), prefix, candidate);
+	else
+		len = ee_snprintf(line, sizeof(line), " Too many files. Only %lu are shown.", dList->num);
+	len = (len > SCREEN_COLS ? SCREEN_COLS : len);
+
+	// Overwrite the old line.
+	memset(&line[len], ' ', SCREEN_COLS - len);
+	line[SCREEN_COLS] = '\0';
+	ee_printf("\x1b[%lu;H\x1b[36;1m%s", SCREEN_ROWS, line);
+}
+
+// Returns the view position of a list index or -1 if it is not part of the view.
+static s32 viewFind(const DirView *const view, const u32 idx)
+{
+	for(u32 t = 0, offset = 0; t < 2; offset += view->num[t], t++)
+	{
+		if(idx >= view->start[t] && idx < view->start[t] + view->num[t])
+			return offset + idx - view->start[t];
+	}
+
+	return -1;
+}
+
+// Moves to the next/previous group of entries starting with the same character.
+static s32 jumpGroup(const DirList *const dList, const DirView *const view, const s32 cursorPos, const bool forward)
+{
+	const u32 cur = viewIndex(view, cursorPos);
+	s32 newPos = (forward ? cursorPos : 0);
+	if(forward)
+	{
+		for(u32 i = 0; i < dList->numJumps; i++)
+		{
+			const s32 pos = viewFind(view, dList->jumps[i]);
+			if(dList->jumps[i] > cur && pos >= 0)
+			{
+				newPos = pos;
+				break;
+			}
+		}
+	}
+	else
+	{
+		// Start of the current group or the previous one if already there.
+		for(u32 i = dList->numJumps; i > 0; i--)
+		{
+			const s32 pos = viewFind(view, dList->jumps[i - 1]);
+			if(dList->jumps[i - 1] < cur && pos >= 0)
+			{
+				newPos = pos;
+				break;
+			}
+		}
+	}
+
+	return newPos;
+}
+
 Result browseFiles(const char *const basePath, char selected[512])
 {
 	if(basePath == NULL || selected == NULL) return RES_INVALID_ARG;
@@ -145,18 +328,51 @@ Result browseFiles(const char *const basePath, char selected[512])
 	if(curDir == NULL) return RES_OUT_OF_MEM;
 	safeStrcpy(curDir, basePath, 512);
 
-	DirList *const dList = (DirList*)malloc(sizeof(DirList));
-	if(dList == NULL) return RES_OUT_OF_MEM;
+	DirList *const dList = (DirList*)calloc(1, sizeof(DirList));
+	char *const entBuf = (char*)malloc(DIR_LIST_BUF_SIZE);
+	if(dList == NULL || entBuf == NULL)
+	{
+		free(entBuf);
+		free(dList);
+		free(curDir);
+		return RES_OUT_OF_MEM;
+	}
+	dList->entBuf = entBuf;
 
-	Result res;
-	if((res = scanDir(curDir, dList, ".gba")) != RES_OK) goto end;
-	showDirList(dList, 0);
+	// Type-ahead search. Each prefix length has its own view so deleting
+	// a character is free and adding one only searches the current view.
+	char prefix[MAX_PREFIX_LEN + 1] = {0};
+	u32 prefixLen = 0;
+	DirView views[MAX_PREFIX_LEN + 1];
+	bool searching = false;
+	u32 candidate = 0; // Index in SEARCH_CHARS.
 
+	Result res;
+	bool reload = true;
 	s32 cursorPos = 0; // Within the entire list.
 	u32 windowPos = 0; // Window start position within the list.
 	s32 oldCursorPos = 0;
 	while(1)
 	{
+		if(reload)
+		{
+			if((res = loadDirList(curDir, dList, ".gba")) != RES_OK) break;
+			reload = false;
+
+			views[0].start[0] = 0;
+			views[0].num[0]   = dList->numDirs;
+			views[0].start[1] = dList->numDirs;
+			views[0].num[1]   = dList->num - dList->numDirs;
+			prefix[0] = '\0';
+			prefixLen = 0;
+			searching = false;
+			cursorPos = 0;
+			windowPos = 0;
+			oldCursorPos = 0;
+			showDirList(dList, &views[0], 0, (dList->truncated ? SCREEN_ROWS - 1 : SCREEN_ROWS));
+			if(dList->truncated) showStatusLine(dList, prefix, SEARCH_CHARS[candidate], searching);
+		}
+
 		ee_printf("\x1b[%lu;H ", oldCursorPos - windowPos + 1);      // Clear old cursor.
 		ee_printf("\x1b[%lu;H\x1b[37m>", cursorPos - windowPos + 1); // Draw cursor.
 		GFX_flushBuffers();
@@ -171,20 +387,71 @@ Result browseFiles(const char *const basePath, char selected[512])
 			kDown = hidKeysDown();
 		} while(kDown == 0);
 
-		const u32 num = dList->num;
+		const u32 oldPrefixLen = prefixLen;
+		const bool wasSearching = searching;
+		if(searching)
+		{
+			// LEFT/RIGHT pick a character, A adds it and B deletes the last one.
+			const u32 numChars = sizeof(SEARCH_CHARS) - 1;
+			if(kDown & KEY_DRIGHT) candidate = (candidate + 1) % numChars;
+			if(kDown & KEY_DLEFT)  candidate = (candidate + numChars - 1) % numChars;
+			if((kDown & KEY_A) && prefixLen < MAX_PREFIX_LEN)
+			{
+				prefix[prefixLen] = SEARCH_CHARS[candidate];
+				views[prefixLen + 1] = views[prefixLen];
+				narrowView(dList, &views[prefixLen + 1], prefix, prefixLen + 1);
+				prefix[++prefixLen] = '\0';
+			}
+			if(kDown & KEY_B)
+			{
+				if(prefixLen > 0) prefix[--prefixLen] = '\0';
+				else              searching = false;
+			}
+			if(kDown & (KEY_X | KEY_START)) searching = false;
+
+			// Only cursor movement is left for the list.
+			kDown &= KEY_DUP | KEY_DDOWN;
+		}
+		else if(kDown & KEY_X)
+		{
+			searching = true;
+			kDown = 0;
+		}
+		else if((kDown & KEY_B) && prefixLen > 0)
+		{
+			// Clear the search before leaving the dir.
+			prefix[0] = '\0';
+			prefixLen = 0;
+			kDown = 0;
+		}
+
+		const DirView *const view = &views[prefixLen];
+		const bool statusLine = searching || prefixLen > 0 || dList->truncated;
+		const u32 rows = (statusLine ? SCREEN_ROWS - 1 : SCREEN_ROWS);
+		const u32 num = viewCount(view);
+		bool redraw = false;
+		if(prefixLen != oldPrefixLen || searching != wasSearching)
+		{
+			cursorPos = (prefixLen != oldPrefixLen ? 0 : cursorPos);
+			oldCursorPos = cursorPos;
+			redraw = true;
+		}
+
 		if(num != 0)
 		{
 			oldCursorPos = cursorPos;
 			if(kDown & KEY_DRIGHT)
 			{
-				cursorPos += SCREEN_ROWS;
+				cursorPos += rows;
 				if((u32)cursorPos > num) cursorPos = num - 1;
 			}
 			if(kDown & KEY_DLEFT)
 			{
-				cursorPos -= SCREEN_ROWS;
+				cursorPos -= rows;
 				if(cursorPos < -1) cursorPos = 0;
 			}
+			if(kDown & KEY_R)      cursorPos = jumpGroup(dList, view, cursorPos, true);
+			if(kDown & KEY_L)      cursorPos = jumpGroup(dList, view, cursorPos, false);
 			if(kDown & KEY_DUP)    cursorPos -= 1;
 			if(kDown & KEY_DDOWN)  cursorPos += 1;
 		}
@@ -195,13 +462,20 @@ Result browseFiles(const char *const basePath, char selected[512])
 		if((u32)cursorPos < windowPos)
 		{
 			windowPos = cursorPos;
-			showDirList(dList, windowPos);
+			redraw = true;
 		}
-		if((u32)cursorPos >= windowPos + SCREEN_ROWS)
+		if((u32)cursorPos >= windowPos + rows)
 		{
-			windowPos = cursorPos - (SCREEN_ROWS - 1);
-			showDirList(dList, windowPos);
+			windowPos = cursorPos - (rows - 1);
+			redraw = true;
 		}
+		if(redraw)
+		{
+			// The old cursor may not be on screen anymore.
+			oldCursorPos = cursorPos;
+			showDirList(dList, view, windowPos, rows);
+		}
+		if(statusLine) showStatusLine(dList, prefix, SEARCH_CHARS[candidate], searching);
 
 		if(kDown & (KEY_A | KEY_B))
 		{
@@ -209,11 +483,13 @@ Result browseFiles(const char *const basePath, char selected[512])
 
 			if(kDown & KEY_A && num != 0)
 			{
+				const char *const entry = dList->ptrs[viewIndex(view, cursorPos)];
+
 				// TODO: !!! Insecure !!!
 				if(curDir[pathLen - 1] != '/') curDir[pathLen++] = '/';
-				safeStrcpy(curDir + pathLen, &dList->ptrs[cursorPos][1], 256);
+				safeStrcpy(curDir + pathLen, &entry[1], 256);
 
-				if(*dList->ptrs[cursorPos] == ENT_TYPE_FILE)
+				if(*entry == ENT_TYPE_FILE)
 				{
 					safeStrcpy(selected, curDir, 512);
 					break;
@@ -227,14 +503,12 @@ Result browseFiles(const char *const basePath, char selected[512])
 				*tmpPathPtr = '\0';
 			}
 
-			if((res = scanDir(curDir, dList, ".gba")) != RES_OK) break;
-			cursorPos = 0;
-			windowPos = 0;
-			showDirList(dList, 0);
+			reload = true;
 		}
 	}
 
 end:
+	free(dList->entBuf);
 	free(dList);
 	free(curDir);
 
@@ -242,4 +516,4 @@ end:
 	ee_printf("\x1b[2J");
 
 	return res;
-}
\ No newline at end of file
+}
@@ -0,0 +1,116 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/frame_pacing.h"
+#include "drivers/gfx.h"
+#include "arm11/fmt.h"
+
+
+// Render + PPF transfer takes well under 1 ms (~25 lines).
+#define PACING_GUARD_LINES  (32u)
+
+
+static u8 g_policy = PACING_LOW_LATENCY;
+static u16 g_vblankLine = 0;  // V_COUNT right after the VBlank IRQ.
+static u32 g_vTotal = 0;      // Original V_TOTAL register value.
+static FramePacingStats g_stats;
+
+
+
+void framePacingInit(const u8 policy)
+{
+	g_policy = policy;
+	g_vTotal = REG_PDC0_V_TOTAL;
+
+	// V_COUNT semantics don't matter if we measure relative to VBlank.
+	GFX_waitForVBlank0();
+	g_vblankLine = REG_PDC0_V_COUNT;
+
+	framePacingResetStats();
+	g_stats.lines  = g_vTotal + 1; // The register holds the last line.
+	g_stats.target = 0xFFFF;       // Locked on the first frame.
+}
+
+static u16 measurePhase(void)
+{
+	const u32 lines = g_stats.lines;
+	s32 phase = (s32)REG_PDC0_V_COUNT - g_vblankLine;
+	if(phase < 0) phase += lines;
+
+	return (u16)((u32)phase < lines ? (u32)phase : lines - 1);
+}
+
+void framePacingFrameReady(void)
+{
+	FramePacingStats *const stats = &g_stats;
+	const u16 phase = measurePhase();
+	stats->phase = phase;
+	stats->minPhase = (phase < stats->minPhase ? phase : stats->minPhase);
+	stats->maxPhase = (phase > stats->maxPhase ? phase : stats->maxPhase);
+	stats->frames++;
+
+	switch(g_policy)
+	{
+		case PACING_SMOOTH:
+			// Close to the next VBlank it's random if the swap makes it.
+			// Always wait instead so the frame gets a consistent latency of 1 LCD frame.
+			if(phase >= stats->lines - PACING_GUARD_LINES) GFX_waitForVBlank0();
+			break;
+		case PACING_LCD_SYNC:
+		{
+			// The LCD is slightly faster than the GBA so the phase keeps growing.
+			// One extra line per LCD frame is more than enough to pull it back.
+			// Bang-bang control keeps the phase within about 1 line of the target.
+			if(stats->target == 0xFFFF) stats->target = phase;
+
+			// Shortest distance with wrap around.
+			s32 error = (s32)phase - stats->target;
+			const s32 half = stats->lines / 2;
+			if(error > half)   error -= stats->lines;
+			if(error < -half)  error += stats->lines;
+
+			const bool stretch = error > 0;
+			REG_PDC0_V_TOTAL = g_vTotal + stretch;
+			stats->stretched += stretch;
+			break;
+		}
+		default: // PACING_LOW_LATENCY.
+			break;
+	}
+}
+
+const FramePacingStats* framePacingGetStats(void)
+{
+	return &g_stats;
+}
+
+void framePacingResetStats(void)
+{
+	FramePacingStats *const stats = &g_stats;
+	stats->minPhase  = 0xFFFF;
+	stats->maxPhase  = 0;
+	stats->stretched = 0;
+	stats->frames    = 0;
+}
+
+void framePacingExit(void)
+{
+	if(g_vTotal != 0) REG_PDC0_V_TOTAL = g_vTotal;
+	g_policy = PACING_LOW_LATENCY;
+}
@@ -0,0 +1,273 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/game_profiles.h"
+#include "fs.h"
+#include "oaf_error_codes.h"
+#include "arm11/fmt.h"
+
+
+#define GAME_PROFILES_MAGIC     (0x4746414Fu) // "OAFG"
+#define GAME_PROFILES_VERSION   (3u)
+#define GAME_PROFILES_TMP_PATH  "profiles.tmp"
+#define GAME_PROFILES_BUCKETS   (GAME_PROFILES_MAX * 2) // Fixed so profiles never move.
+static_assert((GAME_PROFILES_BUCKETS & (GAME_PROFILES_BUCKETS - 1)) == 0, "Error: GAME_PROFILES_BUCKETS must be a power of 2!");
+
+
+// File layout: Header, u16 buckets[numBuckets], GameProfile profiles[numProfiles].
+// A bucket holds the profile index + 1 (0 = empty). Collisions use linear probing.
+// New profiles are appended and made visible by the header write last.
+// Anything after the last profile is left over from an interrupted append.
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 numBuckets;  // Always GAME_PROFILES_BUCKETS.
+	u32 numProfiles;
+	u32 reserved;
+} GameProfilesHeader;
+
+
+
+static u64 hashName(const char *const cfgPath)
+{
+	const char *name = strrchr(cfgPath, '/');
+	name = (name != NULL ? name + 1 : cfgPath);
+
+	// 64 bit FNV-1a.
+	u64 hash = 14695981039346656037u;
+	while(*name != '\0')
+	{
+		hash ^= (u8)*name++;
+		hash *= 1099511628211u;
+	}
+
+	return hash;
+}
+
+static u32 profileOffset(const u32 idx)
+{
+	return sizeof(GameProfilesHeader) + sizeof(u16) * GAME_PROFILES_BUCKETS + sizeof(GameProfile) * idx;
+}
+
+// valid is false if the file is not a profile store.
+static Result readHeader(const FHandle f, GameProfilesHeader *const hdr, bool *const valid)
+{
+	*valid = false;
+
+	u32 read;
+	const Result res = fRead(f, hdr, sizeof(GameProfilesHeader), &read);
+	if(res != RES_OK) return res;
+
+	*valid = read == sizeof(GameProfilesHeader) && hdr->magic == GAME_PROFILES_MAGIC &&
+	         hdr->version == GAME_PROFILES_VERSION && hdr->numBuckets == GAME_PROFILES_BUCKETS &&
+	         hdr->numProfiles <= GAME_PROFILES_MAX && fSize(f) >= profileOffset(hdr->numProfiles);
+
+	return RES_OK;
+}
+
+static Result readBuckets(const FHandle f, u16 *const buckets)
+{
+	u32 read;
+	const u32 bucketsSize = sizeof(u16) * GAME_PROFILES_BUCKETS;
+	Result res = fLseek(f, sizeof(GameProfilesHeader));
+	if(res == RES_OK) res = fRead(f, buckets, bucketsSize, &read);
+	if(res == RES_OK && read != bucketsSize) res = RES_FR_DISK_ERR;
+
+	return res;
+}
+
+// Returns the profile index or -1 if not found.
+// Only the header, bucket table and matching profiles are read.
+static s32 findProfile(const u64 nameHash, GameProfile *const profile)
+{
+	FHandle f;
+	if(fOpen(&f, GAME_PROFILES_PATH, FA_OPEN_EXISTING | FA_READ) != RES_OK) return -1;
+
+	s32 found = -1;
+	u16 *buckets = NULL;
+	do
+	{
+		GameProfilesHeader hdr;
+		bool valid;
+		if(readHeader(f, &hdr, &valid) != RES_OK || !valid) break;
+
+		if((buckets = (u16*)malloc(sizeof(u16) * GAME_PROFILES_BUCKETS)) == NULL) break;
+		if(readBuckets(f, buckets) != RES_OK) break;
+
+		const u32 mask = GAME_PROFILES_BUCKETS - 1;
+		for(u32 b = (u32)nameHash & mask; buckets[b] != 0; b = (b + 1) & mask)
+		{
+			const u32 idx = buckets[b] - 1u;
+			if(idx >= hdr.numProfiles) break;
+
+			if(fLseek(f, profileOffset(idx)) != RES_OK) break;
+			GameProfile tmp;
+			u32 read;
+			if(fRead(f, &tmp, sizeof(GameProfile), &read) != RES_OK || read != sizeof(GameProfile)) break;
+			if(tmp.nameHash == nameHash)
+			{
+				*profile = tmp;
+				found = idx;
+				break;
+			}
+		}
+	} while(0);
+
+	free(buckets);
+	fClose(f);
+
+	return found;
+}
+
+static Result writeAt(const FHandle f, const u32 offset, const void *const buf, const u32 size)
+{
+	u32 written;
+	Result res = fLseek(f, offset);
+	if(res == RES_OK) res = fWrite(f, buf, size, &written);
+	if(res == RES_OK && written != size) res = RES_FR_DENIED; // Most likely the SD card is full.
+
+	return res;
+}
+
+// Only used if there is no valid store. Profiles in a broken file are lost anyway.
+static Result createStore(const GameProfile *const profile)
+{
+	u16 *const buckets = (u16*)calloc(GAME_PROFILES_BUCKETS, sizeof(u16));
+	if(buckets == NULL) return RES_OUT_OF_MEM;
+	buckets[(u32)profile->nameHash & (GAME_PROFILES_BUCKETS - 1)] = 1;
+
+	const GameProfilesHeader hdr = {GAME_PROFILES_MAGIC, GAME_PROFILES_VERSION, GAME_PROFILES_BUCKETS, 1, 0};
+
+	// Write to a temporary file first so an interrupted write
+	// never leaves a broken store with a valid name behind.
+	FHandle f;
+	Result res = fOpen(&f, GAME_PROFILES_TMP_PATH, FA_CREATE_ALWAYS | FA_WRITE);
+	if(res == RES_OK)
+	{
+		res = writeAt(f, 0, &hdr, sizeof(hdr));
+		if(res == RES_OK) res = writeAt(f, sizeof(hdr), buckets, sizeof(u16) * GAME_PROFILES_BUCKETS);
+		if(res == RES_OK) res = writeAt(f, profileOffset(0), profile, sizeof(GameProfile));
+		fClose(f);
+
+		if(res == RES_OK)
+		{
+			fUnlink(GAME_PROFILES_PATH);
+			res = fRename(GAME_PROFILES_TMP_PATH, GAME_PROFILES_PATH);
+		}
+		else fUnlink(GAME_PROFILES_TMP_PATH);
+	}
+	free(buckets);
+
+	return res;
+}
+
+// Replaces profile idx or appends a new one (idx < 0) in place.
+// The store is only recreated if it is missing or not a valid store.
+static Result storeProfile(const GameProfile *const profile, const s32 idx)
+{
+	FHandle f;
+	Result res = fOpen(&f, GAME_PROFILES_PATH, FA_OPEN_EXISTING | FA_READ | FA_WRITE);
+	if(res == RES_FR_NO_FILE) return createStore(profile);
+	if(res != RES_OK) return res;
+
+	GameProfilesHeader hdr;
+	bool valid;
+	res = readHeader(f, &hdr, &valid);
+	if(res == RES_OK && !valid)
+	{
+		fClose(f);
+		return createStore(profile);
+	}
+
+	u16 *buckets = NULL;
+	do
+	{
+		if(res != RES_OK) break;
+
+		if(idx >= 0 && (u32)idx < hdr.numProfiles)
+		{
+			res = writeAt(f, profileOffset(idx), profile, sizeof(GameProfile));
+			break;
+		}
+
+		if(hdr.numProfiles >= GAME_PROFILES_MAX)
+		{
+			res = RES_OUT_OF_RANGE;
+			break;
+		}
+
+		if((buckets = (u16*)malloc(sizeof(u16) * GAME_PROFILES_BUCKETS)) == NULL)
+		{
+			res = RES_OUT_OF_MEM;
+			break;
+		}
+		if((res = readBuckets(f, buckets)) != RES_OK) break;
+
+		// Buckets pointing past the last profile are from an interrupted append.
+		const u32 mask = GAME_PROFILES_BUCKETS - 1;
+		u32 b = (u32)profile->nameHash & mask;
+		u32 probes = 0;
+		while(buckets[b] != 0 && buckets[b] <= hdr.numProfiles && probes++ < GAME_PROFILES_BUCKETS)
+			b = (b + 1) & mask;
+		if(probes > GAME_PROFILES_BUCKETS)
+		{
+			res = RES_OUT_OF_RANGE;
+			break;
+		}
+
+		// Profile, bucket and header last. An interrupted append is ignored on the next read.
+		const u16 bucket = hdr.numProfiles + 1;
+		res = writeAt(f, profileOffset(hdr.numProfiles), profile, sizeof(GameProfile));
+		if(res == RES_OK) res = writeAt(f, sizeof(hdr) + sizeof(u16) * b, &bucket, sizeof(u16));
+		hdr.numProfiles++;
+		if(res == RES_OK) res = writeAt(f, 0, &hdr, sizeof(hdr));
+	} while(0);
+
+	free(buckets);
+	fClose(f);
+
+	return res;
+}
+
+Result loadGameProfile(const char *const cfgPath, OafConfig *const cfg, const bool reimport)
+{
+	GameProfile profile;
+	profile.nameHash = hashName(cfgPath);
+
+	const s32 idx = findProfile(profile.nameHash, &profile);
+	if(idx >= 0 && !reimport)
+	{
+		applyOafConfigValues(cfg, &profile.values);
+		return (profile.values.num > 0 ? RES_OK : RES_FR_NO_FILE);
+	}
+
+	// Import the .ini. A missing file results in an empty profile.
+	const Result res = parseOafConfigValues(cfgPath, &profile.values);
+	if(res != RES_OK && res != RES_FR_NO_FILE) return res;
+
+	const Result storeRes = storeProfile(&profile, idx);
+	if(storeRes != RES_OK) debug_printf("Failed to store game profile: %s\n", oafResult2String(storeRes));
+
+	applyOafConfigValues(cfg, &profile.values);
+
+	return res;
+}
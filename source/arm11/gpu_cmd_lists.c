@@ -16,215 +16,443 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+
 #include <string.h>
 #include "types.h"
 #include "arm11/gpu_cmd_lists.h"
 #include "drivers/cache.h"
 
 
-// 360x240 without scaling, no filter.
-alignas(16) u8 gbaGpuInitList[GBA_INIT_LIST_SIZE] =
-{
-	0x01, 0x00, 0x00, 0x00, 0x10, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x06, 0x03,
-	0x1C, 0x01, 0x2F, 0x80, 0x00, 0x00, 0x03, 0x03, 0xF0, 0xF0, 0x18, 0x01,
-	0xF0, 0xF0, 0x18, 0x01, 0x6E, 0x00, 0x0F, 0x00, 0x03, 0x00, 0x00, 0x00,
-	0x16, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x01, 0x00, 0x17, 0x01, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x1B, 0x01, 0x0F, 0x00, 0x0F, 0x00, 0x00, 0x00,
-	0x12, 0x01, 0x3F, 0x80, 0x0F, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
-	0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x45, 0x00,
-	0x41, 0x00, 0x3F, 0x80, 0x12, 0x11, 0x11, 0x38, 0x00, 0x90, 0x46, 0x00,
-	0x14, 0xAE, 0x47, 0x37, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x68, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x65, 0x00, 0x2F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x29, 0x02, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x53, 0x02, 0x03, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x44, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0xCB, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x4E, 0xCC, 0x02, 0x7F, 0x00,
-	0x01, 0xF0, 0x07, 0x4E, 0x02, 0x08, 0x02, 0x08, 0x03, 0x18, 0x02, 0x08,
-	0x04, 0x28, 0x02, 0x08, 0x05, 0x38, 0x02, 0x08, 0x06, 0x10, 0x20, 0x4C,
-	0x00, 0x00, 0x00, 0x88, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0xBF, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD5, 0x02, 0x0F, 0x00,
-	0x6E, 0x03, 0x00, 0x00, 0xD6, 0x02, 0x6F, 0x00, 0xA1, 0x0A, 0x00, 0x00,
-	0x68, 0xC3, 0x06, 0x00, 0x64, 0xC3, 0x06, 0x00, 0x62, 0xC3, 0x06, 0x00,
-	0x61, 0xC3, 0x06, 0x00, 0x6F, 0x03, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x7F,
-	0xBA, 0x02, 0x0F, 0x00, 0x03, 0x00, 0x00, 0x00, 0xBD, 0x02, 0x0F, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x4A, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x51, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00, 0x5E, 0x02, 0x01, 0x00,
-	0x02, 0x00, 0x00, 0x00, 0x4F, 0x00, 0x7F, 0x80, 0x00, 0x01, 0x02, 0x03,
-	0x0C, 0x0D, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
-	0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F, 0x1F,
-	0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x64, 0x00, 0x0F, 0x00,
-	0x01, 0x01, 0x00, 0x00, 0x6F, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x29, 0x02, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x00, 0x52, 0x02, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x54, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x00, 0xA0,
-	0x89, 0x02, 0x0F, 0x00, 0x7B, 0x00, 0x00, 0x00, 0x01, 0x02, 0x1F, 0x80,
-	0x00, 0x00, 0xFC, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0xA0,
-	0xB9, 0x02, 0x0B, 0x00, 0x01, 0x00, 0x00, 0x00, 0x42, 0x02, 0x0F, 0x00,
-	0x10, 0x00, 0x00, 0x00, 0xBB, 0x02, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x6D, 0x00, 0x0F, 0x00,
-	0x02, 0x00, 0x00, 0x00, 0x40, 0x00, 0x0F, 0x00, 0x00, 0x00, 0xBF, 0x00,
-	0x4D, 0x00, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x10, 0x00, 0x00, 0x00, 0x04, 0x01, 0x3F, 0x80, 0x10, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x10, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x26, 0x01, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x03, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x76, 0x76, 0x01, 0x01, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x02, 0x01, 0x0F, 0x00, 0x00, 0x01, 0xE4, 0x00,
-	0x00, 0x01, 0x07, 0x00, 0x00, 0x3C, 0x00, 0x80, 0x30, 0x01, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x62, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x18, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x61, 0x00, 0x01, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x6A, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x81, 0x00, 0x4F, 0x80, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, // Last 4 bytes: GPUREG_TEXUNIT0_PARAM.
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03, 0x02, 0x00, 0x00, 0x00, // Last 4 bytes: GPUREG_TEXUNIT0_TYPE.
-	0x8E, 0x00, 0x0F, 0x00, 0x01, 0x10, 0x01, 0x00, 0x80, 0x00, 0x0B, 0x00,
-	0x00, 0x00, 0x01, 0x00, 0x80, 0x00, 0x04, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x8B, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x00, 0x07, 0x00,
-	0xFF, 0xFF, 0xFF, 0xFF, 0xFD, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0xE1, 0x00, 0x0F, 0x00, 0x03, 0x00, 0x03, 0x00, 0xC0, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xC8, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xD0, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xD8, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xF0, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x0F, 0x00, 0x0F, 0x00, 0xF8, 0x00, 0x4F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF,
-	0x00, 0x00, 0x00, 0x00, 0x5F, 0x00, 0x00, 0x00, 0xC0, 0x02, 0x3F, 0x80,
-	0xBF, 0x00, 0x00, 0x3E, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0xC0, 0x02, 0x0F, 0x00,
-	0x00, 0x00, 0x80, 0xBF, 0xC1, 0x02, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x89, 0x88, 0x08, 0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3F,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0A, 0xD7, 0xA3, 0xBB,
-	0x00, 0x00, 0x80, 0xBF, 0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0xFF, 0x7F, 0xB0, 0x02, 0x0F, 0x00, 0x00, 0x01, 0x00, 0x00,
-	0x5E, 0x02, 0x02, 0x00, 0x01, 0x00, 0x00, 0x00, 0x5F, 0x02, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x80, 0x27, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x53, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x45, 0x02, 0x01, 0x00,
-	0x0F, 0x00, 0x00, 0x00, 0x32, 0x02, 0x0F, 0x00, 0x3E, 0x00, 0x00, 0x3F,
-	0x33, 0x02, 0x2F, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x43, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80, 0x10, 0x3E, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x7C, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x33, 0x02, 0x2F, 0x80, 0x10, 0x3E, 0x00, 0x00, 0x00, 0x68, 0x3E, 0x00,
-	0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80, 0xE0, 0x46, 0x00, 0x00,
-	0x00, 0x40, 0x43, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80,
-	0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x3F,
-	0x33, 0x02, 0x2F, 0x80, 0xE0, 0x46, 0x00, 0x00, 0x00, 0x7C, 0x47, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80, 0x00, 0x3F, 0x00, 0x00,
-	0x00, 0x68, 0x3E, 0x00, 0x01, 0x00, 0x00, 0x00, 0x45, 0x02, 0x01, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x53, 0x02, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x31, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00, 0x11, 0x01, 0x0F, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x10, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x63, 0x00, 0x0F, 0x00, 0x78, 0x56, 0x34, 0x12, 0x10, 0x00, 0x0F, 0x00,
-	0x78, 0x56, 0x34, 0x12, 0x10, 0x00, 0x0F, 0x00
+// PICA200 command header. The first parameter is stored before the header.
+#define CMD_HDR(reg, mask, extra, seq)  ((u32)(reg) | (u32)(mask)<<16 | (u32)(extra)<<20 | (u32)(seq)<<31)
+
+// Registers used below. Names from 3dbrew.
+#define GPUREG_FINALIZE                   (0x010)
+#define GPUREG_FACECULLING_CONFIG         (0x040)
+#define GPUREG_VIEWPORT_WIDTH             (0x041) // 4 registers.
+#define GPUREG_DEPTHMAP_SCALE             (0x04D) // 2 registers.
+#define GPUREG_SH_OUTMAP_TOTAL            (0x04F) // 8 registers.
+#define GPUREG_EARLYDEPTH_FUNC            (0x061)
+#define GPUREG_EARLYDEPTH_TEST1           (0x062)
+#define GPUREG_EARLYDEPTH_CLEAR           (0x063)
+#define GPUREG_SH_OUTATTR_MODE            (0x064)
+#define GPUREG_SCISSORTEST_MODE           (0x065) // 3 registers.
+#define GPUREG_VIEWPORT_XY                (0x068)
+#define GPUREG_EARLYDEPTH_DATA            (0x06A)
+#define GPUREG_DEPTHMAP_ENABLE            (0x06D)
+#define GPUREG_RENDERBUF_DIM              (0x06E)
+#define GPUREG_SH_OUTATTR_CLOCK           (0x06F)
+#define GPUREG_TEXUNIT_CONFIG             (0x080)
+#define GPUREG_TEXUNIT0_BORDER_COLOR      (0x081) // 5 registers.
+#define GPUREG_TEXUNIT0_SHADOW            (0x08B)
+#define GPUREG_TEXUNIT0_TYPE              (0x08E)
+#define GPUREG_TEXENV0_SOURCE             (0x0C0) // 5 registers for each stage.
+#define GPUREG_TEXENV1_SOURCE             (0x0C8)
+#define GPUREG_TEXENV2_SOURCE             (0x0D0)
+#define GPUREG_TEXENV3_SOURCE             (0x0D8)
+#define GPUREG_TEXENV_UPDATE_BUFFER       (0x0E0)
+#define GPUREG_FOG_COLOR                  (0x0E1)
+#define GPUREG_TEXENV4_SOURCE             (0x0F0)
+#define GPUREG_TEXENV5_SOURCE             (0x0F8)
+#define GPUREG_TEXENV_BUFFER_COLOR        (0x0FD)
+#define GPUREG_COLOR_OPERATION            (0x100)
+#define GPUREG_BLEND_FUNC                 (0x101)
+#define GPUREG_LOGIC_OP                   (0x102)
+#define GPUREG_BLEND_COLOR                (0x103)
+#define GPUREG_FRAGOP_ALPHA_TEST          (0x104) // 4 registers.
+#define GPUREG_FRAMEBUFFER_INVALIDATE     (0x110)
+#define GPUREG_FRAMEBUFFER_FLUSH          (0x111)
+#define GPUREG_COLORBUFFER_READ           (0x112) // 4 registers.
+#define GPUREG_DEPTHBUFFER_FORMAT         (0x116)
+#define GPUREG_COLORBUFFER_FORMAT         (0x117)
+#define GPUREG_EARLYDEPTH_TEST2           (0x118)
+#define GPUREG_FRAMEBUFFER_BLOCK32        (0x11B)
+#define GPUREG_DEPTHBUFFER_LOC            (0x11C) // 3 registers.
+#define GPUREG_GAS_DELTAZ_DEPTH           (0x126)
+#define GPUREG_FRAGOP_SHADOW              (0x130)
+#define GPUREG_ATTRIBBUFFERS_FORMAT_LOW   (0x201) // 2 registers.
+#define GPUREG_INDEXBUFFER_CONFIG         (0x227)
+#define GPUREG_GEOSTAGE_CONFIG            (0x229)
+#define GPUREG_VTX_FUNC                   (0x231)
+#define GPUREG_FIXEDATTRIB_INDEX          (0x232)
+#define GPUREG_FIXEDATTRIB_DATA0          (0x233) // 3 registers.
+#define GPUREG_VSH_NUM_ATTR               (0x242)
+#define GPUREG_VSH_COM_MODE               (0x244)
+#define GPUREG_START_DRAW_FUNC0           (0x245)
+#define GPUREG_VSH_OUTMAP_TOTAL1          (0x24A)
+#define GPUREG_VSH_OUTMAP_TOTAL2          (0x251)
+#define GPUREG_GSH_MISC0                  (0x252)
+#define GPUREG_GEOSTAGE_CONFIG2           (0x253)
+#define GPUREG_GSH_MISC1                  (0x254)
+#define GPUREG_PRIMITIVE_CONFIG           (0x25E)
+#define GPUREG_RESTART_PRIMITIVE          (0x25F)
+#define GPUREG_GSH_INPUTBUFFER_CONFIG     (0x289)
+#define GPUREG_VSH_BOOLUNIFORM            (0x2B0)
+#define GPUREG_VSH_INPUTBUFFER_CONFIG     (0x2B9)
+#define GPUREG_VSH_ENTRYPOINT             (0x2BA)
+#define GPUREG_VSH_ATTRIBUTES_PERMUTATION (0x2BB) // 2 registers.
+#define GPUREG_VSH_OUTMAP_MASK            (0x2BD)
+#define GPUREG_VSH_CODETRANSFER_END       (0x2BF)
+#define GPUREG_VSH_FLOATUNIFORM_CONFIG    (0x2C0)
+#define GPUREG_VSH_FLOATUNIFORM_DATA      (0x2C1)
+#define GPUREG_VSH_CODETRANSFER_CONFIG    (0x2CB)
+#define GPUREG_VSH_CODETRANSFER_DATA      (0x2CC)
+#define GPUREG_VSH_OPDESCS_CONFIG         (0x2D5)
+#define GPUREG_VSH_OPDESCS_DATA           (0x2D6)
+
+// Texture combiner (TEV) sources, operands and ops.
+#define TEV_SRC_TEX0      (0x3u)
+#define TEV_SRC_PREV_BUF  (0xDu)
+#define TEV_SRC_CONST     (0xEu)
+#define TEV_SRC_PREV      (0xFu)
+#define TEV_OP_COLOR      (0x0u)
+#define TEV_OP_R          (0x4u) // Red replicated to all channels.
+#define TEV_OP_G          (0x8u)
+#define TEV_OP_B          (0xCu)
+#define TEV_REPLACE       (0x0u)
+#define TEV_MODULATE      (0x1u)
+#define TEV_MULTIPLY_ADD  (0x8u) // src1 * src2 + src3.
+
+// RGB sources/operands. Alpha always takes src1 (tex0 or previous) unmodified.
+#define TEV_SRC(s1, s2, s3, alpha)  ((alpha)<<16 | (s3)<<8 | (s2)<<4 | (s1))
+#define TEV_OPS(o1, o2, o3)         ((o3)<<8 | (o2)<<4 | (o1))
+
+#define RENDER_BUF_W      (240u) // The LCD is rotated.
+#define RENDER_BUF_H      (400u)
+#define TEXTURE_DIM       (512u)
+
+
+typedef struct
+{
+	u16 x;        // Output rectangle in the 400x240 screen.
+	u16 y;
+	u16 w;
+	u16 h;
+	u16 texW;     // Game area in the texture.
+	u16 texH;
+	bool linear;  // Bilinear filter.
+} PresentMode;
+
+typedef struct
+{
+	u32 source;
+	u32 operand;
+	u32 combiner;
+	u32 color;    // Constant color. RGBA8 with red in the low byte.
+} TexEnvStage;
+
+// Indexed by config scaler value.
+static const PresentMode g_presentModes[3] =
+{
+	{ 80, 40, 240, 160, 240, 160, false}, // 240x160 no scaling.
+	{ 20,  0, 360, 240, 240, 160, true},  // 240x160 bilinear x1.5.
+	{ 20,  0, 360, 240, 360, 240, false}  // 360x240 from the hardware scaler.
 };
 
-// 360x240 without scaling, no filter.
-alignas(16) u8 gbaGpuList2[GBA_LIST2_SIZE] =
-{
-	0x01, 0x00, 0x00, 0x00, 0x10, 0x01, 0x0F, 0x00, 0x00, 0x00, 0x06, 0x03,
-	0x1C, 0x01, 0x2F, 0x80, 0x00, 0x00, 0x03, 0x03, 0xF0, 0xF0, 0x18, 0x01,
-	0xF0, 0xF0, 0x18, 0x01, 0x6E, 0x00, 0x0F, 0x00, 0x03, 0x00, 0x00, 0x00,
-	0x16, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x01, 0x00, 0x17, 0x01, 0x0F, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x1B, 0x01, 0x0F, 0x00, 0x0F, 0x00, 0x00, 0x00,
-	0x12, 0x01, 0x3F, 0x80, 0x0F, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00,
-	0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x45, 0x00,
-	0x41, 0x00, 0x3F, 0x80, 0x12, 0x11, 0x11, 0x38, 0x00, 0x90, 0x46, 0x00,
-	0x14, 0xAE, 0x47, 0x37, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x68, 0x00, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x65, 0x00, 0x2F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80,
-	0xC0, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x80, 0xBF, 0xC1, 0x02, 0xFF, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x89, 0x88, 0x08, 0x3C, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x80, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x0A, 0xD7, 0xA3, 0xBB, 0x00, 0x00, 0x80, 0xBF, 0x00, 0x00, 0x80, 0x3F,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x3F,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x5E, 0x02, 0x02, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x5F, 0x02, 0x0F, 0x00, 0x00, 0x00, 0x00, 0x80,
-	0x27, 0x02, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00, 0x53, 0x02, 0x01, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x45, 0x02, 0x01, 0x00, 0x0F, 0x00, 0x00, 0x00,
-	0x32, 0x02, 0x0F, 0x00, 0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80,
-	0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x43, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x33, 0x02, 0x2F, 0x80, 0x10, 0x3E, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80, 0x00, 0x00, 0x00, 0x00,
-	0x00, 0x7C, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80,
-	0x10, 0x3E, 0x00, 0x00, 0x00, 0x68, 0x3E, 0x00, 0x3E, 0x00, 0x00, 0x3F,
-	0x33, 0x02, 0x2F, 0x80, 0xE0, 0x46, 0x00, 0x00, 0x00, 0x40, 0x43, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x33, 0x02, 0x2F, 0x80, 0x00, 0x3F, 0x00, 0x00,
-	0x00, 0x00, 0x00, 0x00, 0x3E, 0x00, 0x00, 0x3F, 0x33, 0x02, 0x2F, 0x80,
-	0xE0, 0x46, 0x00, 0x00, 0x00, 0x7C, 0x47, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x33, 0x02, 0x2F, 0x80, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x68, 0x3E, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x45, 0x02, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
-	0x53, 0x02, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x31, 0x02, 0x0F, 0x00,
-	0x01, 0x00, 0x00, 0x00, 0x11, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00,
-	0x10, 0x01, 0x0F, 0x00, 0x01, 0x00, 0x00, 0x00, 0x63, 0x00, 0x0F, 0x00,
-	0x78, 0x56, 0x34, 0x12, 0x10, 0x00, 0x0F, 0x00, 0x78, 0x56, 0x34, 0x12,
-	0x10, 0x00, 0x0F, 0x00
+// Passes position and texture coordinate through with an orthographic projection.
+static const u32 g_vshCode[] =
+{
+	0x4E07F001, 0x08020802, 0x08021803, 0x08022804, 0x08023805, 0x4C201006, 0x88000000
 };
 
+static const u32 g_vshOpdescs[] =
+{
+	0x00000AA1, 0x0006C368, 0x0006C364, 0x0006C362, 0x0006C361, 0x0000036F
+};
+
+// Projection matrix (c0-c3) for the rotated 240x400 render buffer. 32 bit floats.
+static const u32 g_projection[16] =
+{
+	0xBF800000, 0x00000000, 0x3C088889, 0x00000000,
+	0x3F800000, 0x00000000, 0x00000000, 0xBBA3D70A,
+	0xBF800000, 0x3F800000, 0x00000000, 0x00000000,
+	0x3F800000, 0x00000000, 0x00000000, 0x00000000
+};
 
+GpuInitList gbaGpuInitList;
+GpuFrameList gbaGpuFrameList;
 
-void patchGbaGpuCmdList(const u8 scaleType, const bool useSecondTexture)
+
+
+static u32* cmdWrite(u32 *p, const u16 reg, const u8 mask, const u32 val)
+{
+	*p++ = val;
+	*p++ = CMD_HDR(reg, mask, 0, false);
+
+	return p;
+}
+
+// Writes vals to the same register (seq false) or to consecutive registers (seq true).
+static u32* cmdWriteN(u32 *p, const u16 reg, const bool seq, const u32 *const vals, const u32 num)
 {
-	if(useSecondTexture)
+	*p++ = vals[0];
+	*p++ = CMD_HDR(reg, 0xF, num - 1, seq);
+	for(u32 i = 1; i < num; i++) *p++ = vals[i];
+	if((num & 1) == 0) *p++ = 0; // Commands are 8 bytes aligned.
+
+	return p;
+}
+
+static u32* cmdFinish(u32 *p, const u32 *const start)
+{
+	// Lists must be a multiple of 16 bytes. Pad with extra finalize commands.
+	do
 	{
-		u32 tmp = GPU_TEXTURE2_ADDR>>3;
-		memcpy(&gbaGpuInitList[580], &tmp, 4);
-		tmp = 0;
-		memcpy(&gbaGpuInitList[584], &tmp, 4);
-	}
+		p = cmdWrite(p, GPUREG_FINALIZE, 0xF, 0x12345678);
+	} while(((uintptr_t)p - (uintptr_t)start) & 15);
+
+	return p;
+}
+
+static u32 f32ToF24(const float f)
+{
+	u32 bits;
+	memcpy(&bits, &f, 4);
+	if((bits & 0x7FFFFFFFu) == 0) return 0;
+
+	// 1 sign, 7 exponent (bias 63) and 16 mantissa bits.
+	const u32 exp = ((bits>>23) & 0xFFu) - 127 + 63;
+	return (bits>>31)<<23 | (exp & 0x7Fu)<<16 | ((bits>>7) & 0xFFFFu);
+}
+
+// Packs a vec4 of 24 bit floats into 3 words (w first).
+static u32* cmdFixedAttrib(u32 *p, const float x, const float y, const float z, const float w)
+{
+	const u32 fx = f32ToF24(x), fy = f32ToF24(y), fz = f32ToF24(z), fw = f32ToF24(w);
+	const u32 vals[3] = {fw<<8 | fz>>16, fz<<16 | fy>>8, fy<<24 | fx};
+
+	return cmdWriteN(p, GPUREG_FIXEDATTRIB_DATA0, true, vals, 3);
+}
+
+static u32* cmdTexEnv(u32 *p, const u16 reg, const TexEnvStage *const stage)
+{
+	// No scaling.
+	const u32 vals[5] = {stage->source, stage->operand, stage->combiner, stage->color, 0};
+
+	return cmdWriteN(p, reg, true, vals, 5);
+}
 
-	if(scaleType == 0)
+// Returns the TEXENV_UPDATE_BUFFER RGB stage mask.
+// Note: The output of stage n is visible as previous buffer in stage n + 2.
+static u32 makeColorCorrection(TexEnvStage stages[6], const GpuColorCorrection *const cc)
+{
+	const u32 *const col = cc->columns;
+	u32 s = 0;
+	u32 linBufMask;
+	if(cc->gamma25)
 	{
-		u32 tmp = 0x4440;
-		memcpy(&gbaGpuInitList[952], &tmp, 2);
-		gbaGpuInitList[958] = 0x45;
-		gbaGpuInitList[968] = 0x60;
-		memcpy(&gbaGpuInitList[984], &tmp, 2);
-		gbaGpuInitList[989] = 0x40;
-		gbaGpuInitList[1000] = 0x60;
-		tmp = 0x3DE000;
-		memcpy(&gbaGpuInitList[1004], &tmp, 4);
-		gbaGpuInitList[1016] = 0x90;
-		gbaGpuInitList[1022] = 0x45;
-		gbaGpuInitList[1048] = 0x90;
-		gbaGpuInitList[1053] = 0x40;
-		memcpy(&gbaGpuInitList[1068], &tmp, 4);
-
-		tmp = 0x4440;
-		memcpy(&gbaGpuList2[264], &tmp, 2);
-		gbaGpuList2[270] = 0x45;
-		gbaGpuList2[280] = 0x60;
-		memcpy(&gbaGpuList2[296], &tmp, 2);
-		gbaGpuList2[301] = 0x40;
-		gbaGpuList2[312] = 0x60;
-		tmp = 0x3DE000;
-		memcpy(&gbaGpuList2[316], &tmp, 4);
-		gbaGpuList2[328] = 0x90;
-		gbaGpuList2[334] = 0x45;
-		gbaGpuList2[360] = 0x90;
-		gbaGpuList2[365] = 0x40;
-		memcpy(&gbaGpuList2[380], &tmp, 4);
+		// lin = x^2 * (x * 0.5 + 0.5). Within ~0.012 of x^2.5.
+		stages[0] = (TexEnvStage){TEV_SRC(TEV_SRC_TEX0, TEV_SRC_TEX0, 0, TEV_SRC_TEX0), 0, TEV_MODULATE, 0};
+		stages[1] = (TexEnvStage){TEV_SRC(TEV_SRC_TEX0, TEV_SRC_CONST, TEV_SRC_CONST, TEV_SRC_PREV), 0, TEV_MULTIPLY_ADD, 0xFF808080};
+		stages[2] = (TexEnvStage){TEV_SRC(TEV_SRC_PREV, TEV_SRC_PREV_BUF, 0, TEV_SRC_PREV), 0, TEV_MODULATE, 0};
+		s = 3;
+		linBufMask = 1u<<0 | 1u<<2; // x^2 for stage 2 and lin for stages 4 and 5.
 	}
-	else if(scaleType == 1)
+	else
 	{
-		gbaGpuInitList[572] = 2;
-		gbaGpuInitList[968] = 0x60;
-		gbaGpuInitList[1000] = 0x60;
-		u32 tmp = 0x3DE000;
-		memcpy(&gbaGpuInitList[1004], &tmp, 4);
-		memcpy(&gbaGpuInitList[1068], &tmp, 4);
-
-		gbaGpuList2[280] = 0x60;
-		gbaGpuList2[312] = 0x60;
-		memcpy(&gbaGpuList2[316], &tmp, 4);
-		memcpy(&gbaGpuList2[380], &tmp, 4);
+		// lin = x^2.
+		stages[0] = (TexEnvStage){TEV_SRC(TEV_SRC_TEX0, TEV_SRC_TEX0, 0, TEV_SRC_TEX0), 0, TEV_MODULATE, 0};
+		s = 1;
+		linBufMask = 1u<<0; // lin for stages 2 and 3.
 	}
-	// else nothing to do.
 
-	flushDCacheRange(gbaGpuInitList, sizeof(gbaGpuInitList));
-	flushDCacheRange(gbaGpuList2, sizeof(gbaGpuList2));
-}
\ No newline at end of file
+	// Matrix multiply. One input channel (column) per stage. lin is in previous
+	// for the first stage and in the buffer for the other 2.
+	stages[s] = (TexEnvStage){TEV_SRC(TEV_SRC_PREV, TEV_SRC_CONST, 0, TEV_SRC_PREV),
+	                          TEV_OPS(TEV_OP_R, TEV_OP_COLOR, 0), TEV_MODULATE, col[0]};
+	stages[s + 1] = (TexEnvStage){TEV_SRC(TEV_SRC_PREV_BUF, TEV_SRC_CONST, TEV_SRC_PREV, TEV_SRC_PREV),
+	                              TEV_OPS(TEV_OP_G, TEV_OP_COLOR, TEV_OP_COLOR), TEV_MULTIPLY_ADD, col[1]};
+	stages[s + 2] = (TexEnvStage){TEV_SRC(TEV_SRC_PREV_BUF, TEV_SRC_CONST, TEV_SRC_PREV, TEV_SRC_PREV),
+	                              TEV_OPS(TEV_OP_B, TEV_OP_COLOR, TEV_OP_COLOR), TEV_MULTIPLY_ADD, col[2]};
+
+	return linBufMask;
+}
+
+// Render target and viewport. Part of every frame in the old lists.
+static u32* cmdRenderTarget(u32 *p)
+{
+	p = cmdWrite(p, GPUREG_FRAMEBUFFER_INVALIDATE, 0xF, 1);
+	// The depth buffer is unused (depth test off).
+	const u32 dim = RENDER_BUF_W | (RENDER_BUF_H - 1)<<12 | 1u<<24;
+	const u32 loc[3] = {GPU_TEXTURE2_ADDR>>3, GPU_RENDER_BUF_ADDR>>3, dim};
+	p = cmdWriteN(p, GPUREG_DEPTHBUFFER_LOC, true, loc, 3);
+	p = cmdWrite(p, GPUREG_RENDERBUF_DIM, 0xF, dim);
+	p = cmdWrite(p, GPUREG_DEPTHBUFFER_FORMAT, 0xF, 3);
+	p = cmdWrite(p, GPUREG_COLORBUFFER_FORMAT, 0xF, 0x00010001); // RGB8.
+	p = cmdWrite(p, GPUREG_FRAMEBUFFER_BLOCK32, 0xF, 0);
+	const u32 access[4] = {0xF, 0xF, 3, 3};
+	p = cmdWriteN(p, GPUREG_COLORBUFFER_READ, true, access, 4);
+
+	// Viewport 240x400. Half width/height and their inverses.
+	const u32 viewport[4] = {f32ToF24(RENDER_BUF_W / 2.f), 0x38111112, f32ToF24(RENDER_BUF_H / 2.f), 0x3747AE14};
+	p = cmdWriteN(p, GPUREG_VIEWPORT_WIDTH, true, viewport, 4);
+	p = cmdWrite(p, GPUREG_VIEWPORT_XY, 0xF, 0);
+	const u32 scissor[3] = {0, 0, 0};
+
+	return cmdWriteN(p, GPUREG_SCISSORTEST_MODE, true, scissor, 3);
+}
+
+static u32* cmdVertexShader(u32 *p)
+{
+	p = cmdWrite(p, GPUREG_GEOSTAGE_CONFIG, 0x3, 0);
+	p = cmdWrite(p, GPUREG_GEOSTAGE_CONFIG2, 0x3, 0);
+	p = cmdWrite(p, GPUREG_VSH_COM_MODE, 0x1, 0);
+
+	// Upload code and operand descriptors.
+	p = cmdWrite(p, GPUREG_VSH_CODETRANSFER_CONFIG, 0xF, 0);
+	u32 code[1 + sizeof(g_vshCode) / 4] = {0x4E000000};
+	memcpy(&code[1], g_vshCode, sizeof(g_vshCode));
+	p = cmdWriteN(p, GPUREG_VSH_CODETRANSFER_DATA, false, code, sizeof(code) / 4);
+	p = cmdWrite(p, GPUREG_VSH_CODETRANSFER_END, 0xF, 1);
+	p = cmdWrite(p, GPUREG_VSH_OPDESCS_CONFIG, 0xF, 0);
+	u32 opdescs[1 + sizeof(g_vshOpdescs) / 4] = {0x0000036E};
+	memcpy(&opdescs[1], g_vshOpdescs, sizeof(g_vshOpdescs));
+	p = cmdWriteN(p, GPUREG_VSH_OPDESCS_DATA, false, opdescs, sizeof(opdescs) / 4);
+	p = cmdWrite(p, GPUREG_VSH_ENTRYPOINT, 0xF, 0x7FFF0000);
+	p = cmdWrite(p, GPUREG_VSH_OUTMAP_MASK, 0xF, 3);
+	p = cmdWrite(p, GPUREG_VSH_OUTMAP_TOTAL1, 0xF, 1);
+	p = cmdWrite(p, GPUREG_VSH_OUTMAP_TOTAL2, 0xF, 1);
+	p = cmdWrite(p, GPUREG_PRIMITIVE_CONFIG, 0x1, 1);
+
+	// o0 position, o1 texcoord0.
+	const u32 outmap[8] = {2, 0x03020100, 0x1F1F0D0C, 0x1F1F1F1F, 0x1F1F1F1F, 0x1F1F1F1F, 0x1F1F1F1F, 0x1F1F1F1F};
+	p = cmdWriteN(p, GPUREG_SH_OUTMAP_TOTAL, true, outmap, 8);
+	p = cmdWrite(p, GPUREG_SH_OUTATTR_MODE, 0xF, 1);
+	p = cmdWrite(p, GPUREG_SH_OUTATTR_CLOCK, 0xF, 0x101);
+
+	// No geometry shader.
+	p = cmdWrite(p, GPUREG_GEOSTAGE_CONFIG, 0xA, 0);
+	p = cmdWrite(p, GPUREG_GSH_MISC0, 0xF, 0);
+	p = cmdWrite(p, GPUREG_GSH_MISC1, 0xF, 0);
+	p = cmdWrite(p, GPUREG_GSH_INPUTBUFFER_CONFIG, 0xF, 0xA0000000);
+
+	// 2 fixed attributes.
+	const u32 attribFormat[2] = {0x7B, 0x1FFC0000};
+	p = cmdWriteN(p, GPUREG_ATTRIBBUFFERS_FORMAT_LOW, true, attribFormat, 2);
+	p = cmdWrite(p, GPUREG_VSH_INPUTBUFFER_CONFIG, 0xB, 0xA0000001);
+	p = cmdWrite(p, GPUREG_VSH_NUM_ATTR, 0xF, 1);
+	const u32 permutation[2] = {0x10, 0};
+
+	return cmdWriteN(p, GPUREG_VSH_ATTRIBUTES_PERMUTATION, true, permutation, 2);
+}
+
+static u32* cmdFragment(u32 *p, const PresentMode *const mode, const bool useSecondTexture,
+                        const GpuColorCorrection *const cc)
+{
+	// Depth, culling and blending off.
+	p = cmdWrite(p, GPUREG_DEPTHMAP_ENABLE, 0xF, 1);
+	p = cmdWrite(p, GPUREG_FACECULLING_CONFIG, 0xF, 2);
+	const u32 depthMap[2] = {0x00BF0000, 0};
+	p = cmdWriteN(p, GPUREG_DEPTHMAP_SCALE, true, depthMap, 2);
+	const u32 fragOp[4] = {0x10, 0x10, 0, 0xF10};
+	p = cmdWriteN(p, GPUREG_FRAGOP_ALPHA_TEST, true, fragOp, 4);
+	p = cmdWrite(p, GPUREG_GAS_DELTAZ_DEPTH, 0x8, 0);
+	p = cmdWrite(p, GPUREG_BLEND_COLOR, 0xF, 0);
+	p = cmdWrite(p, GPUREG_BLEND_FUNC, 0xF, 0x76760000);
+	p = cmdWrite(p, GPUREG_LOGIC_OP, 0xF, 0);
+	p = cmdWrite(p, GPUREG_COLOR_OPERATION, 0x7, 0x00E40100);
+	p = cmdWrite(p, GPUREG_FRAGOP_SHADOW, 0xF, 0x80003C00);
+	p = cmdWrite(p, GPUREG_EARLYDEPTH_TEST1, 0x1, 0);
+	p = cmdWrite(p, GPUREG_EARLYDEPTH_TEST2, 0xF, 0);
+	p = cmdWrite(p, GPUREG_EARLYDEPTH_FUNC, 0x1, 0);
+	p = cmdWrite(p, GPUREG_EARLYDEPTH_DATA, 0x7, 0);
+
+	// 512x512 texture. A1BGR5 from LgyCap or RGBA8 from core 1 color conversion.
+	const u32 texAddr = (useSecondTexture ? GPU_TEXTURE2_ADDR : GPU_TEXTURE_ADDR);
+	const u32 texUnit[5] = {0, TEXTURE_DIM<<16 | TEXTURE_DIM, (mode->linear ? 2u : 0u), 0, texAddr>>3};
+	p = cmdWriteN(p, GPUREG_TEXUNIT0_BORDER_COLOR, true, texUnit, 5);
+	p = cmdWrite(p, GPUREG_TEXUNIT0_TYPE, 0xF, (useSecondTexture ? 0u : 2u));
+	p = cmdWrite(p, GPUREG_TEXUNIT_CONFIG, 0xB, 0x00011001); // Enable texture 0 and clear the texture cache.
+	p = cmdWrite(p, GPUREG_TEXUNIT_CONFIG, 0x4, 0x00010000);
+	p = cmdWrite(p, GPUREG_TEXUNIT0_SHADOW, 0xF, 1);
+
+	// Stage 0 outputs texture 0. The other stages pass through.
+	// Or color correction in up to 6 stages.
+	TexEnvStage stages[6];
+	stages[0] = (TexEnvStage){TEV_SRC(TEV_SRC_TEX0, 0, 0, TEV_SRC_TEX0), 0, TEV_REPLACE, 0xFFFFFFFF};
+	for(u32 i = 1; i < 6; i++)
+		stages[i] = (TexEnvStage){TEV_SRC(TEV_SRC_PREV, 0, 0, TEV_SRC_PREV), 0, TEV_REPLACE, 0xFFFFFFFF};
+	u32 bufMask = 0;
+	if(cc != NULL) bufMask = makeColorCorrection(stages, cc);
+
+	p = cmdWrite(p, GPUREG_TEXENV_UPDATE_BUFFER, 0x7, bufMask<<8);
+	p = cmdWrite(p, GPUREG_TEXENV_BUFFER_COLOR, 0xF, 0xFFFFFFFF);
+	p = cmdWrite(p, GPUREG_FOG_COLOR, 0xF, 0);
+	p = cmdTexEnv(p, GPUREG_TEXENV0_SOURCE, &stages[0]);
+	p = cmdTexEnv(p, GPUREG_TEXENV1_SOURCE, &stages[1]);
+	p = cmdTexEnv(p, GPUREG_TEXENV2_SOURCE, &stages[2]);
+	p = cmdTexEnv(p, GPUREG_TEXENV3_SOURCE, &stages[3]);
+	p = cmdTexEnv(p, GPUREG_TEXENV4_SOURCE, &stages[4]);
+
+	return cmdTexEnv(p, GPUREG_TEXENV5_SOURCE, &stages[5]);
+}
+
+static u32* cmdProjection(u32 *p)
+{
+	// Shader constant c95 in 24 bit float mode.
+	const u32 c95[4] = {0x5F, 0x3E0000BF, 0x00003F00, 0};
+	p = cmdWriteN(p, GPUREG_VSH_FLOATUNIFORM_CONFIG, true, c95, 4);
+
+	u32 proj[1 + 16] = {0x80000000};
+	memcpy(&proj[1], g_projection, sizeof(g_projection));
+	p = cmdWriteN(p, GPUREG_VSH_FLOATUNIFORM_CONFIG, false, proj, 1);
+	p = cmdWriteN(p, GPUREG_VSH_FLOATUNIFORM_DATA, false, &proj[1], 16);
+
+	return cmdWrite(p, GPUREG_VSH_BOOLUNIFORM, 0xF, 0x7FFF0000);
+}
+
+// Draws the game area as a triangle strip and flushes the render buffer.
+static u32* cmdDraw(u32 *p, const PresentMode *const mode)
+{
+	p = cmdWrite(p, GPUREG_PRIMITIVE_CONFIG, 0x2, 0x100); // Triangle strip.
+	p = cmdWrite(p, GPUREG_RESTART_PRIMITIVE, 0xF, 1);
+	p = cmdWrite(p, GPUREG_INDEXBUFFER_CONFIG, 0xF, 0x80000000);
+	p = cmdWrite(p, GPUREG_GEOSTAGE_CONFIG2, 0x1, 1);
+	p = cmdWrite(p, GPUREG_START_DRAW_FUNC0, 0x1, 0);
+	p = cmdWrite(p, GPUREG_FIXEDATTRIB_INDEX, 0xF, 0xF); // Immediate mode.
+
+	const float x0 = mode->x, x1 = mode->x + mode->w;
+	const float y0 = mode->y, y1 = mode->y + mode->h;
+	const float u1 = (float)mode->texW / TEXTURE_DIM;
+	const float v0 = 1.f - (float)mode->texH / TEXTURE_DIM;
+	p = cmdFixedAttrib(p, x0, y0, 0.5f, 1.f);
+	p = cmdFixedAttrib(p, 0.f, v0, 0.f, 0.f);
+	p = cmdFixedAttrib(p, x1, y0, 0.5f, 1.f);
+	p = cmdFixedAttrib(p, u1, v0, 0.f, 0.f);
+	p = cmdFixedAttrib(p, x0, y1, 0.5f, 1.f);
+	p = cmdFixedAttrib(p, 0.f, 1.f, 0.f, 0.f);
+	p = cmdFixedAttrib(p, x1, y1, 0.5f, 1.f);
+	p = cmdFixedAttrib(p, u1, 1.f, 0.f, 0.f);
+
+	p = cmdWrite(p, GPUREG_START_DRAW_FUNC0, 0x1, 1);
+	p = cmdWrite(p, GPUREG_GEOSTAGE_CONFIG2, 0x1, 0);
+	p = cmdWrite(p, GPUREG_VTX_FUNC, 0xF, 1);
+	p = cmdWrite(p, GPUREG_FRAMEBUFFER_FLUSH, 0xF, 1);
+	p = cmdWrite(p, GPUREG_FRAMEBUFFER_INVALIDATE, 0xF, 1);
+
+	return cmdWrite(p, GPUREG_EARLYDEPTH_CLEAR, 0xF, 1);
+}
+
+void makeGbaGpuCmdLists(const u8 scaleType, const bool useSecondTexture, const GpuColorCorrection *const cc)
+{
+	const PresentMode *const mode = &g_presentModes[scaleType < 3 ? scaleType : 2];
+
+	u32 *const init = gbaGpuInitList.cmd;
+	u32 *p = cmdRenderTarget(init);
+	p = cmdVertexShader(p);
+	p = cmdFragment(p, mode, useSecondTexture, cc);
+	p = cmdProjection(p);
+	p = cmdDraw(p, mode);
+	p = cmdFinish(p, init);
+	gbaGpuInitList.size = (uintptr_t)p - (uintptr_t)init;
+
+	// Nothing else touches the 3D state so following frames only need the draw.
+	// The render buffer cache is already flushed and invalidated at the end of each draw.
+	u32 *const frame = gbaGpuFrameList.cmd;
+	p = cmdDraw(frame, mode);
+	p = cmdFinish(p, frame);
+	gbaGpuFrameList.size = (uintptr_t)p - (uintptr_t)frame;
+
+	flushDCacheRange(init, gbaGpuInitList.size);
+	flushDCacheRange(frame, gbaGpuFrameList.size);
+}
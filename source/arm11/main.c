@@ -25,15 +25,23 @@
 #include "arm11/drivers/codec.h"
 #include "arm11/drivers/hid.h"
 #include "arm11/power.h"
+#include "arm11/perf.h"
+#include "arm11/core1.h"
+#include "arm11/boot_trace.h"
 
 
 
 int main(void)
 {
+	perfInit();
+	core1Init(); // Boot time jobs until video init.
+
 	Result res = oafParseConfigEarly();
+	bootTraceMark("FS + config", 0);
 	GFX_init(GFX_BGR8, GFX_BGR565, GFX_TOP_2D);
 	changeBacklight(0); // Apply backlight config.
 	consoleInit(GFX_LCD_BOT, NULL);
+	bootTraceMark("GFX init", 0);
 	//CODEC_init();
 
 	if(res == RES_OK && (res = oafInitAndRun()) == RES_OK)
@@ -0,0 +1,109 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/oaf_input.h"
+#include "mem_map.h"
+#include "arm11/drivers/hid.h"
+#include "arm11/drivers/lgy11.h"
+#include "arm11/perf.h"
+#include "kernel.h"
+#include "ktimer.h"
+
+
+// The buttons wired to the HID block. Everything else (ZL/ZR, circle pad,
+// touch ect.) comes from the MCU/SPI and is only updated by hidScanInput().
+#define REG_HID_PAD  *((const vu16*)(IO_COMMON_BASE + 0x46000))
+#define HID_PAD_MASK (0xFFFu)
+
+
+// Maps each byte of the held keys to the GBA buttons it triggers.
+static u16 g_remapLut[4][256];
+static KHandle g_inputTimer = 0;
+static vu32 g_extraHeld = 0;
+
+
+
+static inline u16 remapButtons(const u32 kHeld)
+{
+	return g_remapLut[0][kHeld & 0xFFu] | g_remapLut[1][(kHeld>>8) & 0xFFu] |
+	       g_remapLut[2][(kHeld>>16) & 0xFFu] | g_remapLut[3][kHeld>>24];
+}
+
+static void inputTask(UNUSED void *args)
+{
+	const KHandle timer = g_inputTimer;
+	while(1)
+	{
+		if(waitForTimer(timer) != KRES_OK) break;
+
+		// The pad register is active low.
+		const u32 pad = ~REG_HID_PAD & HID_PAD_MASK;
+		LGY11_setInputState(remapButtons(g_extraHeld | pad));
+	}
+
+	taskExit();
+}
+
+void OAF_inputInit(const u32 buttonMaps[10], u16 rate)
+{
+	u16 overrides = 0;
+	for(unsigned i = 0; i < 10; i++)
+		if(buttonMaps[i] != 0) overrides |= 1u<<i;
+
+	for(unsigned b = 0; b < 4; b++)
+	{
+		for(unsigned v = 0; v < 256; v++)
+		{
+			const u32 keys = (u32)v<<(b * 8);
+			u16 pressed = 0;
+			for(unsigned i = 0; i < 10; i++)
+				if((keys & buttonMaps[i]) != 0) pressed |= 1u<<i;
+			g_remapLut[b][v] = pressed;
+		}
+	}
+
+	LGY11_selectInput(overrides);
+
+	// Nothing to do if the GBA reads all buttons directly from hardware.
+	if(overrides == 0 || rate == 0) return;
+	rate = (rate > OAF_INPUT_MAX_RATE ? OAF_INPUT_MAX_RATE : rate);
+
+	g_extraHeld = hidKeysHeld() & ~HID_PAD_MASK;
+	g_inputTimer = createTimer(true);
+	// Same priority as the gfx task. Each tick is only a register read and write.
+	createTask(0x400, 3, inputTask, NULL);
+	startTimer(g_inputTimer, 1, PERF_TICK_FREQ / rate);
+}
+
+void OAF_inputUpdate(void)
+{
+	const u32 kHeld = hidKeysHeld();
+	if(g_inputTimer != 0) g_extraHeld = kHeld & ~HID_PAD_MASK;
+	else                  LGY11_setInputState(remapButtons(kHeld));
+}
+
+void OAF_inputExit(void)
+{
+	if(g_inputTimer == 0) return;
+
+	// inputTask() will automatically terminate.
+	stopTimer(g_inputTimer);
+	deleteTimer(g_inputTimer);
+	g_inputTimer = 0;
+}
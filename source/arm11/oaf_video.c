@@ -25,24 +25,46 @@
 #include "util.h"
 #include "oaf_error_codes.h"
 #include "arm11/drivers/lgycap.h"
-#include "arm11/bitmap.h"
 #include "drivers/gfx.h"
 #include "arm11/drivers/mcu.h"
 #include "arm11/fmt.h"
+#include "fs.h"
 #include "fsutil.h"
 #include "kernel.h"
 #include "kevent.h"
 #include "arm11/drivers/hid.h"
 #include "arm11/drivers/interrupt.h"
 #include "arm11/gpu_cmd_lists.h"
-#include "system.h"
+#include "arm11/core1.h"
 #include "arm11/fast_frame_convert.h"
+#include "arm11/perf.h"
+#include "arm11/frame_pacing.h"
+#include "arm11/screenshot.h"
+#include "arm11/boot_trace.h"
+#include "arm11/border.h"
 
 
-#define COLOR_LUT_ADDR (0x1FF00000u)
+#define COLOR_LUT_ADDR        (0x1FF00000u)
+#define COLOR_LUT_ENTRIES     (32768u)
+#define COLOR_LUT_SIZE        (COLOR_LUT_ENTRIES * 4)
+#define COLOR_LUT_CACHE_PATH  OAF_CACHE_DIR "/color_lut.bin"
+#define COLOR_LUT_MAGIC       (0x4C43414Fu) // "OACL"
+#define COLOR_LUT_VERSION     (1u)          // Bump when the LUT generation changes.
+
+// Separable LUT. Sums up to 1.16 fit the display table.
+#define SEP_LUT_SCALE         (3072)    // Fixed point scale of the linear values.
+#define SEP_LUT_BIAS          (384)     // Keeps slightly negative sums positive.
+#define SEP_LUT_DISP_OFFSET   (0x300u)
+#define SEP_LUT_DISP_ENTRIES  (4096u)   // The converters clamp sums to 12 bits.
 
 
 static KHandle g_convFinishedEvent = 0;
+static u8 g_fullPresents = 2;        // Full frame buffer transfers left. 1 for each frame buffer.
+static u16 g_presentFirstRow = 0;    // Frame buffer rows (screen columns) with game pixels.
+static u16 g_presentRows = 400;
+#ifndef NDEBUG
+vu32 g_convTicks[2] = {0}; // Written by core 1. Start and duration of the last conversion.
+#endif
 static const u32 g_topLcdCurveCorrect[73] =
 {
 	// Curve correction from 3DS top LCD gamma to 2.2 gamma for all channels.
@@ -72,7 +94,8 @@ static const u32 g_topLcdCurveCorrect[73] =
 
 
 // TODO: Reimplement contrast and brightness in color lut below.
-static void adjustGammaTableForGba(void)
+// displayGamma is applied before the curve correction if not 0 (color correction in the GPU).
+static void adjustGammaTableForGba(const float displayGamma)
 {
 	// Credits for this algo go to Extrems.
 	/*const float targetGamma = g_oafConfig.gbaGamma;
@@ -97,6 +120,7 @@ static void adjustGammaTableForGba(void)
 	// Code + hardcoded tables are way smaller than hardcoding the uncompressed tables.
 	const u32 *encTable = g_topLcdCurveCorrect;
 	vu32 *const color_lut_data = &getGxRegs()->pdc0.color_lut_data;
+	u32 lut[256];
 	u32 decoded = 0;
 	do
 	{
@@ -110,10 +134,17 @@ static void adjustGammaTableForGba(void)
 		{
 			// Set gamma table entry and increment.
 			// Note: Bits 24-31 don't matter so we don't need to mask.
-			*color_lut_data = entry;
+			lut[decoded - steps] = entry;
 			entry += 0x010101;
 		} while(--steps != 0);
 	} while(decoded < 256);
+
+	for(u32 i = 0; i < 256; i++)
+	{
+		u32 idx = i;
+		if(displayGamma != 0.f) idx = lroundf(powf((float)i / 255, displayGamma) * 255);
+		*color_lut_data = lut[idx];
+	}
 }
 
 typedef struct
@@ -159,27 +190,31 @@ ALWAYS_INLINE float clamp_float(const float x, const float min, const float max)
 	return (x < min ? min : (x > max ? max : x));
 }
 
-static void makeColorLut(const ColorProfile *const p)
+// [output channel][input channel][input value] = matrix coefficient * linear input.
+// Every input channel only has 32 possible values so these replace the powf() calls.
+typedef struct
+{
+	float lin[3][3][32];
+	float encode[256];   // Display gamma thresholds. encode[v] is the lowest value rounding to v.
+} ColorLutTables;
+
+typedef struct
+{
+	const ColorLutTables *tables;
+	u32 start;
+	u32 end;
+} ColorLutJob;
+
+static ColorLutTables g_colorLutTables;
+static ColorLutJob g_colorLutJob; // Accessed by core 1.
+
+static void makeColorLutTables(const ColorProfile *const p, ColorLutTables *const t)
 {
-	u32 *colorLut = (u32*)COLOR_LUT_ADDR;
-	for(u32 i = 0; i < 32768; i++)
+	for(u32 i = 0; i < 32; i++)
 	{
-		// Convert to 8-bit and normalize.
-		float b = (float)rgbFive2Eight(i & 31u) / 255;
-		float g = (float)rgbFive2Eight((i>>5) & 31u) / 255;
-		float r = (float)rgbFive2Eight(i>>10) / 255;
-
-		// Convert to linear gamma.
-		const float targetGamma = p->targetGamma;
-		b = powf(b, targetGamma);
-		g = powf(g, targetGamma);
-		r = powf(r, targetGamma);
-
-		// Apply luminance.
-		const float lum = p->lum;
-		b = clamp_float(b * lum, 0.f, 1.f);
-		g = clamp_float(g * lum, 0.f, 1.f);
-		r = clamp_float(r * lum, 0.f, 1.f);
+		// Convert to 8-bit, normalize, convert to linear gamma and apply luminance.
+		float x = (float)rgbFive2Eight(i) / 255;
+		x = clamp_float(powf(x, p->targetGamma) * p->lum, 0.f, 1.f);
 
 		/*
 		 *               Input
@@ -192,85 +227,217 @@ static void makeColorLut(const ColorProfile *const p)
 		 * [rg][ g][bg]   [g]
 		 * [rb][gb][ b]   [b]
 		*/
-		// Assuming no alpha channel in original calculation.
-		float newB = p->rb * r + p->gb * g + p->b * b;
-		float newG = p->rg * r + p->g * g + p->bg * b;
-		float newR = p->r * r + p->gr * g + p->br * b;
+		t->lin[0][0][i] = p->r * x;
+		t->lin[0][1][i] = p->gr * x;
+		t->lin[0][2][i] = p->br * x;
+		t->lin[1][0][i] = p->rg * x;
+		t->lin[1][1][i] = p->g * x;
+		t->lin[1][2][i] = p->bg * x;
+		t->lin[2][0][i] = p->rb * x;
+		t->lin[2][1][i] = p->gb * x;
+		t->lin[2][2][i] = p->b * x;
+	}
+
+	// lroundf(powf(x, displayGamma) * 255) == v for x >= encode[v] and x < encode[v + 1].
+	const float invDisplayGamma = 1.f / p->displayGamma;
+	t->encode[0] = 0.f; // Unused.
+	for(u32 v = 1; v < 256; v++)
+		t->encode[v] = powf(((float)v - 0.5f) / 255, invDisplayGamma);
+}
 
-		newB = (newB < 0.f ? 0.f : newB);
-		newG = (newG < 0.f ? 0.f : newG);
-		newR = (newR < 0.f ? 0.f : newR);
+// Converts to display gamma, denormalizes and clamps by binary searching the thresholds.
+// Negative values end up as 0 like before.
+static u32 encodeDisplayGamma(const float *const encode, const float x)
+{
+	u32 v = 0;
+	for(u32 step = 128; step != 0; step >>= 1)
+		if(x >= encode[v + step]) v += step;
+
+	return v;
+}
 
-		// Convert to display gamma.
-		const float displayGamma = p->displayGamma;
-		newB = powf(newB, displayGamma);
-		newG = powf(newG, displayGamma);
-		newR = powf(newR, displayGamma);
+static void colorLutJob(void *arg)
+{
+	const ColorLutJob *const job = (ColorLutJob*)arg;
+	const ColorLutTables *const t = job->tables;
+	const float *const encode = t->encode;
+
+	u32 *const colorLut = (u32*)COLOR_LUT_ADDR;
+	for(u32 i = job->start; i < job->end; i++)
+	{
+		const u32 b = i & 31u;
+		const u32 g = (i>>5) & 31u;
+		const u32 r = i>>10;
 
-		// Denormalize, clamp, convert to ABGR8 and write lut.
+		// Assuming no alpha channel in original calculation.
+		const float newR = t->lin[0][0][r] + t->lin[0][1][g] + t->lin[0][2][b];
+		const float newG = t->lin[1][0][r] + t->lin[1][1][g] + t->lin[1][2][b];
+		const float newB = t->lin[2][0][r] + t->lin[2][1][g] + t->lin[2][2][b];
+
+		// Convert to ABGR8 and write lut.
 		u32 tmp = 0xFF; // Alpha.
-		tmp |= clamp_s32(lroundf(newB * 255), 0, 255)<<8;
-		tmp |= clamp_s32(lroundf(newG * 255), 0, 255)<<16;
-		tmp |= clamp_s32(lroundf(newR * 255), 0, 255)<<24;
-		*colorLut++ = tmp;
+		tmp |= encodeDisplayGamma(encode, newB)<<8;
+		tmp |= encodeDisplayGamma(encode, newG)<<16;
+		tmp |= encodeDisplayGamma(encode, newR)<<24;
+		colorLut[i] = tmp;
 	}
 
-	flushDCacheRange((void*)COLOR_LUT_ADDR, 1024u * 128);
+	// Cache maintenance is per core so each core flushes its own half.
+	flushDCacheRange(&colorLut[job->start], (job->end - job->start) * 4);
 }
 
-static Result dumpFrameTex(void)
+static void makeColorLut(const ColorProfile *const p)
 {
-	if(LGYCAP_captureFrameUnscaled(LGYCAP_DEV_TOP) != KRES_OK)
-		return RES_INVALID_ARG;
+	ColorLutTables *const t = &g_colorLutTables;
+	makeColorLutTables(p, t);
+
+	// Core 1 isn't converting frames yet so it can do the upper half.
+	ColorLutJob *const job = &g_colorLutJob;
+	job->tables = t;
+	job->start  = COLOR_LUT_ENTRIES / 2;
+	job->end    = COLOR_LUT_ENTRIES;
+	core1Submit(colorLutJob, job);
+
+	const ColorLutJob lowerHalf = {t, 0, COLOR_LUT_ENTRIES / 2};
+	colorLutJob((void*)&lowerHalf);
+	core1Wait();
+}
+
+// Compact form of the color LUT for the *FrameSep converters. See fast_frame_convert.s.
+// Input channel tables are at offset 0 (bits 1-5), 0x100 (bits 6-10) and 0x200 (bits 11-15).
+// Each entry is 8 bytes: R and G contribution packed in one word followed by the B contribution.
+static void makeSeparableLut(const ColorProfile *const p)
+{
+	ColorLutTables *const t = &g_colorLutTables;
+	makeColorLutTables(p, t);
 
-	// A1BGR5 format (alpha ignored).
-	constexpr u32 alignment = 0x80; // Make PPF happy.
-	alignas(4) static const BmpV1WithMasks bmpHeaders =
+	u32 *const inTables = (u32*)COLOR_LUT_ADDR;
+	for(u32 k = 0; k < 3; k++)
 	{
+		// The bias is only added once so the sum of all 3 entries has it exactly once.
+		u32 *const table = &inTables[(2 - k) * 64];
+		const s32 bias = (k == 0 ? SEP_LUT_BIAS : 0);
+		for(u32 i = 0; i < 32; i++)
 		{
-			.magic       = 0x4D42,
-			.fileSize    = alignment + 240 * 160 * 2,
-			.reserved    = 0,
-			.reserved2   = 0,
-			.pixelOffset = alignment
-		},
-		{
-			.headerSize      = sizeof(Bitmapinfoheader),
-			.width           = 240,
-			.height          = -160,
-			.colorPlanes     = 1,
-			.bitsPerPixel    = 16,
-			.compression     = BI_BITFIELDS,
-			.imageSize       = 240 * 160 * 2,
-			.xPixelsPerMeter = 0,
-			.yPixelsPerMeter = 0,
-			.colorsUsed      = 0,
-			.colorsImportant = 0
-		},
-		.rMask = 0xF800,
-		.gMask = 0x07C0,
-		.bMask = 0x003E
+			const s32 r = lroundf(t->lin[0][k][i] * SEP_LUT_SCALE) + bias;
+			const s32 g = lroundf(t->lin[1][k][i] * SEP_LUT_SCALE) + bias;
+			const s32 b = lroundf(t->lin[2][k][i] * SEP_LUT_SCALE) + bias;
+
+			// A negative R field borrows from G. This cancels out
+			// because the final R sum is never negative thanks to the bias.
+			table[i * 2]     = (u32)r + ((u32)g<<16);
+			table[i * 2 + 1] = (u32)b;
+		}
+	}
+
+	// Display gamma for every fixed point sum. Bias and clamping are baked in.
+	u8 *const dispTable = (u8*)(COLOR_LUT_ADDR + SEP_LUT_DISP_OFFSET);
+	for(u32 j = 0; j < SEP_LUT_DISP_ENTRIES; j++)
+		dispTable[j] = encodeDisplayGamma(t->encode, (float)((s32)j - SEP_LUT_BIAS) / SEP_LUT_SCALE);
+
+	flushDCacheRange((void*)COLOR_LUT_ADDR, SEP_LUT_DISP_OFFSET + SEP_LUT_DISP_ENTRIES);
+}
+
+static u32 hashColorProfile(const ColorProfile *const p)
+{
+	// 32 bit FNV-1a. The LUT only depends on the profile for now.
+	// Config gamma/contrast/brightness must be added here once the LUT uses them.
+	const u8 *data = (const u8*)p;
+	u32 hash = 2166136261u ^ COLOR_LUT_VERSION;
+	for(u32 i = 0; i < sizeof(ColorProfile); i++)
+	{
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static bool loadColorLut(const u32 key)
+{
+	FHandle f;
+	if(fOpen(&f, COLOR_LUT_CACHE_PATH, FA_OPEN_EXISTING | FA_READ) != RES_OK) return false;
+
+	u32 header[2];
+	u32 read;
+	bool loaded = fRead(f, header, sizeof(header), &read) == RES_OK && read == sizeof(header) &&
+	              header[0] == COLOR_LUT_MAGIC && header[1] == key;
+	if(loaded)
+		loaded = fRead(f, (void*)COLOR_LUT_ADDR, COLOR_LUT_SIZE, &read) == RES_OK && read == COLOR_LUT_SIZE;
+	fClose(f);
+
+	return loaded;
+}
+
+static void storeColorLut(const u32 key)
+{
+	FHandle f;
+	Result res = fOpen(&f, COLOR_LUT_CACHE_PATH, FA_CREATE_ALWAYS | FA_WRITE);
+	if(res == RES_OK)
+	{
+		const u32 header[2] = {COLOR_LUT_MAGIC, key};
+		u32 written;
+		res = fWrite(f, header, sizeof(header), &written);
+		if(res == RES_OK) res = fWrite(f, (void*)COLOR_LUT_ADDR, COLOR_LUT_SIZE, &written);
+		fClose(f);
+
+		// Don't leave a valid header with a truncated LUT behind.
+		if(res != RES_OK || written != COLOR_LUT_SIZE) fUnlink(COLOR_LUT_CACHE_PATH);
+	}
+
+	if(res != RES_OK) debug_printf("Failed to write color LUT cache: %s\n", result2String(res));
+}
+
+// The combiners clamp after every stage so negative coefficients are dropped.
+static void makeGpuColorCorrection(const ColorProfile *const p, GpuColorCorrection *const cc)
+{
+	const float m[3][3] =
+	{
+		{p->r,  p->rg, p->rb}, // Input r to output r, g, b.
+		{p->gr, p->g,  p->gb},
+		{p->br, p->bg, p->b}
 	};
+	for(u32 c = 0; c < 3; c++)
+	{
+		u32 col = 0xFF000000;
+		for(u32 o = 0; o < 3; o++)
+			col |= (u32)lroundf(clamp_float(m[c][o] * p->lum, 0.f, 1.f) * 255)<<(o * 8);
+		cc->columns[c] = col;
+	}
+	cc->gamma25 = p->targetGamma > 2.25f;
+}
 
-	// Transfer frame data out of the 512x512 texture.
-	// We will use the currently hidden frame buffer as temporary buffer.
-	// Note: This is a race with the currently displaying frame buffer
-	//       because we just swapped buffers in the gfx handler function.
-	u32 *const tmpBuf = GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT);
-	GX_displayTransfer((u32*)GPU_TEXTURE_ADDR, PPF_DIM(512, 160), tmpBuf + (alignment / 4), PPF_DIM(240, 160),
-	                   PPF_O_FMT(GX_A1BGR5) | PPF_I_FMT(GX_A1BGR5) | PPF_CROP_EN);
-	memcpy(tmpBuf, &bmpHeaders, sizeof(bmpHeaders));
-	GFX_waitForPPF();
+static void loadOrMakeColorLut(const ColorProfile *const p)
+{
+	PERF_VAR(lutTicks);
+	PERF_START(lutTicks);
+
+	const u32 key = hashColorProfile(p);
+	if(!loadColorLut(key))
+	{
+		makeColorLut(p);
+		storeColorLut(key);
+	}
 
-	// Get current date & time.
-	RtcTimeDate td;
-	MCU_getRtcTimeDate(&td);
+	PERF_STOP(lutTicks);
+	PERF_PRINT("Color LUT", lutTicks);
+}
 
-	// Construct file path from date & time. Then write the file.
-	char fn[36];
-	ee_sprintf(fn, OAF_SCREENSHOT_DIR "/%04X_%02X_%02X_%02X_%02X_%02X.bmp",
-	           td.year + 0x2000, td.mon, td.day, td.hour, td.min, td.sec);
-	const Result res = fsQuickWrite(fn, tmpBuf, bmpHeaders.header.fileSize);
+static bool captureFrameTex(void)
+{
+	// All staging buffers full. Try again when the writer caught up.
+	u32 *const dst = screenshotAcquire();
+	if(dst == NULL) return false;
+
+	if(LGYCAP_captureFrameUnscaled(LGYCAP_DEV_TOP) != KRES_OK)
+		return false;
+
+	// Transfer frame data out of the 512x512 texture to the staging buffer.
+	// The SD write happens later in the screenshot writer task.
+	GX_displayTransfer((u32*)GPU_TEXTURE_ADDR, PPF_DIM(512, 160), dst, PPF_DIM(SCREENSHOT_W, SCREENSHOT_H),
+	                   PPF_O_FMT(GX_A1BGR5) | PPF_I_FMT(GX_A1BGR5) | PPF_CROP_EN);
+	GFX_waitForPPF();
+	screenshotQueue();
 
 	// Clear overwritten texture area in case we overwrote padding (different resolution).
 	// This is important because padding pixels must be fully transparent to get sharp edges when the GPU renders.
@@ -280,7 +447,7 @@ static Result dumpFrameTex(void)
 	// Restart LgyCap.
 	LGYCAP_start(LGYCAP_DEV_TOP);
 
-	return res;
+	return true;
 }
 
 static void convFinishedHandler(UNUSED const u32 intSource)
@@ -297,6 +464,10 @@ static void gbaGfxHandler(void *args)
 		if(waitForEvent(event) != KRES_OK) break;
 		clearEvent(event);
 
+		PERF_FRAME_BEGIN();
+		framePacingFrameReady();
+		PERF_FRAME_MARK(PERF_FRAME_PACING);
+
 		// All measurements are the worst timings in ~30 seconds of runtime.
 		// Measured with timer prescaler 1.
 		// BGR8:
@@ -308,6 +479,11 @@ static void gbaGfxHandler(void *args)
 		// 240x160 no scaling:    ~188 µs (25300 ticks)
 		// 240x160 bilinear x1.5: ~407 µs (54619 ticks)
 		// 360x240 no scaling:    ~400 µs (53725 ticks)
+		//
+		// Debug builds record per-frame stage timings (core 1 color conversion,
+		// pacing, P3D, PPF). Y+START toggles min/avg/max on the bottom screen
+		// and Y+L writes the last frames to perf.csv in the work dir.
+		// Compare 3D LUT (gba, nds, nds_white) and separable (*_fast) profiles with it.
 		static bool inited = false;
 		u32 listSize;
 		const u32 *list;
@@ -315,24 +491,79 @@ static void gbaGfxHandler(void *args)
 		{
 			inited = true;
 
-			listSize = sizeof(gbaGpuInitList);
-			list = (u32*)gbaGpuInitList;
+			listSize = gbaGpuInitList.size;
+			list = gbaGpuInitList.cmd;
 		}
 		else
 		{
-			listSize = sizeof(gbaGpuList2);
-			list = (u32*)gbaGpuList2;
+			listSize = gbaGpuFrameList.size;
+			list = gbaGpuFrameList.cmd;
 		}
 		GX_processCommandList(listSize, list);
+#ifndef NDEBUG
+		const FramePacingStats *const pacing = framePacingGetStats();
+		if(pacing->frames == 1800)
+		{
+			debug_printf("Pacing phase: %u-%u lines (%u frames stretched)\n",
+			             pacing->minPhase, pacing->maxPhase, pacing->stretched);
+			framePacingResetStats();
+		}
+		// Measured on core 1 with its own tick counter.
+		if(g_convFinishedEvent != 0) PERF_FRAME_SET(PERF_FRAME_CONVERT, g_convTicks[1]);
+#endif
 		GFX_waitForP3D();
-		GX_displayTransfer((u32*)GPU_RENDER_BUF_ADDR, PPF_DIM(240, 400), GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT),
-		                   PPF_DIM(240, 400), PPF_O_FMT(GX_BGR8) | PPF_I_FMT(GX_BGR8));
+		PERF_FRAME_MARK(PERF_FRAME_P3D);
+
+		// The GPU can only render tiled so PPF has to convert to the linear frame buffer layout.
+		// Everything outside of the game area never changes. Once both frame buffers
+		// have the border only the rows with game pixels are transferred.
+		u32 firstRow = 0, rows = 400;
+		if(g_fullPresents > 0) g_fullPresents--;
+		else
+		{
+			firstRow = g_presentFirstRow;
+			rows     = g_presentRows;
+		}
+		const u32 rowOffset = firstRow * 240 * 3; // Same for tiled and linear with 8 row alignment.
+		GX_displayTransfer((u32*)(GPU_RENDER_BUF_ADDR + rowOffset), PPF_DIM(240, rows),
+		                   (u32*)((uintptr_t)GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT) + rowOffset),
+		                   PPF_DIM(240, rows), PPF_O_FMT(GX_BGR8) | PPF_I_FMT(GX_BGR8));
 		GFX_waitForPPF();
+		PERF_FRAME_MARK(PERF_FRAME_PPF);
 		GFX_swapBuffers();
+		PERF_FRAME_END();
+
+#ifndef NDEBUG
+		static bool perfOverlay = false;
+		if(hidKeysDown() != 0)
+		{
+			const u32 kHeld = hidKeysHeld();
+			if(kHeld == (KEY_Y | KEY_START))
+			{
+				perfOverlay = !perfOverlay;
+				ee_printf("\x1b[2J");
+			}
+			if(kHeld == (KEY_Y | KEY_L))
+			{
+				const Result res = perfDumpCsv("perf.csv");
+				if(res != RES_OK) ee_printf("Failed to write perf.csv: %s\n", result2String(res));
+			}
+		}
+		if(perfOverlay) perfOverlayUpdate();
+#endif
 
 		// Trigger only if both are held and at least one is detected as newly pressed down.
-		if(hidKeysHeld() == (KEY_Y | KEY_SELECT) && hidKeysDown() != 0)
-			dumpFrameTex();
+		// Keeping them held captures a burst until the staging buffers are full.
+		static u32 burstFrames = 0;
+		if(hidKeysHeld() == (KEY_Y | KEY_SELECT))
+		{
+			if(hidKeysDown() != 0) burstFrames = 0;
+			if(burstFrames-- == 0)
+			{
+				captureFrameTex();
+				burstFrames = SCREENSHOT_BURST_FRAMES - 1;
+			}
+		}
 	}
 
 	taskExit();
@@ -393,54 +624,68 @@ KHandle OAF_videoInit(void)
 
 	// Initialize frame capture.
 	const u8 scaler = g_oafConfig.scaler;
-	const u8 colorProfile = g_oafConfig.colorProfile;
+	const u8 colorProfile = g_oafConfig.colorProfile & ~(COLOR_PROFILE_SEPARABLE | COLOR_PROFILE_GPU);
+	const bool separable = (g_oafConfig.colorProfile & COLOR_PROFILE_SEPARABLE) != 0;
+	const bool gpuColor = colorProfile > 0 && (g_oafConfig.colorProfile & COLOR_PROFILE_GPU) != 0;
+	const bool core1Color = colorProfile > 0 && !gpuColor;
+	const ColorProfile *const profile = (colorProfile > 0 ? &g_colorProfiles[colorProfile - 1] : NULL);
 	KHandle frameReadyEvent;
 	KHandle convFinishedEvent;
-	if(colorProfile > 0)
+	if(core1Color)
 	{
 		// Start capture hardware and create event handles.
 		frameReadyEvent = setupFrameCapture(scaler, true);
 		convFinishedEvent = createEvent(false);
 		g_convFinishedEvent = convFinishedEvent;
 
-		// Patch GPU cmd list with texture location 2.
-		patchGbaGpuCmdList(scaler, true);
+		// Build GPU cmd lists with texture location 2.
+		makeGbaGpuCmdLists(scaler, true, NULL);
 
-		// Compute the (linear) 3D lookup table.
-		makeColorLut(&g_colorProfiles[colorProfile - 1]);
+		// Compute the (linear) 3D lookup table or the much smaller separable tables.
+		if(separable) makeSeparableLut(profile);
+		else          loadOrMakeColorLut(profile);
+		bootTraceMark("Color LUT", 0);
 
-		// Register IPI handler and start core 1 for color conversion.
+		// Register IPI handler and hand core 1 over to color conversion.
+		void (*converter)(void);
+		if(separable) converter = (scaler < 2 ? convert160pFrameSep : convert240pFrameSep);
+		else          converter = (scaler < 2 ? convert160pFrameFast : convert240pFrameFast);
 		IRQ_registerIsr(IRQ_IPI15, 13, 0, convFinishedHandler);
-		__systemBootCore1((scaler < 2 ? convert160pFrameFast : convert240pFrameFast));
+		core1Handover(converter);
 	}
 	else
 	{
 		// Start capture hardware.
 		frameReadyEvent = setupFrameCapture(scaler, false);
 
-		// Patch GPU cmd list with texture location 1.
-		patchGbaGpuCmdList(scaler, false);
+		// Build GPU cmd lists with texture location 1.
+		// The GPU color correction path converts directly from the capture texture.
+		GpuColorCorrection cc;
+		if(gpuColor) makeGpuColorCorrection(profile, &cc);
+		makeGbaGpuCmdLists(scaler, false, (gpuColor ? &cc : NULL));
 	}
 
+	// Game area in frame buffer rows rounded to whole 8 row tiles.
+	// 240x160 is centered at x 80-319. 360x240 at x 20-379.
+	g_presentFirstRow = (scaler == 0 ? 80 : 16);
+	g_presentRows     = (scaler == 0 ? 240 : 368);
+
+	// Find the VBlank line for phase measurements.
+	framePacingInit(g_oafConfig.framePacing);
+
+	// Screenshots are written in the background.
+	screenshotInit();
+
 	// Start frame handler.
-	createTask(0x800, 3, gbaGfxHandler, (void*)(colorProfile > 0 ? convFinishedEvent : frameReadyEvent));
+	createTask(0x800, 3, gbaGfxHandler, (void*)(core1Color ? convFinishedEvent : frameReadyEvent));
 
 	// Adjust hardware gamma table.
-	adjustGammaTableForGba();
+	// Color correction in the GPU outputs linear colors.
+	const float displayGamma = (gpuColor ? profile->displayGamma : 0.f);
+	adjustGammaTableForGba(displayGamma);
 
 	// Load border if any exists.
-	if(scaler == 0) // No borders for scaled modes.
-	{
-		// Abuse currently invisible frame buffer as temporary buffer.
-		void *const borderBuf = GFX_getBuffer(GFX_LCD_TOP, GFX_SIDE_LEFT);
-		if(fsQuickRead("border.bgr", borderBuf, 400 * 240 * 3) == RES_OK)
-		{
-			// Copy border in swizzled form to GPU render buffer.
-			GX_displayTransfer(borderBuf, PPF_DIM(240, 400), (u32*)GPU_RENDER_BUF_ADDR,
-			                   PPF_DIM(240, 400), PPF_O_FMT(GX_BGR8) | PPF_I_FMT(GX_BGR8) | PPF_OUT_TILED);
-			GFX_waitForPPF();
-		}
-	}
+	if(scaler == 0) loadBorder(g_oafConfig.border, displayGamma); // No borders for scaled modes.
 
 	return frameReadyEvent;
 }
@@ -450,6 +695,8 @@ void OAF_videoExit(void)
 	// frameReadyEvent deleted by this function.
 	// gbaGfxHandler() will automatically terminate.
 	LGYCAP_deinit(LGYCAP_DEV_TOP);
+	framePacingExit();
+	screenshotExit();
 	if(g_convFinishedEvent != 0)
 	{
 		deleteEvent(g_convFinishedEvent);
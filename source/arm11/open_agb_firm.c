@@ -20,7 +20,6 @@
 #include <string.h>
 #include "types.h"
 #include "util.h"
-#include "arm11/fast_rom_padding.h"
 #include "oaf_error_codes.h"
 #include "fs.h"
 #include "arm11/fmt.h"
@@ -29,90 +28,68 @@
 #include "arm11/drivers/hid.h"
 #include "fsutil.h"
 #include "arm11/filebrowser.h"
+#include "arm11/rom_loader.h"
+#include "arm11/rom_cache.h"
 #include "arm11/config.h"
+#include "arm11/game_profiles.h"
 #include "arm11/save_type.h"
 #include "arm11/patch.h"
+#include "arm11/patch_cache.h"
 #include "arm11/drivers/codec.h"
 #include "drivers/lgy_common.h"
 #include "arm11/oaf_video.h"
+#include "arm11/oaf_input.h"
+#include "arm11/perf_mode.h"
 #include "arm11/drivers/lgy11.h"
 #include "kernel.h"
 #include "kevent.h"
+#include "arm11/boot_trace.h"
 
 
-static KHandle g_frameReadyEvent = 0;
-
+// Number of frames between headphone detection runs.
+#define HP_DETECT_INTERVAL  (8u)
 
 
-static u32 fixRomPadding(const u32 romFileSize)
+typedef struct
 {
-	// Pad unused ROM area with 0xFFs (trimmed ROMs).
-	// Smallest retail ROM chip is 8 Mbit (1 MiB).
-	u32 romSize = nextPow2(romFileSize);
-	romSize = (romSize < 0x100000 ? 0x100000 : romSize);
-	const uintptr_t romLoc = LGY_ROM_LOC;
-	memset((void*)(romLoc + romFileSize), 0xFF, romSize - romFileSize);
-
-	u32 mirroredSize = romSize;
-	if(romSize == 0x100000) // 1 MiB.
-	{
-		// ROM mirroring for Classic NES Series/others with 8 Mbit ROM.
-		// The ROM is mirrored exactly 4 times.
-		// Thanks to endrift for discovering this.
-		mirroredSize = 0x400000; // 4 MiB.
-		uintptr_t mirrorLoc = romLoc + romSize;
-		do
-		{
-			memcpy((void*)mirrorLoc, (void*)romLoc, romSize);
-			mirrorLoc += romSize;
-		} while(mirrorLoc < romLoc + mirroredSize);
-	}
+	u8 min;
+	u8 max;
+	GfxBl lcd;    // Backlight switched by the X+LEFT/RIGHT combos.
+} BacklightInfo;
+
+static KHandle g_frameReadyEvent = 0;
+static BacklightInfo g_blInfo = {0};
 
-	// Fake "open bus" padding.
-	if(romSize < LGY_MAX_ROM_SIZE)
-		makeOpenBusPaddingFast((u32*)(romLoc + mirroredSize));
 
-	// We don't return the mirrored size because the db hashes are over unmirrored dumps.
-	return romSize;
-}
 
-static Result loadGbaRom(const char *const path, u32 *const romSizeOut)
+// The system model is read over I2C. Only do it once.
+static const BacklightInfo* getBacklightInfo(void)
 {
-	FHandle f;
-	Result res = fOpen(&f, path, FA_OPEN_EXISTING | FA_READ);
-	if(res == RES_OK)
+	BacklightInfo *const info = &g_blInfo;
+	if(info->max == 0)
 	{
-		u32 fileSize = fSize(f);
-		if(fileSize > LGY_MAX_ROM_SIZE)
+		const u8 model = MCU_getSystemModel();
+		if(model >= 4)
 		{
-			fileSize = LGY_MAX_ROM_SIZE;
-			ee_puts("Warning: ROM file is too big. Expect crashes.");
+			info->min = 16;
+			info->max = 142;
 		}
-
-		u32 read;
-		res = fRead(f, (void*)LGY_ROM_LOC, fileSize, &read);
-		fClose(f);
-
-		if(read == fileSize) *romSizeOut = fixRomPadding(fileSize);
-
+		else
+		{
+			info->min = 20;
+			info->max = 117;
+		}
+		info->lcd = (model != SYS_MODEL_2DS ? GFX_BL_TOP : GFX_BL_BOT);
 	}
 
-	return res;
+	return info;
 }
 
 void changeBacklight(s16 amount)
 {
-	u8 min, max;
-	if(MCU_getSystemModel() >= 4)
-	{
-		min = 16;
-		max = 142;
-	}
-	else
-	{
-		min = 20;
-		max = 117;
-	}
+	const BacklightInfo *const info = getBacklightInfo();
+	const u8 min = info->min;
+	const u8 max = info->max;
 
 	s16 newVal = g_oafConfig.backlight + amount;
 	newVal = (newVal > max ? max : newVal);
@@ -122,41 +99,38 @@ void changeBacklight(s16 amount)
 	GFX_setLcdLuminance(newVal);
 }
 
-static void updateBacklight(void)
+static void updateBacklight(const u32 kHeld)
 {
 	// Check for special button combos.
-	const u32 kHeld = hidKeysHeld();
 	static bool backlightOn = true;
-	if(hidKeysDown() && kHeld)
-	{
-		// Adjust LCD brightness up.
-		const s16 steps = g_oafConfig.backlightSteps;
-		if(kHeld == (KEY_X | KEY_DUP))
-			changeBacklight(steps);
 
-		// Adjust LCD brightness down.
-		if(kHeld == (KEY_X | KEY_DDOWN))
-			changeBacklight(-steps);
+	// Adjust LCD brightness up.
+	const s16 steps = g_oafConfig.backlightSteps;
+	if(kHeld == (KEY_X | KEY_DUP))
+		changeBacklight(steps);
 
-		// Disable backlight switching in debug builds on 2DS.
-		const GfxBl lcd = (MCU_getSystemModel() != SYS_MODEL_2DS ? GFX_BL_TOP : GFX_BL_BOT);
+	// Adjust LCD brightness down.
+	if(kHeld == (KEY_X | KEY_DDOWN))
+		changeBacklight(-steps);
+
+	// Disable backlight switching in debug builds on 2DS.
+	const GfxBl lcd = getBacklightInfo()->lcd;
 #ifndef NDEBUG
-		if(lcd != GFX_BL_BOT)
+	if(lcd != GFX_BL_BOT)
 #endif
+	{
+		// Turn off backlight.
+		if(backlightOn && kHeld == (KEY_X | KEY_DLEFT))
 		{
-			// Turn off backlight.
-			if(backlightOn && kHeld == (KEY_X | KEY_DLEFT))
-			{
-				backlightOn = false;
-				GFX_powerOffBacklight(lcd);
-			}
+			backlightOn = false;
+			GFX_powerOffBacklight(lcd);
+		}
 
-			// Turn on backlight.
-			if(!backlightOn && kHeld == (KEY_X | KEY_DRIGHT))
-			{
-				backlightOn = true;
-				GFX_powerOnBacklight(lcd);
-			}
+		// Turn on backlight.
+		if(!backlightOn && kHeld == (KEY_X | KEY_DRIGHT))
+		{
+			backlightOn = true;
+			GFX_powerOnBacklight(lcd);
 		}
 	}
 }
@@ -258,6 +232,10 @@ Result oafParseConfigEarly(void)
 		res = fMkdir(OAF_SCREENSHOT_DIR);
 		if(res != RES_OK && res != RES_FR_EXIST) break;
 
+		// Create cache folder.
+		res = fMkdir(OAF_CACHE_DIR);
+		if(res != RES_OK && res != RES_FR_EXIST) break;
+
 		// Parse the config.
 		res = parseOafConfig("config.ini", &g_oafConfig, true);
 	} while(0);
@@ -283,61 +261,127 @@ Result oafInitAndRun(void)
 				ee_puts("Loading...");
 			}
 			else if(res != RES_OK) break;
+			bootTraceMark("ROM path", 0); // Includes the file browser.
 
 			//make copy of rom path
 			char *const romFilePath = (char*)calloc(strlen(filePath)+1, 1);
 			if(romFilePath == NULL) { res = RES_OUT_OF_MEM; break; }
 			strcpy(romFilePath, filePath);
 
-			// Load the ROM file.
-			u32 romSize;
-			res = loadGbaRom(filePath, &romSize);
-			if(res != RES_OK) break;
-
-			// Load the per-game config.
+			// Load the per-game config first. It decides what needs to be done while loading the ROM.
+			// With the profile store the saves dir is only searched for new games.
+			// Holding Y imports the .ini again after editing it.
 			rom2GameCfgPath(filePath);
-			res = parseOafConfig(filePath, &g_oafConfig, false);
-			if(res != RES_OK && res != RES_FR_NO_FILE) break;
+			if(g_oafConfig.profileStore)
+			{
+				hidScanInput();
+				res = loadGameProfile(filePath, &g_oafConfig, hidKeysHeld() == KEY_Y);
+			}
+			else res = parseOafConfig(filePath, &g_oafConfig, false);
+			if(res != RES_OK && res != RES_FR_NO_FILE)
+			{
+				free(romFilePath);
+				break;
+			}
 
-			// Adjust the path for the save file and get save type.
+			// Adjust the path for the save file.
 			gameCfg2SavePath(filePath, g_oafConfig.saveSlot);
+			bootTraceMark("Game config", 0);
+
+			// Loading, hashing and patching are CPU bound. New 3DS only.
+			if(g_oafConfig.n3dsBoost) perfModeEnter();
+
+			// Get hash, SDK save type and gba_db.bin lookup from previous launches.
+			RomInfo romInfo;
+			romCacheLookup(romFilePath, &romInfo);
+			const u8 cachedFlags = romInfo.flags;
+			bootTraceMark("ROM cache", 0);
+
+			// The patch cache is keyed on the unpatched ROM so it needs the hash.
+			// Save type detection must not see the patched ROM either.
+			PatchFileInfo patchInfo;
+			const bool patchCache = g_oafConfig.patchCache && findRomPatch(romFilePath, &patchInfo);
+			const u8 patchCacheFlags = ROM_LOAD_HASH | ROM_LOAD_SCAN;
+
+			// Load the ROM file. Hashing and save string scanning overlap with the SD reads.
+			u8 loadFlags = 0;
+			const bool needHash = g_oafConfig.useGbaDb || g_oafConfig.saveOverride;
+			if(g_oafConfig.saveType == 0xFF)
+				loadFlags = ROM_LOAD_SCAN | (needHash ? ROM_LOAD_HASH : 0);
+			if(patchCache) loadFlags |= patchCacheFlags;
+			loadFlags &= ~cachedFlags;
+
+			// An already patched ROM can be loaded as is if we know everything about the unpatched one.
+			bool patched = false;
+			if(patchCache && (cachedFlags & patchCacheFlags) == patchCacheFlags)
+			{
+				char cachePath[PATCH_CACHE_PATH_LEN];
+				if(patchCacheFind(romInfo.sha1, &patchInfo, cachePath))
+					patched = loadGbaRom(cachePath, loadFlags, &romInfo) == RES_OK;
+			}
+
+			if(!patched) res = loadGbaRom(romFilePath, loadFlags, &romInfo);
+			if(res != RES_OK)
+			{
+				free(romFilePath);
+				break;
+			}
+
+			// Get save type.
 			u16 saveType;
 			if(g_oafConfig.saveType != 0xFF)
 				saveType = g_oafConfig.saveType;
-			else if(g_oafConfig.useGbaDb || g_oafConfig.saveOverride)
-				saveType = getSaveType(&g_oafConfig, romSize, filePath);
+			else if(needHash)
+				saveType = getSaveType(&g_oafConfig, &romInfo, filePath);
 			else
-				saveType = detectSaveType(romSize, g_oafConfig.defaultSave);
+				saveType = detectSaveType(romInfo.sdkSaveType, g_oafConfig.defaultSave);
+
+			// Only the unpatched ROM is cached here. See patch cache for patched ones.
+			if(romInfo.flags != cachedFlags) romCacheUpdate(romFilePath, &romInfo);
+			bootTraceMark("Save type", 0);
 
-			patchRom(romFilePath, &romSize);
+			u32 romSize = romInfo.romSize;
+			if(!patched)
+			{
+				const Result patchRes = patchRom(romFilePath, &romSize);
+				if(patchCache && patchRes == RES_OK) patchCacheQueue(romInfo.sha1, &patchInfo, romSize);
+			}
 			free(romFilePath);
+			bootTraceMark("Patch", (patched ? 0 : romSize));
 
 			// Set audio output and volume.
 			CODEC_setAudioOutput(g_oafConfig.audioOut);
 			CODEC_setVolumeOverride(g_oafConfig.volume);
 
 			// Prepare ARM9 for GBA mode + save loading.
+			waitForRomPadding();
 			res = LGY_prepareGbaMode(g_oafConfig.directBoot, saveType, filePath);
+			bootTraceMark("GBA mode setup", 0);
 			if(res == RES_OK)
 			{
+				// Core 1 can't take part in clock switches after video init.
+				perfModeExit();
+
 				// Initialize video output (frame capture, post processing ect.).
 				g_frameReadyEvent = OAF_videoInit();
+				bootTraceMark("Video init", 0);
 
-				// Setup button overrides.
-				const u32 *const maps = g_oafConfig.buttonMaps;
-				u16 overrides = 0;
-				for(unsigned i = 0; i < 10; i++)
-					if(maps[i] != 0) overrides |= 1u<<i;
-				LGY11_selectInput(overrides);
+				// Setup button overrides and start input sampling.
+				OAF_inputInit(g_oafConfig.buttonMaps, g_oafConfig.inputRate);
 
 				// Sync LgyCap start with LCD VBlank.
 				GFX_waitForVBlank0();
 				LGY11_switchMode();
+
+				// The GBA only reads the ROM so it can be written to the cache now.
+				patchCacheStart();
 			}
 		} while(0);
 	}
 	else res = RES_OUT_OF_MEM;
 
+	// Error paths. Does nothing if already left above.
+	perfModeExit();
 	free(filePath);
 
 	return res;
@@ -345,24 +389,37 @@ Result oafInitAndRun(void)
 
 void oafUpdate(void)
 {
-	const u32 *const maps = g_oafConfig.buttonMaps;
-	const u32 kHeld = hidKeysHeld();
-	u16 pressed = 0;
-	for(unsigned i = 0; i < 10; i++)
+	OAF_inputUpdate();
+
+	// Headphone insertion doesn't need checking every frame.
+	// Stays on the main task because hidScanInput() uses the same buses.
+	static u32 frames = 0;
+	if(++frames >= HP_DETECT_INTERVAL)
 	{
-		if((kHeld & maps[i]) != 0)
-			pressed |= 1u<<i;
+		frames = 0;
+		CODEC_runHeadphoneDetection();
 	}
-	LGY11_setInputState(pressed);
 
-	CODEC_runHeadphoneDetection();
-	updateBacklight();
+	const u32 kHeld = hidKeysHeld();
+	if(hidKeysDown() && kHeld) updateBacklight(kHeld);
+
 	waitForEvent(g_frameReadyEvent);
 	clearEvent(g_frameReadyEvent);
+
+	static bool firstFrame = true;
+	if(firstFrame)
+	{
+		firstFrame = false;
+		bootTraceMark("First frame", 0);
+		bootTraceFinish();
+	}
 }
 
 void oafFinish(void)
 {
+	patchCacheExit();
+	OAF_inputExit();
+
 	// frameReadyEvent deleted by this function.
 	OAF_videoExit();
 	g_frameReadyEvent = 0;
@@ -28,213 +28,571 @@
 #include "arm11/patch.h"
 #include "arm11/power.h"
 #include "drivers/sha.h"
+#include "arm11/rom_loader.h"
 
 
-#define min(a, b)  ((size_t) (a) <= (size_t) (b) ? (size_t) (a) : (size_t) (b))
+#define PATCH_BUF_SIZE  (1024u * 32)
+// Spare FCRAM after the ROM area. Unused until GBA mode starts.
+#define BPS_SOURCE_LOC  (LGY_ROM_LOC + LGY_MAX_ROM_SIZE)
 
 
+// Buffered patch file reader. Tracks the file position itself so
+// refills don't need fSize()/fTell() calls.
 typedef struct
 {
-	u8 *buffer;
-	u16 cacheSize;
-	u16 cacheOffset;
-	u16 maxCacheSize;
-} Cache;
+	FHandle f;
+	u8 *buf;
+	u32 pos;      // Read position in buf.
+	u32 size;     // Valid bytes in buf.
+	u32 filePos;  // File position of buf[size].
+	u32 end;      // Don't read past this file position.
+	u32 crc;      // CRC32 over everything read from the file so far.
+	Result res;
+} PatchReader;
 
 
 
-static u8 readCache(const FHandle patchHandle, Cache *cache, Result *res) {
-	u8 result = (cache->buffer)[(cache->cacheOffset)++];
-	if((cache->cacheOffset) >= (cache->cacheSize)) {
-		(cache->cacheSize) = min((cache->maxCacheSize), ((fSize(patchHandle)-12) - fTell(patchHandle)));
-		*res = fRead(patchHandle, (cache->buffer), (cache->cacheSize), NULL);
-		(cache->cacheOffset) = 0;
+static u32 g_crc32Table[256];
+
+static void makeCrc32Table(void)
+{
+	if(g_crc32Table[1] != 0) return;
+
+	for(u32 i = 0; i < 256; i++)
+	{
+		u32 c = i;
+		for(u32 k = 0; k < 8; k++) c = (c & 1u ? 0xEDB88320u ^ (c>>1) : c>>1);
+		g_crc32Table[i] = c;
 	}
+}
 
-	return result;
+static u32 crc32Update(u32 crc, const u8 *data, u32 size)
+{
+	crc = ~crc;
+	while(size--) crc = g_crc32Table[(crc ^ *data++) & 0xFFu] ^ (crc>>8);
+
+	return ~crc;
 }
 
-static Result patchIPS(const FHandle patchHandle) {
-	ee_puts("IPS patch found! Patching...");
+static Result readerInit(PatchReader *const r, const FHandle f, const u32 end)
+{
+	makeCrc32Table();
+
+	r->f       = f;
+	r->buf     = (u8*)malloc(PATCH_BUF_SIZE);
+	r->pos     = 0;
+	r->size    = 0;
+	r->filePos = fTell(f);
+	r->end     = end;
+	r->crc     = 0;
+	r->res     = (r->buf == NULL ? RES_OUT_OF_MEM : RES_OK);
+
+	return r->res;
+}
 
-	const u16 bufferSize = 512;
-	char *buffer = (char*)calloc(bufferSize, 1);
-	if(buffer == NULL) return RES_OUT_OF_MEM;
+static void readerDeinit(PatchReader *const r)
+{
+	free(r->buf);
+	r->buf = NULL;
+}
 
-	// Verify patch is IPS (magic number "PATCH").
-	Result res = fRead(patchHandle, buffer, 5, NULL);
-	if(res != RES_OK || memcmp("PATCH", buffer, 5) != 0)
+// Returns the number of new bytes in the buffer. 0 on error or end.
+static u32 readerRefill(PatchReader *const r)
+{
+	if(r->res != RES_OK) return 0;
+
+	// Keep unread bytes.
+	const u32 left = r->size - r->pos;
+	memmove(r->buf, r->buf + r->pos, left);
+	r->pos  = 0;
+	r->size = left;
+
+	u32 toRead = r->end - r->filePos;
+	toRead = (toRead > PATCH_BUF_SIZE - left ? PATCH_BUF_SIZE - left : toRead);
+	if(toRead == 0) return 0;
+
+	u32 read;
+	r->res = fRead(r->f, r->buf + left, toRead, &read);
+	if(r->res != RES_OK) return 0;
+	if(read != toRead)
 	{
-		free(buffer);
-		return RES_INVALID_PATCH;
+		r->res = RES_PATCH_CORRUPT;
+		return 0;
 	}
 
-	u32 offset = 0;
-	u16 length = 0;
-	while(res == RES_OK)
-	{
-		// Read offset.
-		res = fRead(patchHandle, buffer, 3, NULL);
-		if(res != RES_OK || memcmp("EOF", buffer, 3) == 0) break;
-		offset = (buffer[0] << 16) + (buffer[1] << 8) + buffer[2];
+	r->crc      = crc32Update(r->crc, r->buf + left, read);
+	r->size    += read;
+	r->filePos += read;
 
-		// Read length.
-		res = fRead(patchHandle, buffer, 2, NULL);
-		if(res != RES_OK) break;
-		length = (buffer[0] << 8) + buffer[1];
+	return read;
+}
 
-		// RLE hunk.
-		if(length == 0)
-		{
-			res = fRead(patchHandle, buffer, 3, NULL);
-			if(res != RES_OK) break;
+static inline u32 readerTell(const PatchReader *const r)
+{
+	return r->filePos - (r->size - r->pos);
+}
 
-			length = (buffer[0] << 8) + buffer[1];
-			memset((void*)(LGY_ROM_LOC + offset), buffer[2], length * sizeof(char));
+static inline bool readerEof(const PatchReader *const r)
+{
+	return readerTell(r) >= r->end;
+}
 
-			continue;
-		}
+static inline u8 readerU8(PatchReader *const r)
+{
+	if(r->pos == r->size && readerRefill(r) == 0)
+	{
+		if(r->res == RES_OK) r->res = RES_PATCH_CORRUPT; // Truncated.
+		return 0;
+	}
 
-		// Regular hunks.
-		u16 fullCount = length / bufferSize;
-		for(u16 i = 0; i < fullCount; ++i)
+	return r->buf[r->pos++];
+}
+
+// Variable length integer as used by UPS and BPS.
+static u32 readerVuint(PatchReader *const r)
+{
+	u32 result = 0, shift = 0;
+	while(r->res == RES_OK)
+	{
+		const u8 octet = readerU8(r);
+		if(octet & 0x80u)
 		{
-			res = fRead(patchHandle, buffer, bufferSize, NULL);
-			if(res != RES_OK) break;
+			result += (u32)(octet & 0x7Fu)<<shift;
+			break;
+		}
+		result += (u32)(octet | 0x80u)<<shift;
+		shift += 7;
+		if(shift > 28) r->res = RES_PATCH_CORRUPT; // Would overflow.
+	}
+
+	return result;
+}
 
-			for(u16 j = 0; j < bufferSize; ++j)
+// Reads size bytes. Big reads bypass the buffer.
+static Result readerRead(PatchReader *const r, void *const dst, u32 size)
+{
+	u8 *d = (u8*)dst;
+	while(size > 0 && r->res == RES_OK)
+	{
+		const u32 avail = r->size - r->pos;
+		if(avail == 0)
+		{
+			if(size >= PATCH_BUF_SIZE)
 			{
-				*(char*)(LGY_ROM_LOC + offset + (bufferSize * i) + j) = buffer[j];
+				u32 read;
+				if(size > r->end - r->filePos) r->res = RES_PATCH_CORRUPT; // Truncated.
+				else r->res = fRead(r->f, d, size, &read);
+				if(r->res != RES_OK) break;
+				if(read != size)
+				{
+					r->res = RES_PATCH_CORRUPT;
+					break;
+				}
+
+				r->crc      = crc32Update(r->crc, d, size);
+				r->filePos += size;
+				r->pos      = 0;
+				r->size     = 0;
+				break;
 			}
+
+			if(readerRefill(r) == 0 && r->res == RES_OK) r->res = RES_PATCH_CORRUPT; // Truncated.
+			continue;
 		}
 
-		u16 remaining = length % bufferSize;
-		if(remaining == 0) continue;
+		const u32 num = (avail < size ? avail : size);
+		memcpy(d, r->buf + r->pos, num);
+		r->pos += num;
+		d      += num;
+		size   -= num;
+	}
 
-		res = fRead(patchHandle, buffer, remaining, NULL);
-		if(res != RES_OK) break;
+	return r->res;
+}
 
-		for(u16 j = 0; j < remaining; ++j)
+static Result readerSkip(PatchReader *const r, u32 size)
+{
+	while(size > 0 && r->res == RES_OK)
+	{
+		const u32 avail = r->size - r->pos;
+		if(avail == 0)
 		{
-			*(char*)(LGY_ROM_LOC + offset + (bufferSize * fullCount) + j) = buffer[j];
+			if(readerRefill(r) == 0 && r->res == RES_OK) r->res = RES_PATCH_CORRUPT; // Truncated.
+			continue;
 		}
+
+		const u32 num = (avail < size ? avail : size);
+		r->pos += num;
+		size   -= num;
 	}
 
-	free(buffer);
+	return r->res;
+}
 
-	return res;
+// Reads the source/target CRCs after the patch body and verifies the patch CRC.
+// The reader end must be the file size - 4 so the CRC covers exactly the right bytes.
+static Result readerCheckFooter(PatchReader *const r)
+{
+	for(u32 i = 0; i < 8; i++) (void)readerU8(r); // Source and target CRC. Not checked.
+	if(r->res != RES_OK) return r->res;
+	if(!readerEof(r)) return RES_PATCH_CORRUPT;
+
+	u32 patchCrc;
+	u32 read;
+	const Result res = fRead(r->f, &patchCrc, 4, &read);
+	if(res != RES_OK) return res;
+	if(read != 4 || patchCrc != r->crc) return RES_PATCH_CORRUPT;
+
+	return RES_OK;
 }
 
-//based on code from http://fileformats.archiveteam.org/wiki/UPS_(binary_patch_format) (CC0, No copyright)
-static uintmax_t read_vuint(const FHandle patchFile, Result *res, Cache *cache) {
-	uintmax_t result = 0, shift = 0;
-
-	uint8_t octet = 0;
-	for (;;) {
-		//*res = fRead(patchFile, &octet, 1, NULL);
-		octet = readCache(patchFile, cache, res);
-		if(*res != RES_OK) break;
-		if(octet & 0x80) {
-			result += (octet & 0x7f) << shift;
+static Result patchIPS(const FHandle patchHandle, UNUSED u32 *romSize)
+{
+	PatchReader r;
+	Result res = readerInit(&r, patchHandle, fSize(patchHandle));
+	if(res != RES_OK) return res;
+
+	ee_puts("IPS patch found! Patching...");
+
+	do
+	{
+		// Verify patch is IPS (magic number "PATCH").
+		u8 magic[5];
+		res = readerRead(&r, magic, 5);
+		if(res != RES_OK || memcmp(magic, "PATCH", 5) != 0)
+		{
+			res = RES_INVALID_PATCH;
 			break;
 		}
-		result += (octet | 0x80) << shift;
-		shift += 7;
-	}
 
-	return result;
+		// Patches may write to the padding which could still be in progress.
+		waitForRomPadding();
+
+		// Offsets are 24 bit and lengths 16 bit so hunks always fit in the ROM area.
+		u8 *const romBytes = (u8*)LGY_ROM_LOC;
+		while(1)
+		{
+			// Read offset.
+			u8 hdr[5];
+			res = readerRead(&r, hdr, 3);
+			if(res != RES_OK || memcmp(hdr, "EOF", 3) == 0) break;
+			const u32 offset = (u32)hdr[0]<<16 | (u32)hdr[1]<<8 | hdr[2];
+
+			// Read length.
+			res = readerRead(&r, &hdr[3], 2);
+			if(res != RES_OK) break;
+			u32 length = (u32)hdr[3]<<8 | hdr[4];
+
+			if(length == 0)
+			{
+				// RLE hunk.
+				u8 rle[3];
+				res = readerRead(&r, rle, 3);
+				if(res != RES_OK) break;
+
+				length = (u32)rle[0]<<8 | rle[1];
+				memset(romBytes + offset, rle[2], length);
+			}
+			else
+			{
+				// Regular hunk. Copied straight from the read buffer.
+				res = readerRead(&r, romBytes + offset, length);
+				if(res != RES_OK) break;
+			}
+		}
+	} while(0);
+
+	readerDeinit(&r);
+
+	return res;
 }
 
-static Result patchUPS(const FHandle patchHandle, u32 *romSize) {
-	Result res = RES_OK;
+// XOR with word accesses for the aligned part of dst.
+static void xorBytes(u8 *dst, const u8 *src, u32 size)
+{
+	while(size > 0 && ((uintptr_t)dst & 3u) != 0)
+	{
+		*dst++ ^= *src++;
+		size--;
+	}
 
-	Cache cache = {
-		(u8*)calloc(512, 1), //buffer
-		0,                   //cache size
-		0,                   //cache offset
-		512                  //max cache size
-	};
-	if(cache.buffer == NULL) {
-		return RES_OUT_OF_MEM;
+	u32 *dst32 = (u32*)dst;
+	while(size >= 4)
+	{
+		u32 tmp;
+		memcpy(&tmp, src, 4); // src may be unaligned.
+		*dst32++ ^= tmp;
+		src += 4;
+		size -= 4;
 	}
 
-	//read data into cache for first time
-	cache.cacheSize = min(cache.maxCacheSize, (fSize(patchHandle)-12)-fTell(patchHandle));
-	res = fRead(patchHandle, cache.buffer, cache.cacheSize, NULL);
-	if(res != RES_OK) { free(cache.buffer); return res; }
+	dst = (u8*)dst32;
+	while(size--) *dst++ ^= *src++;
+}
 
-	ee_puts("UPS patch found! Patching...");
+// Format: http://fileformats.archiveteam.org/wiki/UPS_(binary_patch_format)
+static Result patchUPS(const FHandle patchHandle, u32 *romSize)
+{
+	const u32 patchSize = fSize(patchHandle);
+	if(patchSize < 4 + 2 + 12) return RES_INVALID_PATCH;
 
-	//verify patch is UPS (magic number is "UPS1")
-	u8 magic[] = {0x00, 0x00, 0x00, 0x00}; 
-	bool isValidPatch = false;
-	for(u8 i=0; i<4; i++) {
-		magic[i] = readCache(patchHandle, &cache, &res);
-		if(res != RES_OK) break;
-	}
+	PatchReader r;
+	Result res = readerInit(&r, patchHandle, patchSize - 4);
+	if(res != RES_OK) return res;
+
+	ee_puts("UPS patch found! Patching...");
 
-	if(res == RES_OK) {
-		if(memcmp(&magic, "UPS1", 4) == 0) {
-			isValidPatch = true;
-		} else {
+	do
+	{
+		// Verify patch is UPS (magic number is "UPS1").
+		u8 magic[4];
+		for(u32 i = 0; i < 4; i++) magic[i] = readerU8(&r);
+		if(r.res != RES_OK || memcmp(magic, "UPS1", 4) != 0)
+		{
 			res = RES_INVALID_PATCH;
+			break;
 		}
-	}
 
-	if(isValidPatch) {
-		//get rom size
-		u32 baseRomSize = (u32)read_vuint(patchHandle, &res, &cache);
-		if(res != RES_OK) { free(cache.buffer); return res; }
-		//get patched rom size
-		u32 patchedRomSize = (u32)read_vuint(patchHandle, &res, &cache);
-		if(res != RES_OK) { free(cache.buffer); return res; }
-
-		debug_printf("Base size:    0x%lx\nPatched size: 0x%lx\n", baseRomSize, patchedRomSize);
-
-		if(patchedRomSize > baseRomSize) {
-			//scale up rom
-			*romSize = nextPow2(patchedRomSize);
-			//check if upscaled rom is too big
-			if(*romSize > LGY_MAX_ROM_SIZE) {
+		const u32 baseRomSize    = readerVuint(&r);
+		const u32 patchedRomSize = readerVuint(&r);
+		if(r.res != RES_OK)
+		{
+			res = r.res;
+			break;
+		}
+		debug_printf("Base size:    0x%" PRIX32 "\nPatched size: 0x%" PRIX32 "\n", baseRomSize, patchedRomSize);
+
+		if(patchedRomSize > baseRomSize)
+		{
+			// Scale up ROM and check if it's too big.
+			const u32 newRomSize = nextPow2(patchedRomSize);
+			if(newRomSize > LGY_MAX_ROM_SIZE || baseRomSize > LGY_MAX_ROM_SIZE)
+			{
 				ee_puts("Patched ROM exceeds 32MB! Skipping patching...");
-				free(cache.buffer);
-				return RES_INVALID_PATCH; 
+				res = RES_INVALID_PATCH;
+				break;
 			}
 
-			memset((char*)(LGY_ROM_LOC + baseRomSize), 0xFFu, *romSize - baseRomSize); //fill out extra rom space
-			memset((char*)(LGY_ROM_LOC + baseRomSize), 0x00u, patchedRomSize - baseRomSize); //fill new patch area with 0's
+			// Patches may write to the padding which could still be in progress.
+			waitForRomPadding();
+			*romSize = newRomSize;
+			memset((u8*)LGY_ROM_LOC + baseRomSize, 0xFF, newRomSize - baseRomSize);    // Fill out extra ROM space.
+			memset((u8*)LGY_ROM_LOC + baseRomSize, 0x00, patchedRomSize - baseRomSize); // Fill new patch area with 0s.
 		}
+		else waitForRomPadding();
+
+		// Hunks: relative offset followed by XOR data terminated by 0x00.
+		// Whole XOR runs are located with memchr() and applied in bulk.
+		u8 *const romBytes = (u8*)LGY_ROM_LOC;
+		const u32 bodyEnd = patchSize - 12;
+		const u32 maxSize = *romSize;
+		u32 offset = 0;
+		while(r.res == RES_OK && readerTell(&r) < bodyEnd)
+		{
+			offset += readerVuint(&r);
 
-		uintmax_t patchFileSize = fSize(patchHandle);
+			while(r.res == RES_OK)
+			{
+				if(r.pos == r.size && readerRefill(&r) == 0)
+				{
+					if(r.res == RES_OK) r.res = RES_PATCH_CORRUPT; // Missing terminator.
+					break;
+				}
 
-		uintmax_t offset = 0;
-		u8 readByte = 0;
-		u8 *romBytes = ((u8*)LGY_ROM_LOC);
+				const u8 *const src = r.buf + r.pos;
+				const u32 avail = r.size - r.pos;
+				const u8 *const term = (const u8*)memchr(src, 0, avail);
+				const u32 runSize = (term != NULL ? (u32)(term - src) : avail);
+				if(offset > maxSize || runSize > maxSize - offset)
+				{
+					r.res = RES_PATCH_CORRUPT;
+					break;
+				}
 
-		while(fTell(patchHandle) < (patchFileSize-12) && res==RES_OK) {
-			offset += read_vuint(patchHandle, &res, &cache);
-			if(res != RES_OK) break;
+				xorBytes(romBytes + offset, src, runSize);
+				offset += runSize;
+				r.pos  += runSize;
+				if(term != NULL)
+				{
+					// Skip the terminator. It stands for an unchanged byte.
+					r.pos++;
+					offset++;
+					break;
+				}
+			}
+		}
 
-			while(offset<*romSize) {
-				readByte = readCache(patchHandle, &cache, &res);
-				if(res != RES_OK) break;
+		res = (r.res != RES_OK ? r.res : readerCheckFooter(&r));
+	} while(0);
 
-				if(readByte == 0x00) {
-					offset++;
-					break; 
+	readerDeinit(&r);
+
+	return res;
+}
+
+// Format: https://github.com/blakesmith/rombp/blob/master/docs/bps_spec.md
+// The target is built in place at LGY_ROM_LOC. Target writes only ever happen at
+// the output offset and it only moves forward so SourceRead is a no-op.
+// SourceCopy can read anywhere so the source is staged in spare FCRAM first.
+static Result patchBPS(const FHandle patchHandle, u32 *romSize)
+{
+	const u32 patchSize = fSize(patchHandle);
+	if(patchSize < 4 + 3 + 12) return RES_INVALID_PATCH;
+
+	PatchReader r;
+	Result res = readerInit(&r, patchHandle, patchSize - 4);
+	if(res != RES_OK) return res;
+
+	ee_puts("BPS patch found! Patching...");
+
+	do
+	{
+		// Verify patch is BPS (magic number is "BPS1").
+		u8 magic[4];
+		res = readerRead(&r, magic, 4);
+		if(res != RES_OK || memcmp(magic, "BPS1", 4) != 0)
+		{
+			res = RES_INVALID_PATCH;
+			break;
+		}
+
+		const u32 sourceSize   = readerVuint(&r);
+		const u32 targetSize   = readerVuint(&r);
+		const u32 metadataSize = readerVuint(&r);
+		if(readerSkip(&r, metadataSize) != RES_OK)
+		{
+			res = r.res;
+			break;
+		}
+		debug_printf("Base size:    0x%" PRIX32 "\nPatched size: 0x%" PRIX32 "\n", sourceSize, targetSize);
+
+		if(sourceSize > LGY_MAX_ROM_SIZE || targetSize > LGY_MAX_ROM_SIZE)
+		{
+			ee_puts("Patched ROM exceeds 32MB! Skipping patching...");
+			res = RES_INVALID_PATCH;
+			break;
+		}
+
+		// Patches may write to the padding which could still be in progress.
+		waitForRomPadding();
+		u8 *const target = (u8*)LGY_ROM_LOC;
+		const u8 *const source = (u8*)BPS_SOURCE_LOC;
+		memcpy((void*)source, target, sourceSize);
+
+		const u32 bodyEnd = patchSize - 12;
+		u32 outOffset = 0;
+		u32 sourceRel = 0;
+		u32 targetRel = 0;
+		while(r.res == RES_OK && readerTell(&r) < bodyEnd)
+		{
+			const u32 data = readerVuint(&r);
+			const u32 length = (data>>2) + 1;
+			if(r.res != RES_OK) break;
+			if(length > targetSize - outOffset)
+			{
+				r.res = RES_PATCH_CORRUPT;
+				break;
+			}
+
+			switch(data & 3u)
+			{
+				case 0: // SourceRead.
+					if(outOffset + length > sourceSize) r.res = RES_PATCH_CORRUPT;
+					break;
+				case 1: // TargetRead.
+					readerRead(&r, target + outOffset, length);
+					break;
+				case 2: // SourceCopy.
+				{
+					const u32 rel = readerVuint(&r);
+					sourceRel = (rel & 1u ? sourceRel - (rel>>1) : sourceRel + (rel>>1));
+					if(sourceRel > sourceSize || length > sourceSize - sourceRel)
+					{
+						r.res = RES_PATCH_CORRUPT;
+						break;
+					}
+
+					memcpy(target + outOffset, source + sourceRel, length);
+					sourceRel += length;
+					break;
+				}
+				case 3: // TargetCopy.
+				{
+					const u32 rel = readerVuint(&r);
+					targetRel = (rel & 1u ? targetRel - (rel>>1) : targetRel + (rel>>1));
+					if(targetRel >= outOffset)
+					{
+						r.res = RES_PATCH_CORRUPT;
+						break;
+					}
+
+					// Overlapping copies repeat the pattern (like LZ77) so memmove() can't be used.
+					if(outOffset - targetRel >= length) memcpy(target + outOffset, target + targetRel, length);
+					else
+					{
+						for(u32 i = 0; i < length; i++) target[outOffset + i] = target[targetRel + i];
+					}
+					targetRel += length;
+					break;
 				}
-				romBytes[offset] ^= readByte;
-				offset++;
 			}
+
+			outOffset += length;
 		}
+		if(r.res == RES_OK && outOffset != targetSize) r.res = RES_PATCH_CORRUPT;
 
-	}
+		res = (r.res != RES_OK ? r.res : readerCheckFooter(&r));
+		if(res != RES_OK) break;
 
-	free(cache.buffer);
+		// Scale up ROM if needed and pad everything after the target.
+		u32 newRomSize = nextPow2(targetSize);
+		newRomSize = (newRomSize < 0x100000 ? 0x100000 : newRomSize);
+		if(newRomSize > *romSize) *romSize = newRomSize;
+		memset(target + targetSize, 0xFF, *romSize - targetSize);
+	} while(0);
+
+	readerDeinit(&r);
 
 	return res;
 }
 
+// Checked in this order. The first patch file found is used.
+static const struct
+{
+	char ext[4];
+	Result (*patch)(const FHandle, u32*);
+} g_patchTypes[NUM_PATCH_TYPES] = {{"ips", patchIPS}, {"ups", patchUPS}, {"bps", patchBPS}};
+
+bool findRomPatch(const char *const gamePath, PatchFileInfo *const info) {
+	//if X is held during launch, skip patching
+	hidScanInput();
+	if(hidKeysHeld() == KEY_X)
+		return false;
+
+	char *patchPath = (char*)malloc(512);
+	if(patchPath == NULL) return false;
+
+	bool found = false;
+	safeStrcpy(patchPath, gamePath, 512);
+	const size_t extensionOffset = strlen(patchPath) - 3;
+	for(u32 i = 0; i < NUM_PATCH_TYPES; i++)
+	{
+		strcpy(patchPath + extensionOffset, g_patchTypes[i].ext);
+		FILINFO fi;
+		if(fStat(patchPath, &fi) != RES_OK) continue;
+
+		info->size  = (u32)fi.fsize;
+		info->fdate = fi.fdate;
+		info->ftime = fi.ftime;
+		info->type  = i;
+		found = true;
+		break;
+	}
+	free(patchPath);
+
+	return found;
+}
+
 Result patchRom(const char *const gamePath, u32 *romSize) {
 	Result res = RES_OK;
 
@@ -254,30 +612,14 @@ Result patchRom(const char *const gamePath, u32 *romSize) {
 		strcpy(patchPathBase, gamePath);
 		memset(patchPathBase+extensionOffset, '\0', 3); //replace 'gba' with '\0' characters
 
-		FHandle f;
 		//check if patch file is present. If so, call appropriate patching function
-		if((res = fOpen(&f, strcat(patchPathBase, "ips"), FA_OPEN_EXISTING | FA_READ)) == RES_OK)
+		for(u32 i = 0; i < NUM_PATCH_TYPES; i++)
 		{
-			res = patchIPS(f);
-
-			if(res != RES_OK && res != RES_INVALID_PATCH) {
-				ee_puts("An error has occurred while patching.\nContinuing is NOT recommended!\n\nPress Y+UP to proceed");
-				while(1){
-					hidScanInput();
-					if(hidKeysHeld() == (KEY_Y | KEY_DUP) && hidKeysDown() != 0) break;
-					if(hidGetExtraKeys(0) & (KEY_POWER_HELD | KEY_POWER)) power_off();
-				}
-			}
+			memset(patchPathBase+extensionOffset, '\0', 3); //reset patchPathBase
+			FHandle f;
+			if((res = fOpen(&f, strcat(patchPathBase, g_patchTypes[i].ext), FA_OPEN_EXISTING | FA_READ)) != RES_OK) continue;
 
-			fClose(f);
-			goto cleanup;
-		}
-		//reset patchPathBase
-		memset(patchPathBase+extensionOffset, '\0', 3);
-
-		if ((res = fOpen(&f, strcat(patchPathBase, "ups"), FA_OPEN_EXISTING | FA_READ)) == RES_OK) 
-		{
-			res = patchUPS(f, romSize);
+			res = g_patchTypes[i].patch(f, romSize);
 
 			if(res != RES_OK && res != RES_INVALID_PATCH) {
 				ee_puts("An error has occurred while patching.\nContinuing is NOT recommended!\n\nPress Y+UP to proceed");
@@ -289,14 +631,14 @@ Result patchRom(const char *const gamePath, u32 *romSize) {
 			}
 
 			fClose(f);
-			goto cleanup;
+			break;
 		}
-
 	} else {
 		res = RES_OUT_OF_MEM;
 	}
 
-cleanup:
+	waitForRomPadding();
+
 	//cleanup our resources
 	free(patchPath);
 	free(patchPathBase);
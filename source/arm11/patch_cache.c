@@ -0,0 +1,185 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "arm11/patch_cache.h"
+#include "fs.h"
+#include "arm11/fmt.h"
+#include "drivers/lgy_common.h"
+#include "oaf_error_codes.h"
+#include "kernel.h"
+#include "kevent.h"
+
+
+#define PATCH_CACHE_TMP_PATH  PATCH_CACHE_DIR "/patched.tmp"
+#define HASH_PREFIX_LEN       (16u) // Hex digits of the base ROM hash in the file name.
+#define STALE_BATCH           (4u)  // Names collected per directory pass.
+#define WRITE_CHUNK_SIZE      (1024u * 1024) // Abort is checked between chunks.
+
+
+typedef struct
+{
+	u32 sha1[5];
+	PatchFileInfo patch;
+	u32 romSize;
+	vu8 abort;
+	KHandle doneEvent;
+} PatchCacheJob;
+
+static PatchCacheJob g_job = {0};
+
+
+
+// "cache/<64 bit ROM hash>-<patch size>-<patch timestamp>-<patch type>.bin"
+static void makeCachePath(const u32 sha1[5], const PatchFileInfo *const patch, char path[PATCH_CACHE_PATH_LEN])
+{
+	ee_snprintf(path, PATCH_CACHE_PATH_LEN, PATCH_CACHE_DIR "/%08" PRIX32 "%08" PRIX32 "-%08" PRIX32 "-%04X%04X-%u.bin",
+	            sha1[0], sha1[1], patch->size, patch->fdate, patch->ftime, patch->type);
+}
+
+bool patchCacheFind(const u32 sha1[5], const PatchFileInfo *const patch, char path[PATCH_CACHE_PATH_LEN])
+{
+	makeCachePath(sha1, patch, path);
+
+	FILINFO fi;
+	return fStat(path, &fi) == RES_OK;
+}
+
+// Removes cache files for the same base ROM except keepName.
+// FatFs doesn't allow removing entries of a directory while reading it
+// so the names are collected first and removed after closing it.
+static void removeStaleFiles(const char *const keepName)
+{
+	char names[STALE_BATCH][PATCH_CACHE_PATH_LEN - sizeof(PATCH_CACHE_DIR)];
+	u32 found;
+	do
+	{
+		DHandle dh;
+		if(fOpenDir(&dh, PATCH_CACHE_DIR) != RES_OK) return;
+
+		found = 0;
+		FILINFO fi;
+		u32 read;
+		while(found < STALE_BATCH && fReadDir(dh, &fi, 1, &read) == RES_OK && read == 1)
+		{
+			if(strncmp(fi.fname, keepName, HASH_PREFIX_LEN) != 0 || strcmp(fi.fname, keepName) == 0 ||
+			   strlen(fi.fname) >= sizeof(*names))
+				continue;
+
+			strcpy(names[found++], fi.fname);
+		}
+		fCloseDir(dh);
+
+		char path[PATCH_CACHE_PATH_LEN];
+		for(u32 i = 0; i < found; i++)
+		{
+			ee_snprintf(path, PATCH_CACHE_PATH_LEN, PATCH_CACHE_DIR "/%s", names[i]);
+			if(fUnlink(path) != RES_OK) return; // Don't loop forever on the same names.
+		}
+	} while(found == STALE_BATCH);
+}
+
+static Result storeRom(PatchCacheJob *const job)
+{
+	char path[PATCH_CACHE_PATH_LEN];
+	makeCachePath(job->sha1, &job->patch, path);
+
+	Result res;
+	do
+	{
+		// The cache dir is created by oafParseConfigEarly().
+		// Write to a temporary file first so an interrupted write
+		// never leaves a truncated image with a valid name behind.
+		FHandle f;
+		res = fOpen(&f, PATCH_CACHE_TMP_PATH, FA_CREATE_ALWAYS | FA_WRITE);
+		if(res != RES_OK) break;
+
+		const u32 romSize = job->romSize;
+		for(u32 pos = 0; pos < romSize && res == RES_OK; )
+		{
+			if(job->abort) res = RES_FR_DENIED;
+			else
+			{
+				const u32 chunkSize = (romSize - pos < WRITE_CHUNK_SIZE ? romSize - pos : WRITE_CHUNK_SIZE);
+				u32 written;
+				res = fWrite(f, (void*)(LGY_ROM_LOC + pos), chunkSize, &written);
+				if(res == RES_OK && written != chunkSize) res = RES_FR_DENIED; // Most likely the SD card is full.
+				pos += chunkSize;
+			}
+		}
+		fClose(f);
+		if(res != RES_OK)
+		{
+			fUnlink(PATCH_CACHE_TMP_PATH);
+			break;
+		}
+
+		fUnlink(path);
+		res = fRename(PATCH_CACHE_TMP_PATH, path);
+		if(res != RES_OK) break;
+
+		removeStaleFiles(path + sizeof(PATCH_CACHE_DIR));
+	} while(0);
+
+	return res;
+}
+
+static void patchCacheWriter(void *args)
+{
+	PatchCacheJob *const job = (PatchCacheJob*)args;
+
+	const Result res = storeRom(job);
+	if(res != RES_OK) debug_printf("Failed to write patch cache: %s\n", oafResult2String(res));
+
+	signalEvent(job->doneEvent, false);
+	taskExit();
+}
+
+void patchCacheQueue(const u32 sha1[5], const PatchFileInfo *const patch, const u32 romSize)
+{
+	PatchCacheJob *const job = &g_job;
+	memcpy(job->sha1, sha1, sizeof(job->sha1));
+	job->patch   = *patch;
+	job->romSize = romSize;
+	job->abort   = false;
+}
+
+void patchCacheStart(void)
+{
+	PatchCacheJob *const job = &g_job;
+	if(job->romSize == 0 || job->doneEvent != 0) return;
+
+	// Lowest priority. Only runs while everything else waits.
+	job->doneEvent = createEvent(false);
+	createTask(0x800, 1, patchCacheWriter, job);
+}
+
+void patchCacheExit(void)
+{
+	PatchCacheJob *const job = &g_job;
+	if(job->doneEvent != 0)
+	{
+		// Stops after the current chunk. The temporary file is removed.
+		job->abort = true;
+		waitForEvent(job->doneEvent);
+		deleteEvent(job->doneEvent);
+		job->doneEvent = 0;
+	}
+	job->romSize = 0;
+}
@@ -0,0 +1,160 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "types.h"
+#include "arm11/perf.h"
+#include "arm11/fmt.h"
+#include "fs.h"
+
+
+#ifndef NDEBUG
+#define OVERLAY_INTERVAL  (30u) // Frames between overlay updates.
+#define CSV_LINE_MAX      (80u)
+
+
+typedef struct
+{
+	u32 ticks[PERF_FRAME_STAGES];
+} PerfFrame;
+
+// Single writer (gfx task). Core 1 ticks are handed over with PERF_FRAME_SET()
+// because core 1 uses its own tick counter.
+static PerfFrame g_perfRing[PERF_RING_SIZE];
+static u32 g_perfHead = 0;      // Number of completed records.
+static u32 g_perfBegin = 0;     // Ticks at frame begin.
+static u32 g_perfLastMark = 0;
+static PerfFrame g_perfCur;
+#endif
+
+
+
+void perfInit(void)
+{
+	// Timer mode, auto reload, no IRQ, prescaler 1.
+	PERF_WDT_CNT     = 0;
+	PERF_WDT_LOAD    = 0xFFFFFFFFu;
+	PERF_WDT_COUNTER = 0xFFFFFFFFu;
+	PERF_WDT_CNT     = 1u<<1 | 1u; // Auto reload, enable.
+}
+
+void perfSetClockMul(const u32 clockMul)
+{
+	// Prescaler in bits 8-15. Divides by value + 1.
+	PERF_WDT_CNT = (clockMul - 1)<<8 | 1u<<1 | 1u;
+}
+
+void perfPrint(const char *const name, const u32 ticks)
+{
+	ee_printf("%s: %" PRIu32 " us\n", name, PERF_TICKS2US(ticks));
+}
+
+#ifndef NDEBUG
+void perfFrameBegin(void)
+{
+	const u32 now = perfGetTicks();
+	g_perfCur = (PerfFrame){0};
+	g_perfCur.ticks[PERF_FRAME_INTERVAL] = (g_perfBegin != 0 ? now - g_perfBegin : 0);
+	g_perfBegin    = now;
+	g_perfLastMark = now;
+}
+
+void perfFrameMark(const u8 stage)
+{
+	const u32 now = perfGetTicks();
+	g_perfCur.ticks[stage] = now - g_perfLastMark;
+	g_perfLastMark = now;
+}
+
+void perfFrameSet(const u8 stage, const u32 ticks)
+{
+	g_perfCur.ticks[stage] = ticks;
+}
+
+void perfFrameEnd(void)
+{
+	g_perfCur.ticks[PERF_FRAME_TOTAL] = perfGetTicks() - g_perfBegin;
+	g_perfRing[g_perfHead & (PERF_RING_SIZE - 1)] = g_perfCur;
+	g_perfHead++;
+}
+
+void perfOverlayUpdate(void)
+{
+	static u32 lastUpdate = 0;
+	if(g_perfHead - lastUpdate < OVERLAY_INTERVAL) return;
+	lastUpdate = g_perfHead;
+
+	static const char *const names[PERF_FRAME_STAGES] = {"Interval", "Convert", "Pacing", "P3D", "PPF", "Total"};
+	const u32 num = (g_perfHead < PERF_RING_SIZE ? g_perfHead : PERF_RING_SIZE);
+	ee_printf("\x1b[1;1H\x1b[37mFrame timing (last %" PRIu32 " frames, us)\n  Stage      min    avg    max\n", num);
+	for(u32 s = 0; s < PERF_FRAME_STAGES; s++)
+	{
+		u32 min = 0xFFFFFFFFu, max = 0;
+		u64 sum = 0;
+		for(u32 i = 0; i < num; i++)
+		{
+			const u32 t = g_perfRing[i].ticks[s];
+			min = (t < min ? t : min);
+			max = (t > max ? t : max);
+			sum += t;
+		}
+		ee_printf("  %-8s %6" PRIu32 " %6" PRIu32 " %6" PRIu32 "\n", names[s],
+		          PERF_TICKS2US(min), PERF_TICKS2US(sum / num), PERF_TICKS2US(max));
+	}
+}
+
+Result perfDumpCsv(const char *const path)
+{
+	FHandle f;
+	Result res = fOpen(&f, path, FA_CREATE_ALWAYS | FA_WRITE);
+	if(res != RES_OK) return res;
+
+	char *const buf = (char*)malloc(CSV_LINE_MAX * 64);
+	if(buf != NULL)
+	{
+		static const char header[] = "frame,interval_us,convert_us,pacing_us,p3d_us,ppf_us,total_us\n";
+		u32 written;
+		res = fWrite(f, header, sizeof(header) - 1, &written);
+
+		// Oldest record first.
+		const u32 num = (g_perfHead < PERF_RING_SIZE ? g_perfHead : PERF_RING_SIZE);
+		const u32 first = g_perfHead - num;
+		u32 i = 0;
+		while(res == RES_OK && i < num)
+		{
+			u32 len = 0;
+			for(u32 line = 0; line < 64 && i < num; line++, i++)
+			{
+				const PerfFrame *const rec = &g_perfRing[(first + i) & (PERF_RING_SIZE - 1)];
+				len += ee_snprintf(&buf[len], CSV_LINE_MAX, "%" PRIu32, first + i);
+				for(u32 s = 0; s < PERF_FRAME_STAGES; s++)
+					len += ee_snprintf(&buf[len], CSV_LINE_MAX - 8, ",%" PRIu32, PERF_TICKS2US(rec->ticks[s]));
+				buf[len++] = '\n';
+			}
+			res = fWrite(f, buf, len, &written);
+		}
+
+		free(buf);
+	}
+	else res = RES_OUT_OF_MEM;
+
+	fClose(f);
+
+	return res;
+}
+#endif // #ifndef NDEBUG
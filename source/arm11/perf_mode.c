@@ -0,0 +1,137 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "types.h"
+#include "arm11/perf_mode.h"
+#include "mem_map.h"
+#include "arm.h"
+#include "arm11/drivers/interrupt.h"
+#include "arm11/core1.h"
+#include "arm11/perf.h"
+#include "arm11/fmt.h"
+
+
+#define REG_CFG11_SOCINFO    *((const vu16*)(IO_COMMON_BASE + 0x40FFC))
+#define REG_PDN_LGR_SOCMODE  *((vu16*)(IO_COMMON_BASE + 0x41300))
+#define REG_GICD_ISPENDR(n)  *((vu32*)(MPCORE_PRIV_BASE + 0x1200 + (n) * 4))
+#define REG_GICD_ICPENDR(n)  *((vu32*)(MPCORE_PRIV_BASE + 0x1280 + (n) * 4))
+
+#define SOCINFO_LGR          (1u<<1) // New 3DS.
+#define SOCMODE_MASK         (7u)
+#define SOCMODE_CTR_268MHZ   (0u)
+#define SOCMODE_LGR2_804MHZ  (5u)
+#define SOCMODE_ACK          (1u<<15)
+#define IRQ_PDN_LGR_SOCMODE  (88u)
+
+
+static u16 g_prevSocMode = SOCMODE_CTR_268MHZ;
+static u32 g_clockMul = 1;
+static bool g_entered = false;
+static vu32 g_core1Parked = 0;
+
+
+
+static u32 socMode2ClockMul(const u16 mode)
+{
+	// 804 MHz is exactly 3 times the Old 3DS clock.
+	return (mode == SOCMODE_LGR2_804MHZ ? 3 : 1);
+}
+
+static void unparkIsr(UNUSED const u32 intSource)
+{
+	g_core1Parked = 0;
+}
+
+// Parks core 1 in WFI during the clock switch. The hardware only
+// finishes the switch once all other cores are waiting for an IRQ.
+static void parkJob(UNUSED void *arg)
+{
+	IRQ_registerIsr(IRQ_IPI14, 14, 0, unparkIsr);
+	__disableIrq();
+
+	__dmb();
+	g_core1Parked = 1;
+	__dsb();
+	__sev();
+
+	// Masked IRQs still end WFI. Unmask briefly so the kernel handles
+	// them as usual. Only IPI14 (unparkIsr()) releases the core.
+	while(g_core1Parked != 0)
+	{
+		__wfi();
+		__enableIrq();
+		__disableIrq();
+	}
+
+	perfSetClockMul(g_clockMul);
+	IRQ_unregisterIsr(IRQ_IPI14);
+	__enableIrq();
+}
+
+static void switchSocMode(const u16 mode)
+{
+	if((REG_PDN_LGR_SOCMODE & SOCMODE_MASK) == mode) return;
+
+	core1Submit(parkJob, NULL);
+	while(g_core1Parked == 0) __wfe();
+	__dmb();
+
+	IRQ_registerIsr(IRQ_PDN_LGR_SOCMODE, 14, 0, NULL);
+	const u32 oldState = enterCriticalSection();
+
+	// Only the pending bit is polled. Acking in the CPU interface
+	// would drop unrelated IRQs the kernel still has to handle.
+	// WFI may return early for those which is fine.
+	const u32 pendIdx = IRQ_PDN_LGR_SOCMODE / 32;
+	const u32 pendBit = 1u<<(IRQ_PDN_LGR_SOCMODE % 32);
+	REG_PDN_LGR_SOCMODE = mode;
+	do
+	{
+		__wfi();
+	} while((REG_GICD_ISPENDR(pendIdx) & pendBit) == 0);
+	REG_PDN_LGR_SOCMODE = REG_PDN_LGR_SOCMODE | SOCMODE_ACK;
+	REG_GICD_ICPENDR(pendIdx) = pendBit;
+
+	g_clockMul = socMode2ClockMul(mode);
+	perfSetClockMul(g_clockMul);
+	leaveCriticalSection(oldState);
+	IRQ_unregisterIsr(IRQ_PDN_LGR_SOCMODE);
+
+	// Release core 1. It picks up g_clockMul for its own ticks.
+	IRQ_softwareInterrupt(IRQ_IPI14, 1u<<1);
+	core1Wait();
+}
+
+void perfModeEnter(void)
+{
+	if(g_entered || (REG_CFG11_SOCINFO & SOCINFO_LGR) == 0) return;
+
+	g_entered = true;
+	g_prevSocMode = REG_PDN_LGR_SOCMODE & SOCMODE_MASK;
+	g_clockMul = socMode2ClockMul(g_prevSocMode);
+	switchSocMode(SOCMODE_LGR2_804MHZ);
+	debug_printf("Perf mode: %" PRIu32 "x clock.\n", g_clockMul);
+}
+
+void perfModeExit(void)
+{
+	if(!g_entered) return;
+
+	g_entered = false;
+	switchSocMode(g_prevSocMode);
+}
@@ -0,0 +1,190 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "arm11/rom_cache.h"
+#include "fs.h"
+#include "fsutil.h"
+#include "oaf_error_codes.h"
+#include "arm11/fmt.h"
+
+
+#define ROM_CACHE_MAGIC    (0x4346414Fu) // "OAFC"
+#define ROM_CACHE_VERSION  (2u)
+
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 count;
+	u32 dbKey[3];    // gba_db.bin size, timestamp and header hash when the db lookups were cached.
+	u32 reserved;
+	RomCacheEntry entries[ROM_CACHE_ENTRIES]; // Most recently used first.
+} RomCacheFile;
+
+
+
+static u32 hashPath(const char *path)
+{
+	// 32 bit FNV-1a.
+	u32 hash = 2166136261u;
+	while(*path != '\0')
+	{
+		hash ^= (u8)*path++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+// A replaced gba_db.bin may have the same size so the timestamp and
+// the header (version and entry count) are compared too.
+static void getDbKey(u32 dbKey[3])
+{
+	memset(dbKey, 0, sizeof(u32) * 3);
+
+	FILINFO fi;
+	if(fStat("gba_db.bin", &fi) != RES_OK) return;
+	dbKey[0] = (u32)fi.fsize;
+	dbKey[1] = (u32)fi.fdate<<16 | fi.ftime;
+
+	u8 head[16] = {0};
+	if(fsQuickRead("gba_db.bin", head, sizeof(head)) != RES_OK) return;
+	u32 hash = 2166136261u;
+	for(u32 i = 0; i < sizeof(head); i++)
+	{
+		hash ^= head[i];
+		hash *= 16777619u;
+	}
+	dbKey[2] = hash;
+}
+
+// Returns NULL if out of memory. The file is reset if missing or invalid.
+static RomCacheFile* loadCache(void)
+{
+	RomCacheFile *const cache = (RomCacheFile*)calloc(1, sizeof(RomCacheFile));
+	if(cache == NULL) return NULL;
+
+	const Result res = fsQuickRead(ROM_CACHE_PATH, cache, sizeof(RomCacheFile));
+	if(res != RES_OK || cache->magic != ROM_CACHE_MAGIC ||
+	   cache->version != ROM_CACHE_VERSION || cache->count > ROM_CACHE_ENTRIES)
+	{
+		memset(cache, 0, sizeof(RomCacheFile));
+		cache->magic   = ROM_CACHE_MAGIC;
+		cache->version = ROM_CACHE_VERSION;
+	}
+
+	// A different gba_db.bin invalidates all cached lookups.
+	u32 dbKey[3];
+	getDbKey(dbKey);
+	if(memcmp(cache->dbKey, dbKey, sizeof(dbKey)) != 0)
+	{
+		for(u32 i = 0; i < cache->count; i++)
+			cache->entries[i].flags &= ~(ROM_INFO_DB | ROM_INFO_DB_FOUND);
+		memcpy(cache->dbKey, dbKey, sizeof(dbKey));
+	}
+
+	return cache;
+}
+
+static s32 findEntry(const RomCacheFile *const cache, const RomCacheEntry *const key)
+{
+	for(u32 i = 0; i < cache->count; i++)
+	{
+		const RomCacheEntry *const e = &cache->entries[i];
+		if(e->pathHash == key->pathHash && e->fileSize == key->fileSize &&
+		   e->fdate == key->fdate && e->ftime == key->ftime)
+			return i;
+	}
+
+	return -1;
+}
+
+static bool makeKey(const char *const romPath, RomCacheEntry *const key)
+{
+	FILINFO fi;
+	if(fStat(romPath, &fi) != RES_OK) return false;
+
+	memset(key, 0, sizeof(RomCacheEntry));
+	key->pathHash = hashPath(romPath);
+	key->fileSize = (u32)fi.fsize;
+	key->fdate    = fi.fdate;
+	key->ftime    = fi.ftime;
+
+	return true;
+}
+
+bool romCacheLookup(const char *const romPath, RomInfo *const info)
+{
+	memset(info, 0, sizeof(RomInfo));
+	info->sdkSaveType = 0xFF;
+
+	RomCacheEntry key;
+	if(!makeKey(romPath, &key)) return false;
+
+	RomCacheFile *const cache = loadCache();
+	if(cache == NULL) return false;
+
+	const s32 idx = findEntry(cache, &key);
+	if(idx >= 0)
+	{
+		const RomCacheEntry *const e = &cache->entries[idx];
+		memcpy(info->sha1, e->sha1, sizeof(info->sha1));
+		info->sdkSaveType = e->sdkSaveType;
+		info->flags       = e->flags;
+		info->dbAttr      = e->dbAttr;
+		debug_printf("ROM cache hit (flags 0x%X).\n", e->flags);
+	}
+	free(cache);
+
+	return idx >= 0;
+}
+
+void romCacheUpdate(const char *const romPath, const RomInfo *const info)
+{
+	RomCacheEntry key;
+	if(info->flags == 0 || !makeKey(romPath, &key)) return;
+
+	RomCacheFile *const cache = loadCache();
+	if(cache == NULL) return;
+
+	memcpy(key.sha1, info->sha1, sizeof(key.sha1));
+	key.dbAttr      = info->dbAttr;
+	key.sdkSaveType = info->sdkSaveType;
+	key.flags       = info->flags;
+
+	do
+	{
+		// Nothing to do if the entry is unchanged and already the most recent one.
+		s32 idx = findEntry(cache, &key);
+		if(idx == 0 && memcmp(&cache->entries[0], &key, sizeof(RomCacheEntry)) == 0) break;
+
+		// Move everything before the old entry (or drop the least recently used one).
+		if(idx < 0) idx = (cache->count < ROM_CACHE_ENTRIES ? cache->count++ : ROM_CACHE_ENTRIES - 1);
+		memmove(&cache->entries[1], &cache->entries[0], sizeof(RomCacheEntry) * idx);
+		cache->entries[0] = key;
+
+		const Result res = fsQuickWrite(ROM_CACHE_PATH, cache, sizeof(RomCacheFile));
+		if(res != RES_OK) debug_printf("Failed to write ROM cache: %s\n", oafResult2String(res));
+	} while(0);
+
+	free(cache);
+}
@@ -0,0 +1,338 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "arm11/rom_loader.h"
+#include "util.h"
+#include "arm11/fast_rom_padding.h"
+#include "fs.h"
+#include "arm11/fmt.h"
+#include "drivers/lgy_common.h"
+#include "drivers/sha.h"
+#include "arm11/save_type.h"
+#include "kernel.h"
+#include "kevent.h"
+#include "arm11/perf.h"
+#include "arm11/core1.h"
+#include "drivers/cache.h"
+#include "arm11/drivers/gx.h"
+#include "drivers/gfx.h"
+#include "arm11/boot_trace.h"
+
+
+// Must be a multiple of the SHA block size (64 bytes).
+#define ROM_CHUNK_SIZE      (1024u * 512)
+// Longest SDK save string is 13 bytes ("FLASH512_V130").
+// The scanner must not look past data that has been loaded.
+// Prefetches are clamped to the scan range so this only covers the match overread.
+#define SCAN_HOLDBACK       (16u)
+// The GPU fills/copies whole cache lines so the CPU never shares a line with it.
+#define GPU_PAD_ALIGN       (32u)
+
+
+typedef struct
+{
+	const u32 *start;
+	const u32 *end;
+	u32 romSize;
+	u16 result;      // 0xFF if no SDK save string found.
+	u32 ticks;
+} ScanJob;
+
+typedef struct
+{
+	u32 *start;
+	u32 size;
+} PaddingJob;
+
+typedef struct
+{
+	vu32 loaded;       // Number of bytes at LGY_ROM_LOC ready for processing.
+	vu8 done;          // No more data after loaded.
+	u8 flags;
+	u16 sdkSaveType;
+	u32 romSize;
+	KHandle chunkEvent;
+	KHandle finishedEvent;
+	u32 sha1[5];
+} RomLoadState;
+
+// Accessed by core 1.
+static ScanJob g_scanJob;
+static PaddingJob g_paddingJob;
+static bool g_paddingPending = false;
+static bool g_mirrorPending = false;
+
+
+
+// Returns the padded size. The fake "open bus" padding is started separately.
+// The 0xFF padding is filled by PSC and the mirrors are copied by PPF. Only the
+// fill is waited for (hashing needs it). The mirrors are fenced by waitForRomPadding().
+static u32 fixRomPadding(const u32 romFileSize, u32 *const mirroredSizeOut)
+{
+	// Pad unused ROM area with 0xFFs (trimmed ROMs).
+	// Smallest retail ROM chip is 8 Mbit (1 MiB).
+	u32 romSize = nextPow2(romFileSize);
+	romSize = (romSize < 0x100000 ? 0x100000 : romSize);
+	const uintptr_t romLoc = LGY_ROM_LOC;
+	const u32 mirroredSize = (romSize == 0x100000 ? 0x400000 : romSize);
+
+	// The GPU accesses memory directly. Loaded data must be written back first
+	// and nothing of the GPU writes may be shadowed by stale cache lines.
+	u32 fillStart = (romFileSize + GPU_PAD_ALIGN - 1) & ~(GPU_PAD_ALIGN - 1);
+	fillStart = (fillStart > romSize ? romSize : fillStart);
+	memset((void*)(romLoc + romFileSize), 0xFF, fillStart - romFileSize);
+	cleanDCacheRange((void*)romLoc, fillStart);
+	invalidateDCacheRange((void*)(romLoc + fillStart), mirroredSize - fillStart);
+
+	if(fillStart < romSize)
+	{
+		// The loader task waits for the fill IRQ so the worker can hash in the meantime.
+		GX_memoryFill((u32*)(romLoc + fillStart), PSC_FILL_32_BITS, romSize - fillStart, 0xFFFFFFFF, NULL, 0, 0, 0);
+		GFX_waitForPSC0();
+	}
+
+	if(romSize == 0x100000) // 1 MiB.
+	{
+		// ROM mirroring for Classic NES Series/others with 8 Mbit ROM.
+		// The ROM is mirrored exactly 4 times.
+		// Thanks to endrift for discovering this.
+		// 1 MiB to 1-2 MiB and then 0-2 MiB to 2-4 MiB. 64 KiB lines without gap.
+		GX_textureCopy((u32*)romLoc, PPF_DIM(0x1000, 0), (u32*)(romLoc + romSize), PPF_DIM(0x1000, 0), romSize);
+		GFX_waitForPPF();
+		GX_textureCopy((u32*)romLoc, PPF_DIM(0x1000, 0), (u32*)(romLoc + romSize * 2), PPF_DIM(0x1000, 0), romSize * 2);
+		g_mirrorPending = true;
+	}
+	*mirroredSizeOut = mirroredSize;
+
+	// We don't return the mirrored size because the db hashes are over unmirrored dumps.
+	return romSize;
+}
+
+static void scanJob(void *arg)
+{
+	ScanJob *const job = (ScanJob*)arg;
+
+	// Cache maintenance by address is not broadcast to the other core.
+	// Drop lines core 1 may still hold from before the DMA wrote this range.
+	// Matches read up to 12 bytes past the end.
+	invalidateDCacheRange((void*)job->start, (uintptr_t)job->end - (uintptr_t)job->start + 12);
+
+	const u32 start = perfGetTicks();
+	job->result = scanSdkSaveType(job->start, job->end, job->romSize);
+	job->ticks += perfGetTicks() - start;
+}
+
+static void paddingJob(void *arg)
+{
+	PaddingJob *const job = (PaddingJob*)arg;
+
+	// Fake "open bus" padding. Runs on core 1 so it must be written back
+	// before anything outside the coherency domain (GBA hardware) sees it.
+	makeOpenBusPaddingFast(job->start);
+	cleanDCacheRange(job->start, job->size);
+}
+
+// Processes everything the loader has published so far.
+// Runs while the main task is blocked on the next fRead().
+static void romProcessTask(void *args)
+{
+	RomLoadState *const state = (RomLoadState*)args;
+	const u8 flags = state->flags;
+	const u32 romSize = state->romSize;
+
+	if(flags & ROM_LOAD_HASH) SHA_start(SHA_IN_BIG | SHA_1_MODE);
+
+	u32 hashed = 0;
+	u32 scanned = 0xE4; // Skip headers.
+	u16 sdkSaveType = 0xFF;
+	u32 loaded;
+	bool done;
+	ScanJob *const job = &g_scanJob;
+	job->result = 0xFF;
+	job->ticks  = 0;
+	do
+	{
+		waitForEvent(state->chunkEvent);
+		clearEvent(state->chunkEvent);
+
+		// Read done before loaded. loaded is final once done is set.
+		done = state->done;
+		loaded = state->loaded;
+
+		// The scan runs on core 1 in parallel to hashing on this core.
+		// Jobs are submitted in ROM order so the first match wins like before.
+		// If core 1 is still busy the range just grows for the next job.
+		if((flags & ROM_LOAD_SCAN) && sdkSaveType == 0xFF && !core1Busy())
+		{
+			sdkSaveType = job->result;
+
+			u32 end = (done ? loaded : loaded - SCAN_HOLDBACK);
+			end = (loaded < SCAN_HOLDBACK ? 0 : end & ~3u);
+			if(sdkSaveType == 0xFF && end > scanned)
+			{
+				job->start   = (u32*)(LGY_ROM_LOC + scanned);
+				job->end     = (u32*)(LGY_ROM_LOC + end);
+				job->romSize = romSize;
+				core1Submit(scanJob, job);
+				scanned = end;
+			}
+		}
+
+		if(flags & ROM_LOAD_HASH)
+		{
+			// The last chunk is the padded ROM size which is always block aligned.
+			const u32 end = loaded & ~63u;
+			if(end > hashed)
+			{
+				SHA_update((u32*)(LGY_ROM_LOC + hashed), end - hashed);
+				hashed = end;
+			}
+		}
+	} while(!done);
+
+	if(flags & ROM_LOAD_HASH) SHA_finish(state->sha1, SHA_OUT_BIG);
+	if(flags & ROM_LOAD_SCAN)
+	{
+		// Collect the last job and scan what is left.
+		core1Wait();
+		if(sdkSaveType == 0xFF) sdkSaveType = job->result;
+		if(sdkSaveType == 0xFF && (loaded & ~3u) > scanned)
+		{
+			job->start = (u32*)(LGY_ROM_LOC + scanned);
+			job->end   = (u32*)(LGY_ROM_LOC + (loaded & ~3u));
+			scanJob(job);
+			sdkSaveType = job->result;
+		}
+		PERF_PRINT("SDK save scan", job->ticks);
+	}
+	state->sdkSaveType = sdkSaveType;
+
+	signalEvent(state->finishedEvent, false);
+	taskExit();
+}
+
+static void publishChunk(RomLoadState *const state, const u32 loaded, const bool done)
+{
+	state->loaded = loaded;
+	state->done = done;
+	signalEvent(state->chunkEvent, false);
+}
+
+Result loadGbaRom(const char *const path, const u8 loadFlags, RomInfo *const info)
+{
+	FHandle f;
+	Result res = fOpen(&f, path, FA_OPEN_EXISTING | FA_READ);
+	if(res != RES_OK) return res;
+
+	u32 fileSize = fSize(f);
+	if(fileSize > LGY_MAX_ROM_SIZE)
+	{
+		fileSize = LGY_MAX_ROM_SIZE;
+		ee_puts("Warning: ROM file is too big. Expect crashes.");
+	}
+
+	PERF_VAR(loadTicks);
+	PERF_START(loadTicks);
+
+	// Start the worker if there is something to do besides loading.
+	RomLoadState state;
+	const bool useWorker = loadFlags != 0;
+	if(useWorker)
+	{
+		state.loaded        = 0;
+		state.done          = false;
+		state.flags         = loadFlags;
+		state.sdkSaveType   = 0xFF;
+		state.romSize       = (fileSize < 0x100000 ? 0x100000 : nextPow2(fileSize));
+		state.chunkEvent    = createEvent(false);
+		state.finishedEvent = createEvent(false);
+		createTask(0x1000, 3, romProcessTask, &state);
+	}
+
+	// Read in big chunks directly to the final location.
+	// The worker hashes/scans the previous chunk while we wait for the next.
+	u32 pos = 0;
+	while(pos < fileSize)
+	{
+		const u32 chunkSize = (fileSize - pos < ROM_CHUNK_SIZE ? fileSize - pos : ROM_CHUNK_SIZE);
+		u32 read;
+		res = fRead(f, (void*)(LGY_ROM_LOC + pos), chunkSize, &read);
+		if(res != RES_OK) break;
+		if(read != chunkSize)
+		{
+			res = RES_FR_DISK_ERR;
+			break;
+		}
+
+		pos += read;
+		if(useWorker) publishChunk(&state, pos, false);
+	}
+	fClose(f);
+	bootTraceMark("ROM read", pos);
+
+	u32 romSize = 0, mirroredSize = 0;
+	if(res == RES_OK) romSize = fixRomPadding(fileSize, &mirroredSize);
+	bootTraceMark("ROM padding", romSize - (res == RES_OK ? fileSize : 0));
+
+	if(useWorker)
+	{
+		// Padding is hashed too. On error we only wait for the worker to finish.
+		publishChunk(&state, (res == RES_OK ? romSize : pos), true);
+		waitForEvent(state.finishedEvent);
+		deleteEvent(state.finishedEvent);
+		deleteEvent(state.chunkEvent);
+
+		if(loadFlags & ROM_LOAD_HASH) memcpy(info->sha1, state.sha1, sizeof(info->sha1));
+		if(loadFlags & ROM_LOAD_SCAN) info->sdkSaveType = state.sdkSaveType;
+		bootTraceMark("ROM hash/scan", (res == RES_OK ? romSize : pos));
+	}
+
+	// Fill the rest with open bus values on core 1 while we continue
+	// with save type detection. Fenced by waitForRomPadding().
+	if(res == RES_OK && mirroredSize < LGY_MAX_ROM_SIZE)
+	{
+		g_paddingJob.start = (u32*)(LGY_ROM_LOC + mirroredSize);
+		g_paddingJob.size  = LGY_MAX_ROM_SIZE - mirroredSize;
+		g_paddingPending   = true;
+		core1Submit(paddingJob, &g_paddingJob);
+	}
+
+	info->romSize = romSize;
+	if(res == RES_OK) info->flags |= loadFlags;
+
+	PERF_STOP(loadTicks);
+	PERF_PRINT("ROM load", loadTicks);
+
+	return res;
+}
+
+void waitForRomPadding(void)
+{
+	if(g_mirrorPending)
+	{
+		GFX_waitForPPF();
+		g_mirrorPending = false;
+	}
+
+	if(!g_paddingPending) return;
+
+	core1Wait();
+	g_paddingPending = false;
+}
@@ -16,6 +16,7 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include "types.h"
 #include "arm11/save_type.h"
@@ -29,6 +30,59 @@
 #include "arm11/drivers/hid.h"
 
 
+#define SAVE_PREFIX_EEPR  (0x52504545u) // "EEPR"
+#define SAVE_PREFIX_FLAS  (0x53414C46u) // "FLAS"
+#define SAVE_PREFIX_SRAM  (0x4D415253u) // "SRAM"
+
+// SDK save strings split into the prefix word and up to 3 masked suffix words.
+// The masks cover exactly the string length so no strlen()/memcmp() is needed.
+// Entries are grouped by prefix. See matchSaveSig() for the ranges.
+typedef struct
+{
+	u32 suffix[3];
+	u32 mask[3];
+	u16 saveType;
+	const char *str;
+} SdkSaveSig;
+
+static const SdkSaveSig g_sdkSaveSigs[25] =
+{
+	// EEPROM
+	// Assume common sizes for popular games to aid ROM hacks.
+	{{0x565F4D4Fu, 0x00313131u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_EEPROM_8k,          "EEPROM_V111"},
+	{{0x565F4D4Fu, 0x00303231u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_EEPROM_8k,          "EEPROM_V120"},
+	{{0x565F4D4Fu, 0x00313231u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_EEPROM_64k,         "EEPROM_V121"},
+	{{0x565F4D4Fu, 0x00323231u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_EEPROM_8k,          "EEPROM_V122"},
+	{{0x565F4D4Fu, 0x00343231u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_EEPROM_64k,         "EEPROM_V124"},
+	{{0x565F4D4Fu, 0x00353231u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_EEPROM_8k,          "EEPROM_V125"},
+	{{0x565F4D4Fu, 0x00363231u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_EEPROM_8k,          "EEPROM_V126"},
+
+	// FLASH
+	// Assume they all have RTC.
+	{{0x31565F48u, 0x00003032u, 0x00000000u}, {0xFFFFFFFFu, 0x0000FFFFu, 0x00000000u}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH_V120"},
+	{{0x31565F48u, 0x00003132u, 0x00000000u}, {0xFFFFFFFFu, 0x0000FFFFu, 0x00000000u}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH_V121"},
+	{{0x31565F48u, 0x00003332u, 0x00000000u}, {0xFFFFFFFFu, 0x0000FFFFu, 0x00000000u}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH_V123"},
+	{{0x31565F48u, 0x00003432u, 0x00000000u}, {0xFFFFFFFFu, 0x0000FFFFu, 0x00000000u}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH_V124"},
+	{{0x31565F48u, 0x00003532u, 0x00000000u}, {0xFFFFFFFFu, 0x0000FFFFu, 0x00000000u}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH_V125"},
+	{{0x31565F48u, 0x00003632u, 0x00000000u}, {0xFFFFFFFFu, 0x0000FFFFu, 0x00000000u}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH_V126"},
+	{{0x32313548u, 0x3331565Fu, 0x00000030u}, {0xFFFFFFFFu, 0xFFFFFFFFu, 0x000000FFu}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH512_V130"},
+	{{0x32313548u, 0x3331565Fu, 0x00000031u}, {0xFFFFFFFFu, 0xFFFFFFFFu, 0x000000FFu}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH512_V131"},
+	{{0x32313548u, 0x3331565Fu, 0x00000033u}, {0xFFFFFFFFu, 0xFFFFFFFFu, 0x000000FFu}, SAVE_TYPE_FLASH_512k_PSC_RTC, "FLASH512_V133"},
+	{{0x5F4D3148u, 0x32303156u, 0x00000000u}, {0xFFFFFFFFu, 0xFFFFFFFFu, 0x00000000u}, SAVE_TYPE_FLASH_1m_MRX_RTC,   "FLASH1M_V102"},
+	{{0x5F4D3148u, 0x33303156u, 0x00000000u}, {0xFFFFFFFFu, 0xFFFFFFFFu, 0x00000000u}, SAVE_TYPE_FLASH_1m_MRX_RTC,   "FLASH1M_V103"},
+
+	// FRAM & SRAM
+	{{0x565F465Fu, 0x00303031u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_SRAM_256k,          "SRAM_F_V100"},
+	{{0x565F465Fu, 0x00323031u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_SRAM_256k,          "SRAM_F_V102"},
+	{{0x565F465Fu, 0x00333031u, 0x00000000u}, {0xFFFFFFFFu, 0x00FFFFFFu, 0x00000000u}, SAVE_TYPE_SRAM_256k,          "SRAM_F_V103"},
+
+	{{0x3131565Fu, 0x00000030u, 0x00000000u}, {0xFFFFFFFFu, 0x000000FFu, 0x00000000u}, SAVE_TYPE_SRAM_256k,          "SRAM_V110"},
+	{{0x3131565Fu, 0x00000031u, 0x00000000u}, {0xFFFFFFFFu, 0x000000FFu, 0x00000000u}, SAVE_TYPE_SRAM_256k,          "SRAM_V111"},
+	{{0x3131565Fu, 0x00000032u, 0x00000000u}, {0xFFFFFFFFu, 0x000000FFu, 0x00000000u}, SAVE_TYPE_SRAM_256k,          "SRAM_V112"},
+	{{0x3131565Fu, 0x00000033u, 0x00000000u}, {0xFFFFFFFFu, 0x000000FFu, 0x00000000u}, SAVE_TYPE_SRAM_256k,          "SRAM_V113"}
+};
+
+
 
 static u16 checkSaveOverride(const u32 gameCode) // Save type overrides for modern homebrew.
 {
@@ -45,161 +99,208 @@ static u16 checkSaveOverride(const u32 gameCode) // Save type overrides for mode
 	return 0xFF;
 }
 
-u16 detectSaveType(const u32 romSize, const u16 defaultSave)
+static inline bool isSavePrefix(const u32 w)
 {
-	const u32 *romPtr = (u32*)LGY_ROM_LOC;
-	u16 saveType = checkSaveOverride(romPtr[0xAC / 4]);
-	if(saveType != 0xFF)
+	return w == SAVE_PREFIX_EEPR || w == SAVE_PREFIX_FLAS || w == SAVE_PREFIX_SRAM;
+}
+
+// Compares all strings of the prefix group at p. Returns 0xFF if none matches.
+static u16 matchSaveSig(const u32 *const p, const u32 romSize)
+{
+	u32 i, end;
+	switch(p[0])
 	{
-		debug_printf("Serial in override list.\n"
-		             "saveType: %u\n", saveType);
-		return saveType;
+		case SAVE_PREFIX_EEPR: i = 0;  end = 7;  break;
+		case SAVE_PREFIX_FLAS: i = 7;  end = 18; break;
+		case SAVE_PREFIX_SRAM: i = 18; end = 25; break;
+		default: return 0xFF;
 	}
 
-	// Code based on: https://github.com/Gericom/GBARunner2/blob/master/arm9/source/save/Save.vram.cpp
-	romPtr += 0xE4 / 4; // Skip headers.
-	if(defaultSave > SAVE_TYPE_NONE)
-		saveType = SAVE_TYPE_NONE;
-	else
-		saveType = defaultSave;
-
-	for(; romPtr < (u32*)(LGY_ROM_LOC + romSize); romPtr++)
+	const u32 w1 = p[1], w2 = p[2], w3 = p[3];
+	for(; i < end; i++)
 	{
-		u32 tmp = *romPtr;
-
-		// "EEPR" "FLAS" "SRAM"
-		if(tmp == 0x52504545u || tmp == 0x53414C46u || tmp == 0x4D415253u)
+		const SdkSaveSig *const sig = &g_sdkSaveSigs[i];
+		const u32 diff = ((w1 ^ sig->suffix[0]) & sig->mask[0]) |
+		                 ((w2 ^ sig->suffix[1]) & sig->mask[1]) |
+		                 ((w3 ^ sig->suffix[2]) & sig->mask[2]);
+		if(diff == 0)
 		{
-			static const struct
-			{
-				const char *str;
-				u16 saveType;
-			} saveTypeLut[25] =
+			u16 saveType = sig->saveType;
+			if(saveType == SAVE_TYPE_EEPROM_8k || saveType == SAVE_TYPE_EEPROM_64k)
 			{
-				// EEPROM
-				// Assume common sizes for popular games to aid ROM hacks.
-				{"EEPROM_V111", SAVE_TYPE_EEPROM_8k},
-				{"EEPROM_V120", SAVE_TYPE_EEPROM_8k},
-				{"EEPROM_V121", SAVE_TYPE_EEPROM_64k},
-				{"EEPROM_V122", SAVE_TYPE_EEPROM_8k},
-				{"EEPROM_V124", SAVE_TYPE_EEPROM_64k},
-				{"EEPROM_V125", SAVE_TYPE_EEPROM_8k},
-				{"EEPROM_V126", SAVE_TYPE_EEPROM_8k},
-
-				// FLASH
-				// Assume they all have RTC.
-				{"FLASH_V120",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V121",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V123",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V124",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V125",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH_V126",    SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH512_V130", SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH512_V131", SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH512_V133", SAVE_TYPE_FLASH_512k_PSC_RTC},
-				{"FLASH1M_V102",  SAVE_TYPE_FLASH_1m_MRX_RTC},
-				{"FLASH1M_V103",  SAVE_TYPE_FLASH_1m_MRX_RTC},
-
-				// FRAM & SRAM
-				{"SRAM_F_V100", SAVE_TYPE_SRAM_256k},
-				{"SRAM_F_V102", SAVE_TYPE_SRAM_256k},
-				{"SRAM_F_V103", SAVE_TYPE_SRAM_256k},
-
-				{"SRAM_V110",   SAVE_TYPE_SRAM_256k},
-				{"SRAM_V111",   SAVE_TYPE_SRAM_256k},
-				{"SRAM_V112",   SAVE_TYPE_SRAM_256k},
-				{"SRAM_V113",   SAVE_TYPE_SRAM_256k}
-			};
-
-			for(u32 i = 0; i < 25; i++)
-			{
-				const char *const str = saveTypeLut[i].str;
-				u16 tmpSaveType = saveTypeLut[i].saveType;
+				// If ROM bigger than 16 MiB --> SAVE_TYPE_EEPROM_8k_2 or SAVE_TYPE_EEPROM_64k_2.
+				if(romSize > 0x1000000) saveType++;
+			}
+			debug_printf("SDK save string: %s\n", sig->str);
+			return saveType;
+		}
+	}
 
-				if(memcmp(romPtr, str, strlen(str)) == 0)
-				{
-					if(tmpSaveType == SAVE_TYPE_EEPROM_8k || tmpSaveType == SAVE_TYPE_EEPROM_64k)
-					{
-						// If ROM bigger than 16 MiB --> SAVE_TYPE_EEPROM_8k_2 or SAVE_TYPE_EEPROM_64k_2.
-						if(romSize > 0x1000000) tmpSaveType++;
-					}
-					debug_printf("SDK save string: %s\n"
-					             "saveType: %u\n", str, tmpSaveType);
-					return tmpSaveType;
-				}
+	return 0xFF;
+}
+
+// Code based on: https://github.com/Gericom/GBARunner2/blob/master/arm9/source/save/Save.vram.cpp
+// Scans 4 words per iteration. The compiler turns this into ldm bursts.
+// Matches may read up to 12 bytes past romEnd.
+u16 scanSdkSaveType(const u32 *romPtr, const u32 *const romEnd, const u32 romSize)
+{
+	while(romPtr + 4 <= romEnd)
+	{
+		// 128 bytes (4 cache lines) ahead. Never past romEnd because the
+		// data after it may still be written by DMA.
+		if(romPtr + 32 < romEnd) __builtin_prefetch(romPtr + 32);
+		const u32 w0 = romPtr[0], w1 = romPtr[1], w2 = romPtr[2], w3 = romPtr[3];
+		if(isSavePrefix(w0) | isSavePrefix(w1) | isSavePrefix(w2) | isSavePrefix(w3))
+		{
+			for(u32 i = 0; i < 4; i++)
+			{
+				const u16 saveType = matchSaveSig(romPtr + i, romSize);
+				if(saveType != 0xFF) return saveType;
 			}
 		}
+		romPtr += 4;
 	}
 
+	for(; romPtr < romEnd; romPtr++)
+	{
+		const u16 saveType = matchSaveSig(romPtr, romSize);
+		if(saveType != 0xFF) return saveType;
+	}
+
+	return 0xFF;
+}
+
+u16 detectSaveType(const u16 sdkSaveType, const u16 defaultSave)
+{
+	u16 saveType = checkSaveOverride(((u32*)LGY_ROM_LOC)[0xAC / 4]);
+	if(saveType != 0xFF)
+	{
+		debug_printf("Serial in override list.\n"
+		             "saveType: %u\n", saveType);
+		return saveType;
+	}
+
+	// The SDK string scan is done by the ROM loader.
+	if(sdkSaveType != 0xFF)
+		saveType = sdkSaveType;
+	else if(defaultSave > SAVE_TYPE_NONE)
+		saveType = SAVE_TYPE_NONE;
+	else
+		saveType = defaultSave;
+
 	debug_printf("saveType: %u\n", saveType);
 	return saveType;
 }
 
-// Search for the entry with first u64 of the SHA1 = x using binary search.
-// Note: Loading the whole db to memory first is still slower.
+// Search for the entry with first u64 of the SHA1 = x.
+// The header holds a fanout table so only the small bucket for x needs to be read.
 static Result searchGbaDb(const u64 x, GbaDbEntry *const db)
 {
 	FHandle f;
 	Result res = fOpen(&f, "gba_db.bin", FA_OPEN_EXISTING | FA_READ);
 	if(res != RES_OK) return res;
 
-	u32 l = 0;
-	u32 r = fSize(f) / sizeof(GbaDbEntry);
-	while(l < r)
+	GbaDbHeader *const hdr = (GbaDbHeader*)malloc(sizeof(GbaDbHeader));
+	if(hdr == NULL)
 	{
-		const u32 m = l + (r - l) / 2;
-		//debug_printf("l: %" PRIu32 " m: %" PRIu32 " r: %" PRIu32 "\n", l, m, r);
+		fClose(f);
+		return RES_OUT_OF_MEM;
+	}
 
-		res = fLseek(f, sizeof(GbaDbEntry) * m);
-		if(res != RES_OK)
-		{
-			fClose(f);
-			return res;
-		}
-		res = fRead(f, db, sizeof(GbaDbEntry), NULL);
-		if(res != RES_OK)
+	do
+	{
+		u32 read;
+		res = fRead(f, hdr, sizeof(GbaDbHeader), &read);
+		if(res != RES_OK) break;
+		if(read != sizeof(GbaDbHeader) || hdr->magic != GBA_DB_MAGIC ||
+		   hdr->version != GBA_DB_VERSION || hdr->entrySize != sizeof(GbaDbEntry))
 		{
-			fClose(f);
-			return res;
+			res = RES_INVALID_GBA_DB;
+			break;
 		}
 
-		u64 tmp;
-		memcpy(&tmp, db->sha1, 8);
-		if(x > tmp)
-		{
-			l = m + 1;
-		}
-		else if(x < tmp)
+		const u8 bucket = x>>56;
+		u32 l = hdr->fanout[bucket];
+		const u32 r = hdr->fanout[bucket + 1];
+		if(l > r || r > hdr->numEntries || fSize(f) < sizeof(GbaDbHeader) + sizeof(GbaDbEntry) * r)
 		{
-			r = m;
+			res = RES_INVALID_GBA_DB;
+			break;
 		}
-		else
+
+		res = fLseek(f, sizeof(GbaDbHeader) + sizeof(GbaDbEntry) * l);
+		if(res != RES_OK) break;
+
+		// Buckets are tiny (~11 entries on average). Read it in one go most of the time.
+		res = RES_NOT_FOUND;
+		GbaDbEntry entries[32];
+		while(l < r)
 		{
-			fClose(f);
-			return RES_OK;
+			const u32 num = (r - l < 32 ? r - l : 32);
+			const Result readRes = fRead(f, entries, sizeof(GbaDbEntry) * num, NULL);
+			if(readRes != RES_OK)
+			{
+				res = readRes;
+				break;
+			}
+
+			for(u32 i = 0; i < num; i++)
+			{
+				u64 tmp;
+				memcpy(&tmp, entries[i].sha1, 8);
+				if(tmp == x)
+				{
+					*db = entries[i];
+					res = RES_OK;
+					break;
+				}
+			}
+			if(res == RES_OK) break;
+
+			l += num;
 		}
-	}
+	} while(0);
 
+	free(hdr);
 	fClose(f);
 
-	return RES_NOT_FOUND;
+	return res;
 }
 
-u16 getSaveType(const OafConfig *const cfg, const u32 romSize, const char *const savePath)
+u16 getSaveType(const OafConfig *const cfg, RomInfo *const romInfo, const char *const savePath)
 {
 	FILINFO fi;
 	const bool saveOverride = cfg->saveOverride;
-	const u16 autoSaveType = detectSaveType(romSize, cfg->defaultSave);
+	const u32 romSize = romInfo->romSize;
+	const u16 autoSaveType = detectSaveType(romInfo->sdkSaveType, cfg->defaultSave);
 	const bool saveExists = fStat(savePath, &fi) == RES_OK;
 
-	u64 sha1[3];
-	sha((u32*)LGY_ROM_LOC, romSize, (u32*)sha1, SHA_IN_BIG | SHA_1_MODE, SHA_OUT_BIG);
+	// The hash has been calculated while loading the ROM or comes from the ROM cache.
+	if(!(romInfo->flags & ROM_LOAD_HASH))
+	{
+		sha((u32*)LGY_ROM_LOC, romSize, romInfo->sha1, SHA_IN_BIG | SHA_1_MODE, SHA_OUT_BIG);
+		romInfo->flags |= ROM_LOAD_HASH;
+	}
 
 	Result res;
-	GbaDbEntry dbEntry;
 	u16 saveType = SAVE_TYPE_NONE;
-	res = searchGbaDb(*sha1, &dbEntry);
-	if(res == RES_OK) saveType = dbEntry.attr & 0xFu;
+	if(romInfo->flags & ROM_INFO_DB)
+		res = (romInfo->flags & ROM_INFO_DB_FOUND ? RES_OK : RES_NOT_FOUND);
+	else
+	{
+		u64 sha1;
+		memcpy(&sha1, romInfo->sha1, 8);
+		GbaDbEntry dbEntry;
+		res = searchGbaDb(sha1, &dbEntry);
+		if(res == RES_OK)
+		{
+			romInfo->dbAttr = dbEntry.attr;
+			romInfo->flags |= ROM_INFO_DB | ROM_INFO_DB_FOUND;
+		}
+		else if(res == RES_NOT_FOUND) romInfo->flags |= ROM_INFO_DB;
+	}
+
+	if(res == RES_OK) saveType = romInfo->dbAttr & 0xFu;
 	else if(!saveOverride && res == RES_NOT_FOUND) return autoSaveType;
 	else if(res != RES_NOT_FOUND)
 	{
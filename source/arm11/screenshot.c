@@ -0,0 +1,159 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include "types.h"
+#include "arm11/screenshot.h"
+#include "arm11/bitmap.h"
+#include "arm11/config.h"
+#include "arm11/drivers/mcu.h"
+#include "arm11/fmt.h"
+#include "drivers/cache.h"
+#include "drivers/lgy_common.h"
+#include "fsutil.h"
+#include "kernel.h"
+#include "kevent.h"
+
+
+// Free FCRAM after the ROM. Only used by BPS patching before GBA mode starts.
+#define STAGING_LOC       (LGY_ROM_LOC + LGY_MAX_ROM_SIZE)
+#define PIXEL_OFFSET      (0x80u) // Make PPF happy.
+#define FILE_SIZE         (PIXEL_OFFSET + SCREENSHOT_W * SCREENSHOT_H * 2)
+#define SLOT_SIZE         ((FILE_SIZE + 0xFFFu) & ~0xFFFu)
+
+
+// Single producer (gfx task) and single consumer (writer task).
+static vu32 g_queued = 0;  // Buffers handed to the writer.
+static vu32 g_written = 0; // Buffers written (or failed).
+static KHandle g_shotEvent = 0;
+static KHandle g_idleEvent = 0;
+
+
+
+static u8* getSlot(const u32 n)
+{
+	return (u8*)(STAGING_LOC + (n % SCREENSHOT_SLOTS) * SLOT_SIZE);
+}
+
+static void screenshotWriter(UNUSED void *args)
+{
+	RtcTimeDate last = {0};
+	u32 seq = 0;
+	while(1)
+	{
+		if(waitForEvent(g_shotEvent) != KRES_OK) break;
+		clearEvent(g_shotEvent);
+
+		while(g_written != g_queued)
+		{
+			// Get current date & time. Shots within the same second get a sequence number.
+			RtcTimeDate td;
+			MCU_getRtcTimeDate(&td);
+			seq = (memcmp(&td, &last, sizeof(td)) == 0 ? seq + 1 : 0);
+			last = td;
+
+			// Construct file path from date & time. Then write the file.
+			char fn[40];
+			const u32 len = ee_sprintf(fn, OAF_SCREENSHOT_DIR "/%04X_%02X_%02X_%02X_%02X_%02X",
+			                           td.year + 0x2000, td.mon, td.day, td.hour, td.min, td.sec);
+			if(seq > 0) ee_sprintf(&fn[len], "_%02" PRIu32 ".bmp", seq);
+			else        strcpy(&fn[len], ".bmp");
+
+			const Result res = fsQuickWrite(fn, getSlot(g_written), FILE_SIZE);
+			if(res != RES_OK) debug_printf("Failed to write screenshot: %s\n", result2String(res));
+			g_written++;
+		}
+		signalEvent(g_idleEvent, false);
+	}
+
+	taskExit();
+}
+
+void screenshotInit(void)
+{
+	// A1BGR5 format (alpha ignored).
+	alignas(4) static const BmpV1WithMasks bmpHeaders =
+	{
+		{
+			.magic       = 0x4D42,
+			.fileSize    = FILE_SIZE,
+			.reserved    = 0,
+			.reserved2   = 0,
+			.pixelOffset = PIXEL_OFFSET
+		},
+		{
+			.headerSize      = sizeof(Bitmapinfoheader),
+			.width           = SCREENSHOT_W,
+			.height          = -(s32)SCREENSHOT_H,
+			.colorPlanes     = 1,
+			.bitsPerPixel    = 16,
+			.compression     = BI_BITFIELDS,
+			.imageSize       = SCREENSHOT_W * SCREENSHOT_H * 2,
+			.xPixelsPerMeter = 0,
+			.yPixelsPerMeter = 0,
+			.colorsUsed      = 0,
+			.colorsImportant = 0
+		},
+		.rMask = 0xF800,
+		.gMask = 0x07C0,
+		.bMask = 0x003E
+	};
+
+	// The headers never change. Only the pixels are written by PPF later.
+	for(u32 i = 0; i < SCREENSHOT_SLOTS; i++)
+		memcpy(getSlot(i), &bmpHeaders, sizeof(bmpHeaders));
+	flushDCacheRange((void*)STAGING_LOC, SLOT_SIZE * SCREENSHOT_SLOTS);
+
+	g_queued  = 0;
+	g_written = 0;
+	g_shotEvent = createEvent(false);
+	g_idleEvent = createEvent(false);
+
+	// Lower priority than the gfx task.
+	createTask(0x800, 2, screenshotWriter, NULL);
+}
+
+u32* screenshotAcquire(void)
+{
+	if(g_shotEvent == 0 || g_queued - g_written >= SCREENSHOT_SLOTS) return NULL;
+
+	return (u32*)(getSlot(g_queued) + PIXEL_OFFSET);
+}
+
+void screenshotQueue(void)
+{
+	g_queued++;
+	signalEvent(g_shotEvent, false);
+}
+
+void screenshotExit(void)
+{
+	if(g_shotEvent == 0) return;
+
+	while(g_written != g_queued)
+	{
+		waitForEvent(g_idleEvent);
+		clearEvent(g_idleEvent);
+	}
+
+	// screenshotWriter() will automatically terminate.
+	deleteEvent(g_shotEvent);
+	deleteEvent(g_idleEvent);
+	g_shotEvent = 0;
+	g_idleEvent = 0;
+}
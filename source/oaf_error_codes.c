@@ -30,7 +30,10 @@ const char* oafResult2String(Result res)
 	static const char *const oafResultStrings[] =
 	{
 		"ROM too big. Max 32 MiB",
-		"Invalid patch file"
+		"Invalid patch file",
+		"Invalid or outdated gba_db.bin",
+		"Patch file is corrupted",
+		"Invalid or corrupted border file"
 	};
 
 	return (res < CUSTOM_ERR_OFFSET ? result2String(res) : oafResultStrings[res - CUSTOM_ERR_OFFSET]);
@@ -0,0 +1,217 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Converts a raw border.bgr to the compressed border.oab and back.
+// The format is described in include/arm11/border.h.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+// Keep in sync with include/arm11/border.h.
+#define BORDER_MAGIC    (0x4442414Fu) // "OABD"
+#define BORDER_VERSION  (2u)
+#define BORDER_WIDTH    (240u)
+#define BORDER_HEIGHT   (400u)
+#define BORDER_PIXELS   (BORDER_WIDTH * BORDER_HEIGHT)
+#define BORDER_SIZE     (BORDER_PIXELS * 3)
+#define BORDER_FMT_RLE_BGR8  (0u)
+
+#define MAX_PACKET      (128u) // Pixels.
+
+
+typedef struct
+{
+	u32 magic;
+	u16 version;
+	u16 format;
+	u32 dataSize;
+} BorderHeader;
+_Static_assert(sizeof(BorderHeader) == 12, "Error: Border header struct is not packed!");
+
+
+
+static u32 runLength(const u8 *const pixels, const u32 pos)
+{
+	u32 len = 1;
+	while(pos + len < BORDER_PIXELS && len < MAX_PACKET &&
+	      memcmp(&pixels[pos * 3], &pixels[(pos + len) * 3], 3) == 0) len++;
+
+	return len;
+}
+
+// Runs of 2 or more pixels are always shorter than literals.
+static u32 compress(const u8 *const pixels, u8 *const out)
+{
+	u32 outPos = 0;
+	u32 pos = 0;
+	while(pos < BORDER_PIXELS)
+	{
+		const u32 run = runLength(pixels, pos);
+		if(run > 1)
+		{
+			out[outPos++] = 0x80u | (run - 1);
+			memcpy(&out[outPos], &pixels[pos * 3], 3);
+			outPos += 3;
+			pos += run;
+			continue;
+		}
+
+		u32 lit = 1;
+		while(pos + lit < BORDER_PIXELS && lit < MAX_PACKET && runLength(pixels, pos + lit) == 1) lit++;
+		out[outPos++] = lit - 1;
+		memcpy(&out[outPos], &pixels[pos * 3], lit * 3);
+		outPos += lit * 3;
+		pos += lit;
+	}
+
+	return outPos;
+}
+
+static int decompress(const u8 *in, const u8 *const inEnd, u8 *const pixels)
+{
+	u8 *out = pixels;
+	u8 *const outEnd = pixels + BORDER_SIZE;
+	while(in < inEnd)
+	{
+		const u8 ctrl = *in++;
+		const u32 size = ((ctrl & 0x7Fu) + 1) * 3;
+		if(size > (u32)(outEnd - out)) return -1;
+
+		if(ctrl & 0x80u)
+		{
+			if(inEnd - in < 3) return -1;
+			for(u32 i = 0; i < size; i += 3) memcpy(&out[i], in, 3);
+			in += 3;
+		}
+		else
+		{
+			if((u32)(inEnd - in) < size) return -1;
+			memcpy(out, in, size);
+			in += size;
+		}
+		out += size;
+	}
+
+	return (out == outEnd ? 0 : -1);
+}
+
+static u8* readFile(const char *const path, u32 *const sizeOut)
+{
+	FILE *const f = fopen(path, "rb");
+	if(f == NULL) return NULL;
+
+	fseek(f, 0, SEEK_END);
+	const long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	u8 *buf = (size > 0 ? (u8*)malloc(size) : NULL);
+	if(buf != NULL && fread(buf, 1, size, f) != (size_t)size)
+	{
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	*sizeOut = (u32)size;
+
+	return buf;
+}
+
+static int writeFile(const char *const path, const void *const a, const u32 aSize, const void *const b, const u32 bSize)
+{
+	FILE *const f = fopen(path, "wb");
+	if(f == NULL) return -1;
+
+	int res = (fwrite(a, 1, aSize, f) == aSize ? 0 : -1);
+	if(res == 0 && bSize > 0) res = (fwrite(b, 1, bSize, f) == bSize ? 0 : -1);
+	if(fclose(f) != 0) res = -1;
+
+	return res;
+}
+
+static int encode(const char *const inPath, const char *const outPath)
+{
+	u32 size;
+	u8 *const pixels = readFile(inPath, &size);
+	if(pixels == NULL || size != BORDER_SIZE)
+	{
+		fprintf(stderr, "Error: '%s' is not a raw 400x240 BGR8 border.\n", inPath);
+		free(pixels);
+		return 1;
+	}
+
+	// Worst case is one control byte per MAX_PACKET literals.
+	u8 *const data = (u8*)malloc(BORDER_SIZE + BORDER_PIXELS / MAX_PACKET + 1);
+	const u32 dataSize = compress(pixels, data);
+
+	const BorderHeader header = {BORDER_MAGIC, BORDER_VERSION, BORDER_FMT_RLE_BGR8, dataSize};
+	const int res = writeFile(outPath, &header, sizeof(header), data, dataSize);
+	if(res == 0) printf("%s: %u -> %u bytes.\n", outPath, BORDER_SIZE, (u32)sizeof(header) + dataSize);
+	else         fprintf(stderr, "Error: Failed to write '%s'.\n", outPath);
+
+	free(data);
+	free(pixels);
+
+	return (res == 0 ? 0 : 1);
+}
+
+static int decode(const char *const inPath, const char *const outPath)
+{
+	u32 size;
+	u8 *const file = readFile(inPath, &size);
+	const BorderHeader *const header = (const BorderHeader*)file;
+	if(file == NULL || size < sizeof(BorderHeader) || header->magic != BORDER_MAGIC ||
+	   header->version != BORDER_VERSION || header->format != BORDER_FMT_RLE_BGR8 ||
+	   header->dataSize != size - sizeof(BorderHeader))
+	{
+		fprintf(stderr, "Error: '%s' is not a valid border.oab.\n", inPath);
+		free(file);
+		return 1;
+	}
+
+	u8 *const pixels = (u8*)malloc(BORDER_SIZE);
+	int res = decompress(file + sizeof(BorderHeader), file + size, pixels);
+	if(res == 0)
+	{
+		res = writeFile(outPath, pixels, BORDER_SIZE, NULL, 0);
+		if(res != 0) fprintf(stderr, "Error: Failed to write '%s'.\n", outPath);
+	}
+	else fprintf(stderr, "Error: '%s' is corrupted.\n", inPath);
+
+	free(pixels);
+	free(file);
+
+	return (res == 0 ? 0 : 1);
+}
+
+int main(const int argc, const char *const argv[])
+{
+	if(argc == 3) return encode(argv[1], argv[2]);
+	if(argc == 4 && strcmp(argv[1], "-d") == 0) return decode(argv[2], argv[3]);
+
+	printf("Usage: %s border.bgr border.oab\n"
+	       "       %s -d border.oab border.bgr\n", argv[0], argv[0]);
+
+	return 1;
+}
@@ -0,0 +1,4 @@
+#!/bin/bash
+
+rm ./borderConv
+gcc -std=gnu2x -O2 -Wall -Wextra ./borderConv.c -o ./borderConv
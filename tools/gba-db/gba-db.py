@@ -1,6 +1,6 @@
 #!/usr/bin/env python3
 
-# open_agb_firm gba_db.bin Builder v4.0
+# open_agb_firm gba_db.bin Builder v5.0
 # By HTV04
 #
 # This script parses MAME's "gba.xml" (https://github.com/mamedev/mame/blob/master/hash/gba.xml)
@@ -12,6 +12,12 @@
 #
 # Note that, for efficiency, this script does not check for formatting errors and assumes that all
 # entries are valid. Errors may occur otherwise.
+#
+# File format (v5, all little endian):
+#   Header:  u32 magic "OADB", u16 version (5), u16 entry size (16), u32 entry count, u32 reserved
+#   Fanout:  257 u32 entry indices. Bucket b (top byte of the u64 SHA-1 prefix, sha1[7]) contains
+#            entries fanout[b] to fanout[b + 1] - 1.
+#   Entries: u8 sha1[8] (SHA-1 prefix), char serial[4], u32 attributes. Sorted by the u64 prefix.
 
 # MIT License
 #
@@ -36,6 +42,7 @@
 # SOFTWARE.
 
 import enum
+import struct
 import sys
 import re
 import xml.etree.ElementTree
@@ -148,8 +155,8 @@ class Database:
 				else:
 					return 'SHA-1 "' + entry.sha1.hex() + '" not found in No-Intro DAT'
 
-			if len(entry.sha1) + len(entry.serial) + len(entry.attr) != 28:
-				raise Exception('Database size is not a multiple of 28')
+			if len(entry.sha1) != 20 or len(entry.serial) + len(entry.attr) != 8:
+				raise Exception('Invalid entry size')
 
 			return entry
 
@@ -203,14 +210,27 @@ class Database:
 		log('Compiled with ' + str(count) + ' entries, ' + str(fail_count) + ' failures.\n')
 
 	def compile(self, out):
-		for entry in sorted(self.entries, key=lambda a: int.from_bytes(a.sha1[:8], byteorder='little')):
-			out(entry.sha1)
+		entries = sorted(self.entries, key=lambda a: int.from_bytes(a.sha1[:8], byteorder='little'))
+		for i in range(1, len(entries)):
+			if entries[i].sha1[:8] == entries[i - 1].sha1[:8]:
+				raise Exception('SHA-1 prefix collision "' + entries[i].sha1[:8].hex() + '"')
+
+		fanout = [0] * 257
+		for entry in entries:
+			fanout[entry.sha1[7] + 1] += 1
+		for i in range(256):
+			fanout[i + 1] += fanout[i]
+
+		out(struct.pack('<IHHII', 0x4244414F, 5, 16, len(entries), 0))
+		out(struct.pack('<257I', *fanout))
+		for entry in entries:
+			out(entry.sha1[:8])
 			out(entry.serial)
 			out(entry.attr)
 
 if __name__ == '__main__':
 	if '--help' in sys.argv:
-		print('open_agb_firm gba_db.bin Builder v4.0')
+		print('open_agb_firm gba_db.bin Builder v5.0')
 		print('By HTV04')
 		print()
 		print('Usage: gba-db.py [options]')
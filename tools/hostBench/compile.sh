@@ -0,0 +1,4 @@
+#!/bin/bash
+
+rm ./hostBench
+gcc -std=gnu2x -O2 -DNDEBUG -D__ARM11__ -Wall -Wextra -I./shim -I../../include ../../source/arm11/patch.c ../../source/arm11/save_type.c ./shim/shim.c ./hostBench.c -o ./hostBench
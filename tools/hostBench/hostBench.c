@@ -0,0 +1,489 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Runs the ROM patching and save type detection code from source/arm11 on the host.
+// Usage: hostBench [-n iterations] [ROM.gba ...]
+// Synthetic cases are checked against independently generated expected output.
+// Real ROMs are scanned and patched with the patch file next to them (if any).
+// Returns the number of failed checks.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "types.h"
+#include "util.h"
+#include "drivers/lgy_common.h"
+#include "drivers/sha.h"
+#include "arm11/config.h"
+#include "arm11/patch.h"
+#include "arm11/rom_loader.h"
+#include "arm11/save_type.h"
+
+
+#define SYNTH_ROM_SIZE  (1024u * 1024 * 16)
+#define SYNTH_DB_SIZE   (3200u) // Roughly the size of the real gba_db.bin.
+#define DB_ITERATIONS   (1000u)
+
+
+static u32 g_rngState = 0x12345678u;
+static u32 g_crc32Table[256];
+static u32 g_iterations = 5;
+static u32 g_failed = 0;
+
+
+
+static u32 rng(void)
+{
+	// xorshift32.
+	u32 x = g_rngState;
+	x ^= x<<13;
+	x ^= x>>17;
+	x ^= x<<5;
+	g_rngState = x;
+
+	return x;
+}
+
+static void fillRandom(u8 *const buf, const u32 size)
+{
+	for(u32 i = 0; i < size; i++) buf[i] = (u8)rng();
+}
+
+static u64 nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (u64)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+static u32 crc32(u32 crc, const u8 *data, u32 size)
+{
+	if(g_crc32Table[1] == 0)
+	{
+		for(u32 i = 0; i < 256; i++)
+		{
+			u32 c = i;
+			for(u32 k = 0; k < 8; k++) c = (c & 1u ? 0xEDB88320u ^ (c>>1) : c>>1);
+			g_crc32Table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	while(size--) crc = g_crc32Table[(crc ^ *data++) & 0xFFu] ^ (crc>>8);
+
+	return ~crc;
+}
+
+static void report(const char *const name, const u32 bytes, const u64 ns, const u32 calls, const bool ok)
+{
+	const double sec = (double)ns / 1e9;
+	printf("%-16s %9.1f MB/s %10.3f ms/call  %s\n", name,
+	       (sec > 0 ? (double)bytes * calls / sec / (1024 * 1024) : 0.0),
+	       (double)ns / 1e6 / calls, (ok ? "ok" : "FAIL"));
+	if(!ok) g_failed++;
+}
+
+
+
+// Growable patch file image.
+typedef struct
+{
+	u8 *data;
+	u32 size;
+	u32 cap;
+} PatchBuf;
+
+static void pbPut(PatchBuf *const pb, const void *const src, const u32 size)
+{
+	if(pb->size + size > pb->cap)
+	{
+		pb->cap = (pb->cap + size) * 2;
+		pb->data = (u8*)realloc(pb->data, pb->cap);
+		if(pb->data == NULL) abort();
+	}
+	memcpy(pb->data + pb->size, src, size);
+	pb->size += size;
+}
+
+static void pbU8(PatchBuf *const pb, const u8 v)
+{
+	pbPut(pb, &v, 1);
+}
+
+static void pbVuint(PatchBuf *const pb, u32 v)
+{
+	// UPS/BPS encoding. The last byte has bit 7 set.
+	while(1)
+	{
+		const u8 x = v & 0x7Fu;
+		v >>= 7;
+		if(v == 0)
+		{
+			pbU8(pb, 0x80u | x);
+			break;
+		}
+		pbU8(pb, x);
+		v--;
+	}
+}
+
+static void pbFooter(PatchBuf *const pb, const u8 *const src, const u32 srcSize, const u8 *const tgt, const u32 tgtSize)
+{
+	const u32 srcCrc = crc32(0, src, srcSize);
+	const u32 tgtCrc = crc32(0, tgt, tgtSize);
+	pbPut(pb, &srcCrc, 4);
+	pbPut(pb, &tgtCrc, 4);
+	const u32 patchCrc = crc32(0, pb->data, pb->size);
+	pbPut(pb, &patchCrc, 4);
+}
+
+// Random hunks and RLE hunks. Applied to tgt while generating.
+static void makeIps(PatchBuf *const pb, u8 *const tgt, const u32 size)
+{
+	pbPut(pb, "PATCH", 5);
+	for(u32 i = 0; i < 4096; i++)
+	{
+		const u32 offset = rng() % (size - 0x10000);
+		if(offset == 0x454F46u) continue; // "EOF".
+
+		const u8 hdr[3] = {offset>>16, offset>>8, offset};
+		pbPut(pb, hdr, 3);
+		if(i % 8 == 7)
+		{
+			const u32 length = 1 + rng() % 0x4000;
+			const u8 val = (u8)rng();
+			const u8 rle[5] = {0, 0, length>>8, length, val};
+			pbPut(pb, rle, 5);
+			memset(tgt + offset, val, length);
+		}
+		else
+		{
+			const u32 length = 1 + rng() % 2048;
+			const u8 len[2] = {length>>8, length};
+			pbPut(pb, len, 2);
+			fillRandom(tgt + offset, length);
+			pbPut(pb, tgt + offset, length);
+		}
+	}
+	pbPut(pb, "EOF", 3);
+}
+
+// XOR runs of nonzero bytes. Each run ends with the 0 terminator for one unchanged byte.
+static void makeUps(PatchBuf *const pb, const u8 *const src, u8 *const tgt, const u32 size)
+{
+	pbPut(pb, "UPS1", 4);
+	pbVuint(pb, size);
+	pbVuint(pb, size);
+
+	u32 offset = 0;
+	while(1)
+	{
+		const u32 gap = rng() % 8192;
+		const u32 length = 1 + rng() % 1024;
+		if(offset + gap + length + 1 > size) break;
+
+		pbVuint(pb, gap);
+		offset += gap;
+		for(u32 i = 0; i < length; i++)
+		{
+			const u8 x = (u8)(rng() | 1u);
+			pbU8(pb, x);
+			tgt[offset++] ^= x;
+		}
+		pbU8(pb, 0);
+		offset++;
+	}
+	pbFooter(pb, src, size, tgt, size);
+}
+
+// Mostly SourceRead like real ROM hacks with all 4 actions mixed in.
+static void makeBps(PatchBuf *const pb, const u8 *const src, u8 *const tgt, const u32 size)
+{
+	pbPut(pb, "BPS1", 4);
+	pbVuint(pb, size);
+	pbVuint(pb, size);
+	pbVuint(pb, 0);
+
+	u32 out = 0, sourceRel = 0, targetRel = 0;
+	while(out < size)
+	{
+		u32 length = 1 + rng() % 4096;
+		length = (length > size - out ? size - out : length);
+		u32 action = rng() % 8;
+		action = (action > 3 ? 0 : action);
+		if(action == 3 && out < 2) action = 0;
+
+		pbVuint(pb, (length - 1)<<2 | action);
+		switch(action)
+		{
+			case 0: // SourceRead.
+				memcpy(tgt + out, src + out, length);
+				break;
+			case 1: // TargetRead.
+				fillRandom(tgt + out, length);
+				pbPut(pb, tgt + out, length);
+				break;
+			case 2: // SourceCopy.
+			{
+				const u32 to = rng() % (size - length);
+				pbVuint(pb, (to >= sourceRel ? (to - sourceRel)<<1 : (sourceRel - to)<<1 | 1u));
+				memcpy(tgt + out, src + to, length);
+				sourceRel = to + length;
+				break;
+			}
+			case 3: // TargetCopy. Overlaps repeat like LZ77.
+			{
+				const u32 to = out - 1 - rng() % (out < 64 ? out : 64);
+				pbVuint(pb, (to >= targetRel ? (to - targetRel)<<1 : (targetRel - to)<<1 | 1u));
+				for(u32 i = 0; i < length; i++) tgt[out + i] = tgt[to + i];
+				targetRel = to + length;
+				break;
+			}
+		}
+		out += length;
+	}
+	pbFooter(pb, src, size, tgt, size);
+}
+
+static bool writeFile(const char *const path, const void *const data, const u32 size)
+{
+	FILE *const f = fopen(path, "wb");
+	if(f == NULL) return false;
+
+	const bool ok = fwrite(data, 1, size, f) == size;
+	fclose(f);
+
+	return ok;
+}
+
+static void benchPatch(const char *const name, const char *const patchPath, const u8 *const src, const u8 *const tgt)
+{
+	PatchBuf pb = {0};
+	PatchBuf *const p = &pb;
+	u8 *const expected = (u8*)malloc(SYNTH_ROM_SIZE);
+	if(expected == NULL) abort();
+	memcpy(expected, tgt, SYNTH_ROM_SIZE);
+
+	if(strcmp(name, "patch IPS") == 0)      makeIps(p, expected, SYNTH_ROM_SIZE);
+	else if(strcmp(name, "patch UPS") == 0) makeUps(p, src, expected, SYNTH_ROM_SIZE);
+	else                                    makeBps(p, src, expected, SYNTH_ROM_SIZE);
+
+	bool ok = writeFile(patchPath, p->data, p->size);
+	u64 ns = 0;
+	for(u32 i = 0; i < g_iterations && ok; i++)
+	{
+		memcpy(g_hostRomLoc, src, SYNTH_ROM_SIZE);
+		u32 romSize = SYNTH_ROM_SIZE;
+
+		const u64 start = nowNs();
+		const Result res = patchRom("bench.gba", &romSize);
+		ns += nowNs() - start;
+
+		ok = res == RES_OK && romSize == SYNTH_ROM_SIZE && memcmp(g_hostRomLoc, expected, SYNTH_ROM_SIZE) == 0;
+	}
+	report(name, SYNTH_ROM_SIZE, ns, g_iterations, ok);
+
+	unlink(patchPath);
+	free(p->data);
+	free(expected);
+}
+
+static void benchSaveScan(void)
+{
+	static const char saveStr[] = "FLASH1M_V103";
+	u8 *const rom = g_hostRomLoc;
+
+	// Worst case. No string anywhere.
+	fillRandom(rom, SYNTH_ROM_SIZE);
+	u64 ns = 0;
+	bool ok = true;
+	for(u32 i = 0; i < g_iterations; i++)
+	{
+		const u64 start = nowNs();
+		const u16 saveType = scanSdkSaveType((u32*)(rom + 0xE4), (u32*)(rom + SYNTH_ROM_SIZE), SYNTH_ROM_SIZE);
+		ns += nowNs() - start;
+		ok &= saveType == 0xFF;
+	}
+	report("save scan (none)", SYNTH_ROM_SIZE, ns, g_iterations, ok);
+
+	// String in the last KiB.
+	memcpy(rom + SYNTH_ROM_SIZE - 1024, saveStr, sizeof(saveStr) - 1);
+	ns = 0;
+	ok = true;
+	for(u32 i = 0; i < g_iterations; i++)
+	{
+		const u64 start = nowNs();
+		const u16 saveType = scanSdkSaveType((u32*)(rom + 0xE4), (u32*)(rom + SYNTH_ROM_SIZE), SYNTH_ROM_SIZE);
+		ns += nowNs() - start;
+		ok &= saveType == SAVE_TYPE_FLASH_1m_MRX_RTC;
+	}
+	report("save scan (end)", SYNTH_ROM_SIZE, ns, g_iterations, ok);
+}
+
+static int dbEntryCmp(const void *a, const void *b)
+{
+	return (int)((const GbaDbEntry*)a)->sha1[7] - (int)((const GbaDbEntry*)b)->sha1[7];
+}
+
+static void benchGbaDb(void)
+{
+	// Synthetic gba_db.bin in the format tools/gba-db writes.
+	const u32 dbSize = sizeof(GbaDbHeader) + sizeof(GbaDbEntry) * SYNTH_DB_SIZE;
+	u8 *const db = (u8*)calloc(1, dbSize);
+	if(db == NULL) abort();
+	GbaDbHeader *const hdr = (GbaDbHeader*)db;
+	GbaDbEntry *const entries = (GbaDbEntry*)(db + sizeof(GbaDbHeader));
+	for(u32 i = 0; i < SYNTH_DB_SIZE; i++)
+	{
+		fillRandom(entries[i].sha1, 8);
+		memcpy(entries[i].serial, "BNCH", 4);
+		entries[i].attr = rng() % (SAVE_TYPE_NONE + 1);
+	}
+	qsort(entries, SYNTH_DB_SIZE, sizeof(GbaDbEntry), dbEntryCmp);
+	hdr->magic      = GBA_DB_MAGIC;
+	hdr->version    = GBA_DB_VERSION;
+	hdr->entrySize  = sizeof(GbaDbEntry);
+	hdr->numEntries = SYNTH_DB_SIZE;
+	for(u32 i = 0, b = 0; b <= GBA_DB_FANOUT; b++)
+	{
+		while(i < SYNTH_DB_SIZE && entries[i].sha1[7] < b) i++;
+		hdr->fanout[b] = i;
+	}
+
+	bool ok = writeFile("gba_db.bin", db, dbSize);
+	const GbaDbEntry hit = entries[SYNTH_DB_SIZE / 3];
+	free(db);
+
+	// Game code used by the override list.
+	memset(g_hostRomLoc + 0xAC, 0, 4);
+
+	OafConfig cfg;
+	memset(&cfg, 0, sizeof(cfg));
+	cfg.useGbaDb    = true;
+	cfg.defaultSave = SAVE_TYPE_SRAM_256k;
+
+	u64 ns = 0;
+	for(u32 i = 0; i < DB_ITERATIONS && ok; i++)
+	{
+		RomInfo info;
+		memset(&info, 0, sizeof(info));
+		info.romSize     = SYNTH_ROM_SIZE;
+		info.sdkSaveType = 0xFF;
+		info.flags       = ROM_LOAD_HASH;
+
+		// Every 2nd lookup is a miss which must fall back to the default save type.
+		const bool miss = i & 1u;
+		memcpy(info.sha1, hit.sha1, 8);
+		if(miss) ((u8*)info.sha1)[0] ^= 0xFFu;
+
+		const u64 start = nowNs();
+		const u16 saveType = getSaveType(&cfg, &info, "bench.sav");
+		ns += nowNs() - start;
+
+		ok = saveType == (miss ? SAVE_TYPE_SRAM_256k : (hit.attr & 0xFu)) &&
+		     (info.flags & ROM_INFO_DB) && (bool)(info.flags & ROM_INFO_DB_FOUND) == !miss;
+	}
+	report("gba_db lookup", 0, ns, DB_ITERATIONS, ok);
+
+	unlink("gba_db.bin");
+}
+
+static void benchRealRom(const char *const path)
+{
+	FILE *const f = fopen(path, "rb");
+	if(f == NULL)
+	{
+		fprintf(stderr, "Failed to open '%s'.\n", path);
+		g_failed++;
+		return;
+	}
+	const u32 fileSize = (u32)fread(g_hostRomLoc, 1, LGY_MAX_ROM_SIZE, f);
+	fclose(f);
+
+	// Same padding as the ROM loader.
+	u32 romSize = nextPow2(fileSize);
+	romSize = (romSize < 0x100000 ? 0x100000 : romSize);
+	memset(g_hostRomLoc + fileSize, 0xFF, romSize - fileSize);
+	printf("%s (%" PRIu32 " bytes)\n", path, fileSize);
+
+	const u64 start = nowNs();
+	const u16 sdkSaveType = scanSdkSaveType((u32*)(g_hostRomLoc + 0xE4), (u32*)(g_hostRomLoc + (fileSize & ~3u)), romSize);
+	report("  save scan", romSize, nowNs() - start, 1, true);
+	printf("  SDK save type: %u, detected: %u\n", sdkSaveType, detectSaveType(sdkSaveType, SAVE_TYPE_SRAM_256k));
+
+	PatchFileInfo patchInfo;
+	if(findRomPatch(path, &patchInfo))
+	{
+		const u64 patchStart = nowNs();
+		const Result res = patchRom(path, &romSize);
+		report("  patch", romSize, nowNs() - patchStart, 1, res == RES_OK);
+	}
+
+	u32 sha1[5];
+	sha((u32*)g_hostRomLoc, romSize, sha1, SHA_IN_BIG | SHA_1_MODE, SHA_OUT_BIG);
+	printf("  SHA1: ");
+	for(u32 i = 0; i < 20; i++) printf("%02X", ((u8*)sha1)[i]);
+	printf("\n  CRC32: %08" PRIX32 "\n", crc32(0, g_hostRomLoc, romSize));
+}
+
+int main(int argc, char *argv[])
+{
+	int argi = 1;
+	if(argc > 2 && strcmp(argv[1], "-n") == 0)
+	{
+		g_iterations = (u32)strtoul(argv[2], NULL, 0);
+		g_iterations = (g_iterations == 0 ? 1 : g_iterations);
+		argi = 3;
+	}
+
+	// The BPS source copy lives right after the ROM area.
+	g_hostRomLoc = (u8*)malloc(HOST_ROM_AREA);
+	u8 *const src = (u8*)malloc(SYNTH_ROM_SIZE);
+	if(g_hostRomLoc == NULL || src == NULL)
+	{
+		fputs("Out of memory.\n", stderr);
+		return 1;
+	}
+
+	// Real ROMs first. Patches are searched relative to the current dir.
+	for(; argi < argc; argi++) benchRealRom(argv[argi]);
+
+	// Everything synthetic happens in a temp dir.
+	char tmpDir[] = "/tmp/hostBench.XXXXXX";
+	if(mkdtemp(tmpDir) == NULL || chdir(tmpDir) != 0)
+	{
+		fputs("Failed to create temp dir.\n", stderr);
+		return 1;
+	}
+
+	fillRandom(src, SYNTH_ROM_SIZE);
+	benchPatch("patch IPS", "bench.ips", src, src);
+	benchPatch("patch UPS", "bench.ups", src, src);
+	benchPatch("patch BPS", "bench.bps", src, src);
+	benchSaveScan();
+	benchGbaDb();
+
+	if(chdir("/") == 0) rmdir(tmpDir);
+	free(src);
+	free(g_hostRomLoc);
+
+	return (int)g_failed;
+}
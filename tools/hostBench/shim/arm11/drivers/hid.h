@@ -0,0 +1,49 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host build shim. Only what the benchmarked modules use.
+
+#include "types.h"
+
+
+#define KEY_A           (1u)
+#define KEY_B           (1u<<1)
+#define KEY_SELECT      (1u<<2)
+#define KEY_START       (1u<<3)
+#define KEY_DRIGHT      (1u<<4)
+#define KEY_DLEFT       (1u<<5)
+#define KEY_DUP         (1u<<6)
+#define KEY_DDOWN       (1u<<7)
+#define KEY_R           (1u<<8)
+#define KEY_L           (1u<<9)
+#define KEY_X           (1u<<10)
+#define KEY_Y           (1u<<11)
+
+#define KEY_POWER       (1u<<1)
+#define KEY_POWER_HELD  (1u<<2)
+
+
+
+// Always reports Y+UP held so error prompts continue on their own.
+void hidScanInput(void);
+u32 hidKeysHeld(void);
+u32 hidKeysDown(void);
+u32 hidKeysUp(void);
+u32 hidGetExtraKeys(const u32 clearMask);
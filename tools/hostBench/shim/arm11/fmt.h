@@ -0,0 +1,37 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host build shim. Only what the benchmarked modules use.
+
+#include <stdarg.h>
+#include "types.h"
+
+
+#ifdef NDEBUG
+#define debug_printf(fmt, ...)  ((void)0)
+#else
+#define debug_printf(fmt, ...)  ee_printf(fmt, ##__VA_ARGS__)
+#endif
+
+
+
+// Silent unless HOSTBENCH_VERBOSE is set.
+int ee_printf(const char *const fmt, ...);
+int ee_puts(const char *const str);
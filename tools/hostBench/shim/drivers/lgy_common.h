@@ -0,0 +1,54 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host build shim. Only what the benchmarked modules use.
+
+#include "types.h"
+#include "error_codes.h"
+
+
+// The ROM area and the spare FCRAM after it (BPS source) are one host buffer.
+#define LGY_ROM_LOC       ((uintptr_t)g_hostRomLoc)
+#define LGY_MAX_ROM_SIZE  (1024u * 1024 * 32)
+#define HOST_ROM_AREA     (LGY_MAX_ROM_SIZE * 2)
+
+enum
+{
+	SAVE_TYPE_EEPROM_8k             = 0u,
+	SAVE_TYPE_EEPROM_8k_2           = 1u,
+	SAVE_TYPE_EEPROM_64k            = 2u,
+	SAVE_TYPE_EEPROM_64k_2          = 3u,
+	SAVE_TYPE_FLASH_512k_AML_RTC    = 4u,
+	SAVE_TYPE_FLASH_512k_AML        = 5u,
+	SAVE_TYPE_FLASH_512k_SST_RTC    = 6u,
+	SAVE_TYPE_FLASH_512k_SST        = 7u,
+	SAVE_TYPE_FLASH_512k_PSC_RTC    = 8u,
+	SAVE_TYPE_FLASH_512k_PSC        = 9u,
+	SAVE_TYPE_FLASH_1m_MRX_RTC      = 10u,
+	SAVE_TYPE_FLASH_1m_MRX          = 11u,
+	SAVE_TYPE_FLASH_1m_SNO_RTC      = 12u,
+	SAVE_TYPE_FLASH_1m_SNO          = 13u,
+	SAVE_TYPE_SRAM_256k             = 14u,
+	SAVE_TYPE_NONE                  = 15u,
+	SAVE_TYPE_MASK                  = SAVE_TYPE_NONE
+};
+
+
+extern u8 *g_hostRomLoc;
@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host build shim. Only what the benchmarked modules use.
+
+#include "types.h"
+
+
+#define SHA_IN_BIG   (1u<<3)
+#define SHA_OUT_BIG  (SHA_IN_BIG)
+#define SHA_1_MODE   (2u<<4)
+
+
+
+// SHA1 only. The mode is ignored.
+void sha(const u32 *data, u32 size, u32 *const hash, const u16 params, const u16 hashEndianess);
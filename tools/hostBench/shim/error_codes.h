@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host build shim. Only what the benchmarked modules use.
+
+#include "types.h"
+
+
+enum
+{
+	RES_OK = 0,
+	RES_SD_CARD_REMOVED,
+	RES_DISK_FULL,
+	RES_INVALID_ARG,
+	RES_OUT_OF_MEM,
+	RES_OUT_OF_RANGE,
+	RES_NOT_FOUND,
+	RES_PATH_TOO_LONG,
+
+	RES_FR_DISK_ERR,
+	RES_FR_NO_FILE,
+
+	CUSTOM_ERR_OFFSET = 200
+};
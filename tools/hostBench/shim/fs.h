@@ -0,0 +1,53 @@
+#pragma once
+
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host build shim. Only what the benchmarked modules use.
+
+#include "error_codes.h"
+
+
+#define FA_READ           (1u)
+#define FA_WRITE          (1u<<1)
+#define FA_OPEN_EXISTING  (0u)
+#define FA_CREATE_ALWAYS  (1u<<3)
+
+
+typedef u8 FHandle;
+
+typedef struct
+{
+	u64 fsize;
+	u16 fdate;
+	u16 ftime;
+	u8 fattrib;
+	char fname[256];
+} FILINFO;
+
+
+
+Result fOpen(FHandle *const hOut, const char *const path, const u8 mode);
+Result fRead(const FHandle h, void *const buf, const u32 size, u32 *const bytesRead);
+Result fWrite(const FHandle h, const void *const buf, const u32 size, u32 *const bytesWritten);
+u32 fSize(const FHandle h);
+u32 fTell(const FHandle h);
+Result fLseek(const FHandle h, const u32 off);
+Result fClose(const FHandle h);
+Result fStat(const char *const path, FILINFO *const fi);
+Result fUnlink(const char *const path);
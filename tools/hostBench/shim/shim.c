@@ -0,0 +1,257 @@
+/*
+ *   This file is part of open_agb_firm
+ *   Copyright (C) 2024 derrek, profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "types.h"
+#include "fs.h"
+#include "util.h"
+#include "arm11/fmt.h"
+#include "arm11/console.h"
+#include "arm11/power.h"
+#include "arm11/drivers/hid.h"
+#include "drivers/gfx.h"
+#include "drivers/sha.h"
+#include "drivers/lgy_common.h"
+#include "oaf_error_codes.h"
+
+
+#define MAX_FILES  (8u)
+
+
+u8 *g_hostRomLoc = NULL;
+static FILE *g_files[MAX_FILES] = {0};
+
+
+
+// fs.h on top of stdio. Paths are relative to the current dir.
+Result fOpen(FHandle *const hOut, const char *const path, const u8 mode)
+{
+	u32 i = 0;
+	while(i < MAX_FILES && g_files[i] != NULL) i++;
+	if(i == MAX_FILES) return RES_OUT_OF_MEM;
+
+	FILE *const f = fopen(path, (mode & FA_CREATE_ALWAYS ? "w+b" : (mode & FA_WRITE ? "r+b" : "rb")));
+	if(f == NULL) return RES_FR_NO_FILE;
+
+	g_files[i] = f;
+	*hOut = i;
+
+	return RES_OK;
+}
+
+Result fRead(const FHandle h, void *const buf, const u32 size, u32 *const bytesRead)
+{
+	const size_t read = fread(buf, 1, size, g_files[h]);
+	if(ferror(g_files[h])) return RES_FR_DISK_ERR;
+	if(bytesRead != NULL) *bytesRead = (u32)read;
+
+	return RES_OK;
+}
+
+Result fWrite(const FHandle h, const void *const buf, const u32 size, u32 *const bytesWritten)
+{
+	const size_t written = fwrite(buf, 1, size, g_files[h]);
+	if(bytesWritten != NULL) *bytesWritten = (u32)written;
+
+	return (written == size ? RES_OK : RES_FR_DISK_ERR);
+}
+
+u32 fSize(const FHandle h)
+{
+	struct stat st;
+	if(fstat(fileno(g_files[h]), &st) != 0) return 0;
+
+	return (u32)st.st_size;
+}
+
+u32 fTell(const FHandle h)
+{
+	return (u32)ftell(g_files[h]);
+}
+
+Result fLseek(const FHandle h, const u32 off)
+{
+	return (fseek(g_files[h], off, SEEK_SET) == 0 ? RES_OK : RES_FR_DISK_ERR);
+}
+
+Result fClose(const FHandle h)
+{
+	fclose(g_files[h]);
+	g_files[h] = NULL;
+
+	return RES_OK;
+}
+
+Result fStat(const char *const path, FILINFO *const fi)
+{
+	struct stat st;
+	if(stat(path, &st) != 0) return RES_FR_NO_FILE;
+
+	memset(fi, 0, sizeof(FILINFO));
+	fi->fsize = (u64)st.st_size;
+	fi->fdate = (u16)(st.st_mtime>>16);
+	fi->ftime = (u16)st.st_mtime;
+
+	return RES_OK;
+}
+
+Result fUnlink(const char *const path)
+{
+	return (unlink(path) == 0 ? RES_OK : RES_FR_NO_FILE);
+}
+
+char* safeStrcpy(char *const dst, const char *const src, const size_t num)
+{
+	if(num == 0) return dst;
+
+	strncpy(dst, src, num - 1);
+	dst[num - 1] = '\0';
+
+	return dst;
+}
+
+int ee_printf(const char *const fmt, ...)
+{
+	if(getenv("HOSTBENCH_VERBOSE") == NULL) return 0;
+
+	va_list args;
+	va_start(args, fmt);
+	const int res = vprintf(fmt, args);
+	va_end(args);
+
+	return res;
+}
+
+int ee_puts(const char *const str)
+{
+	return ee_printf("%s\n", str);
+}
+
+void consoleClear(void)
+{
+}
+
+void power_off(void)
+{
+	fputs("power_off() called.\n", stderr);
+	exit(1);
+}
+
+void hidScanInput(void)
+{
+}
+
+u32 hidKeysHeld(void)
+{
+	return KEY_Y | KEY_DUP;
+}
+
+u32 hidKeysDown(void)
+{
+	return KEY_DUP;
+}
+
+u32 hidKeysUp(void)
+{
+	return 0;
+}
+
+u32 hidGetExtraKeys(UNUSED const u32 clearMask)
+{
+	return 0;
+}
+
+void GFX_waitForVBlank0(void)
+{
+}
+
+void GFX_flushBuffers(void)
+{
+}
+
+void waitForRomPadding(void)
+{
+}
+
+const char* oafResult2String(Result res)
+{
+	static char str[16];
+	snprintf(str, sizeof(str), "error %" PRIu32, res);
+
+	return str;
+}
+
+void printErrorWaitInput(Result res, UNUSED u32 waitKeys)
+{
+	fprintf(stderr, "Error: %s\n", oafResult2String(res));
+}
+
+// Plain SHA1. Output is always big endian like SHA_OUT_BIG.
+void sha(const u32 *data, u32 size, u32 *const hash, UNUSED const u16 params, UNUSED const u16 hashEndianess)
+{
+	u32 h[5] = {0x67452301u, 0xEFCDAB89u, 0x98BADCFEu, 0x10325476u, 0xC3D2E1F0u};
+	const u8 *p = (const u8*)data;
+	const u64 bits = (u64)size * 8;
+	u64 pos = 0;
+	const u64 total = ((u64)size + 9 + 63) & ~(u64)63;
+	while(pos < total)
+	{
+		u8 block[64];
+		for(u32 i = 0; i < 64; i++, pos++)
+		{
+			if(pos < size)                 block[i] = p[pos];
+			else if(pos == size)           block[i] = 0x80;
+			else if(pos >= total - 8)      block[i] = (u8)(bits>>((total - 1 - pos) * 8));
+			else                           block[i] = 0;
+		}
+
+		u32 w[80];
+		for(u32 i = 0; i < 16; i++)
+			w[i] = (u32)block[i * 4]<<24 | (u32)block[i * 4 + 1]<<16 | (u32)block[i * 4 + 2]<<8 | block[i * 4 + 3];
+		for(u32 i = 16; i < 80; i++)
+		{
+			const u32 t = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+			w[i] = t<<1 | t>>31;
+		}
+
+		u32 a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+		for(u32 i = 0; i < 80; i++)
+		{
+			u32 f, k;
+			if(i < 20)      { f = (b & c) | (~b & d);          k = 0x5A827999u; }
+			else if(i < 40) { f = b ^ c ^ d;                   k = 0x6ED9EBA1u; }
+			else if(i < 60) { f = (b & c) | (b & d) | (c & d); k = 0x8F1BBCDCu; }
+			else            { f = b ^ c ^ d;                   k = 0xCA62C1D6u; }
+
+			const u32 t = (a<<5 | a>>27) + f + e + k + w[i];
+			e = d;
+			d = c;
+			c = b<<30 | b>>2;
+			b = a;
+			a = t;
+		}
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e;
+	}
+
+	// Big endian bytes in memory.
+	for(u32 i = 0; i < 5; i++) hash[i] = __builtin_bswap32(h[i]);
+}
@@ -1,4 +1,5 @@
 #!/bin/bash
 
-rm ./lgyFbScaler
-g++ -std=c++17 -s -flto -O2 -fstrict-aliasing -ffunction-sections -Wall -Wextra -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler
\ No newline at end of file
+rm ./lgyFbScaler ./lgyMatrixOpt
+g++ -std=c++17 -s -flto -O3 -fstrict-aliasing -ffunction-sections -Wall -Wextra -pthread -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler
+g++ -std=c++17 -s -flto -O3 -fstrict-aliasing -ffunction-sections -Wall -Wextra -pthread -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyMatrixOpt.cpp -o ./lgyMatrixOpt
\ No newline at end of file
@@ -15,286 +15,142 @@
  *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cinttypes>
+#include <cstring>
 #include <exception>
+#include <filesystem>
 #include <memory>
+#include <string>
+#include <thread>
+#include <vector>
 #include "lodepng.h"
+#include "lgyFbScaler.h"
 
 
 #define NDEBUG  (1)
 
 
-typedef uint8_t  u8;
-typedef uint16_t u16;
-typedef uint32_t u32;
-typedef uint64_t u64;
-
-typedef int8_t  s8;
-typedef int16_t s16;
-typedef int32_t s32;
-typedef int64_t s64;
-
-
-typedef struct
-{
-	u16 oWidth;
-	u16 oHight;
-	u16 width;
-	u16 hight;
-	s16 vMatrix[8 * 6];
-	s16 hMatrix[8 * 6];
-	u8  vPatt;
-	u8  hPatt;
-	u8  vLen;
-	u8  hLen;
-} ScalerParams;
-
-struct Pixel final
-{
-	u8 m_r, m_g, m_b, m_a;
-
-
-	// Constructors
-	Pixel(void) noexcept {}
-	Pixel(u8 r, u8 g, u8 b, u8 a = 0xFFu) noexcept : m_r(r), m_g(g), m_b(b), m_a(a) {}
-	Pixel(const Pixel&) noexcept = delete; // Copy
-	Pixel(Pixel&&) noexcept = delete;      // Move
-
-	// Destructors
-	//~Pixel(void) noexcept = default;
-
-	// Operators
-	Pixel& operator =(const Pixel&) noexcept = default; // Copy
-	Pixel& operator =(Pixel&&) noexcept = default;      // Move
-
-	// Functions
-};
-
-class Scaler final
+// Returns 0 on success or the exit code.
+static int scaleFile(const char *const inPath, const char *const outPath, ScalerParams params, const bool verbose)
 {
-	const Pixel *m_buf;
-	const s16 *const m_matrix;
-	s16 m_pos;
-	const u16 m_lineLen;
-	const u8 m_patt;
-	const u8 m_pattLen;
-	u8 m_pattPos;
-
-
-	// Constructors
-	Scaler(void) noexcept = delete;
-	Scaler(const Scaler&) noexcept = delete; // Copy
-	Scaler(Scaler&&) noexcept = delete;      // Move
-
-	// Destructors
-	//~Scaler(void) noexcept = default;
-
-	// Operators
-	Scaler& operator =(const Scaler&) noexcept = delete; // Copy
-	Scaler& operator =(Scaler&&) noexcept = delete;      // Move
-
-	const Pixel& operator [](u8 idx) const noexcept
+	unsigned char *inBuf;
+	u32 oWidth, oHight;
+	u32 lpngErr;
+	if((lpngErr = lodepng_decode32_file(&inBuf, &oWidth, &oHight, inPath)))
 	{
-		//idx = (idx > 5 ? 5 : idx);
-
-		idx = 5 - idx;
-		u32 bufPos;
-		if(m_pos - idx <= 0)               bufPos = 0;             // Output first pixel for lower out of bounds.
-		else if(m_pos - idx >= m_lineLen)  bufPos = m_lineLen - 1; // Output last pixel for upper out of bounds.
-		else                               bufPos = m_pos - idx;   // Normal pixel window offset.
-
-		return m_buf[bufPos];
+		fprintf(stderr, "%s: lodepng error: %s\n", inPath, lodepng_error_text(lpngErr));
+		return 1;
 	}
 
-	// Functions
-
-
-public:
-	// Constructors
-	Scaler(const Pixel *buf, u16 lineLen, const s16 *matrix, u8 patt, u8 pattLen) noexcept
-	: m_buf(buf), m_matrix(matrix), m_pos(0), m_lineLen(lineLen), m_patt(patt), m_pattLen(pattLen), m_pattPos(0)
+	if(oWidth > 512 || oHight > 512)
 	{
+		fprintf(stderr, "%s: Error: Input image too big.\n", inPath);
+		free(inBuf);
+		return 2;
 	}
+	params.oWidth = oWidth;
+	params.oHight = oHight;
 
-	// Destructors
-
-	// Operators
-
-	// Functions
-	Pixel calcPixel(void) const noexcept
+	const float scaleX = (float)params.hLen / __builtin_popcount(params.hPatt);
+	const float scaleY = (float)params.vLen / __builtin_popcount(params.vPatt);
+	params.width = oWidth * scaleX;
+	params.hight = oHight * scaleY;
+	if(verbose)
 	{
-		s32 r = 0, g = 0, b = 0;
-		const s16 *matrix = &m_matrix[m_pattPos];
-		for(u8 i = 0; i < 6; i++)
-		{
-			const Pixel &pixel = (*this)[i];
-			const s16 mult = matrix[i * 8];
-
-			r += pixel.m_r * mult;
-			g += pixel.m_g * mult;
-			b += pixel.m_b * mult;
-		}
-
-		// Clamp the result.
-		r = (r > 0x3FC000 ? 0x3FC000 : r);
-		r = (r < 0 ? 0 : r);
-		g = (g > 0x3FC000 ? 0x3FC000 : g);
-		g = (g < 0 ? 0 : g);
-		b = (b > 0x3FC000 ? 0x3FC000 : b);
-		b = (b < 0 ? 0 : b);
-
-		return Pixel(r / 0x4000, g / 0x4000, b / 0x4000);
+		printf("Output width: %" PRIu16 " (x%f)\nOutput hight: %" PRIu16 " (x%f)\n",
+		       params.width, scaleX, params.hight, scaleY);
 	}
 
-	void next(void) noexcept
-	{
-		if(m_patt & 1u<<m_pattPos++)
-		{
-			if(m_pos == 0) m_pos = 3; // Hardware loads 3 more pixels after the first.
-			else           m_pos++;
-		}
-
-		if(m_pattPos == m_pattLen) m_pattPos = 0;
-	}
+	Planes out(params.width, params.hight);
+	scaleFrame(reinterpret_cast<const Pixel*>(inBuf), out, params);
+	free(inBuf);
 
-	void nextLine(void) noexcept
-	{
-		m_buf += m_lineLen;
-		m_pos = 0;
-	}
+	// Back to RGBA for lodepng.
+	const size_t numPixels = (size_t)params.width * params.hight;
+	std::unique_ptr<Pixel[]> outBuf(new Pixel[numPixels]);
+	for(size_t i = 0; i < numPixels; i++)
+		outBuf[i] = Pixel{out.ch[0][i], out.ch[1][i], out.ch[2][i], 0xFFu};
 
-	void resetLine(void) noexcept
+	if((lpngErr = lodepng_encode32_file(outPath, reinterpret_cast<const unsigned char*>(outBuf.get()), params.width, params.hight)))
 	{
-		m_pos = 0;
-		m_pattPos = 0;
+		fprintf(stderr, "%s: lodepng error: %s\n", outPath, lodepng_error_text(lpngErr));
+		return 4;
 	}
-};
 
+	return 0;
+}
 
-static void scaleFrame(Pixel *buf, const ScalerParams &params)
+// Scales all PNGs in inDir to outDir. Images are spread over threads.
+static int scaleDir(const char *const inDir, const char *const outDir, const ScalerParams &params, unsigned numThreads)
 {
-	std::unique_ptr<Pixel[]> tmpBuf(new(std::nothrow) Pixel[512 * 512]);
-	const u16 oHight = params.oHight;
-	const u16 width = params.width;
+	namespace fs = std::filesystem;
 
+	std::vector<fs::path> files;
+	std::error_code ec;
+	for(const auto &entry : fs::directory_iterator(inDir, ec))
 	{
-		Scaler scaler(buf, params.oWidth, params.hMatrix, params.hPatt, params.hLen);
-		for(u16 h = 0; h < oHight; h++)
-		{
-			for(u16 w = 0; w < width; w++)
-			{
-				tmpBuf[width * h + w] = scaler.calcPixel();
-				scaler.next();
-			}
-
-			scaler.nextLine();
-		}
+		if(entry.is_regular_file() && entry.path().extension() == ".png") files.push_back(entry.path());
 	}
-
+	if(ec)
 	{
-		std::unique_ptr<Pixel[]> tmpLine(new(std::nothrow) Pixel[512]);
-		const u16 hight = params.hight;
-		Scaler scaler(tmpLine.get(), oHight, params.vMatrix, params.vPatt, params.vLen);
-		for(u16 w = 0; w < width; w++)
-		{
-			for(u16 h = 0; h < oHight; h++)
-				tmpLine[h] = tmpBuf[width * h + w];
-
-			for(u16 h = 0; h < hight; h++)
-			{
-				buf[width * h + w] = scaler.calcPixel();
-				scaler.next();
-			}
-			scaler.resetLine();
-		}
+		fprintf(stderr, "Failed to read '%s': %s\n", inDir, ec.message().c_str());
+		return 1;
 	}
-}
-
-// TODO: More validation.
-static bool parseMatrix(const char *const file, ScalerParams &params)
-{
-	char buf[1024] = {};
-	FILE *f = fopen(file, "r");
-	fread(buf, 1023, 1, f);
-	fclose(f);
+	fs::create_directories(outDir, ec);
 
-	// Parse horizontal params.
-	const char *token;
-	if((token = strtok(buf, "\t ,\n\r")) == nullptr) return false;
-	params.hPatt = strtoul(token, nullptr, 2) & 0xFFu;
-
-	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
-	params.hLen = strtoul(token, nullptr, 10) & 0xFFu;
-	if(params.hLen > 8 || params.hLen < 1) return false;
-
-	for(u8 i = 0; i < 48; i++)
+	const auto start = std::chrono::steady_clock::now();
+	std::atomic<size_t> next{0};
+	std::atomic<u32> failed{0};
+	auto worker = [&]()
 	{
-		if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) break;
-		params.hMatrix[i] = (s16)strtol(token, nullptr, 0) & ~15u; // Bits 0-3 are not used.
-	}
-
-	// Parse vertical params.
-	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
-	params.vPatt = strtoul(token, nullptr, 2) & 0xFFu;
+		size_t i;
+		while((i = next++) < files.size())
+		{
+			const std::string outPath = (fs::path(outDir) / files[i].filename()).string();
+			if(scaleFile(files[i].string().c_str(), outPath.c_str(), params, false) != 0) failed++;
+		}
+	};
 
-	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
-	params.vLen = strtoul(token, nullptr, 10) & 0xFFu;
-	if(params.vLen > 8 || params.vLen < 1) return false;
+	if(numThreads == 0) numThreads = std::thread::hardware_concurrency();
+	numThreads = (numThreads == 0 ? 1 : numThreads);
+	std::vector<std::thread> threads;
+	for(unsigned t = 1; t < numThreads; t++) threads.emplace_back(worker);
+	worker();
+	for(auto &t : threads) t.join();
 
-	for(u8 i = 0; i < 48; i++)
-	{
-		if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) break;
-		params.vMatrix[i] = (s16)strtol(token, nullptr, 0) & ~15u; // Bits 0-3 are not used.
-	}
+	const std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+	printf("Scaled %zu images (%" PRIu32 " failed) in %.2f s with %u threads.\n",
+	       files.size() - failed, (u32)failed, secs.count(), numThreads);
 
-	return true;
+	return (failed != 0 ? 5 : 0);
 }
 
-// Compile with "g++ -std=c++17 -s -flto -O2 -fstrict-aliasing -ffunction-sections -Wall -Wextra -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler"
+// Compile with "g++ -std=c++17 -s -flto -O3 -fstrict-aliasing -ffunction-sections -Wall -Wextra -pthread -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyFbScaler.cpp -o ./lgyFbScaler"
+// Usage: lgyFbScaler in.png matrix.txt out.png
+//        lgyFbScaler -b inDir matrix.txt outDir [threads]
 int main(int argc, char const *argv[])
 {
-	unsigned char *inBuf;
-	u32 oWidth, oHight;
-	u32 lpngErr;
-	if((lpngErr = lodepng_decode32_file(&inBuf, &oWidth, &oHight, argv[1])))
+	const bool batch = argc > 1 && strcmp(argv[1], "-b") == 0;
+	const int argOffset = (batch ? 1 : 0);
+	if(argc < 4 + argOffset)
 	{
-		fprintf(stderr, "lodepng error: %s", lodepng_error_text(lpngErr));
-		return 1;
+		fputs("Usage: lgyFbScaler in.png matrix.txt out.png\n"
+		      "       lgyFbScaler -b inDir matrix.txt outDir [threads]\n", stderr);
+		return 3;
 	}
 
-	if(oWidth > 512 || oHight > 512)
-	{
-		fputs("Error: Input image too big.", stderr);
-		free(inBuf);
-		return 2;
-	}
-
-	std::unique_ptr<Pixel[]> outBuf(new(std::nothrow) Pixel[512 * 512]);
-	memcpy(outBuf.get(), inBuf, sizeof(Pixel) * oWidth * oHight);
-	free(inBuf);
-
-	static ScalerParams params = {(u16)oWidth, (u16)oHight};
-	if(!parseMatrix(argv[2], params))
+	static ScalerParams params = {};
+	if(!parseMatrix(argv[2 + argOffset], params))
 	{
 		fputs("Failed to parse matrix file.", stderr);
 		return 3;
 	}
 
-	const float scaleX = (float)params.hLen / __builtin_popcount(params.hPatt);
-	const float scaleY = (float)params.vLen / __builtin_popcount(params.vPatt);
-	params.width = oWidth * scaleX;
-	params.hight = oHight * scaleY;
-	printf("Output width: %" PRIu16 " (x%f)\nOutput hight: %" PRIu16 " (x%f)\n",
-	       params.width, scaleX, params.hight, scaleY);
-
-	scaleFrame(outBuf.get(), params);
+	if(batch)
+		return scaleDir(argv[2], argv[4], params, (argc > 5 ? strtoul(argv[5], nullptr, 10) : 0));
 
-	if((lpngErr = lodepng_encode32_file(argv[3], reinterpret_cast<const unsigned char*>(outBuf.get()), params.width, params.hight)))
-	{
-		fprintf(stderr, "lodepng error: %s", lodepng_error_text(lpngErr));
-		return 4;
-	}
-
-	return 0;
+	return scaleFile(argv[1], argv[3], params, true);
 }
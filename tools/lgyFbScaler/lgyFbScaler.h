@@ -0,0 +1,245 @@
+#pragma once
+
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// LgyCap scaler simulation shared by lgyFbScaler and lgyMatrixOpt.
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+
+typedef uint8_t  u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t  s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+
+typedef struct
+{
+	u16 oWidth;
+	u16 oHight;
+	u16 width;
+	u16 hight;
+	s16 vMatrix[8 * 6];
+	s16 hMatrix[8 * 6];
+	u8  vPatt;
+	u8  hPatt;
+	u8  vLen;
+	u8  hLen;
+} ScalerParams;
+
+struct Pixel final
+{
+	u8 m_r, m_g, m_b, m_a;
+};
+
+// One output pixel: 6 input taps (already clamped to the line) and their weights.
+struct Kernel final
+{
+	u16 idx[6];
+	s16 mult[6];
+	u8 pattPos; // Matrix column of mult.
+};
+
+// Frame split into one plane per channel so the passes vectorize over x.
+struct Planes final
+{
+	std::unique_ptr<u8[]> ch[3];
+	u16 width;
+	u16 hight;
+
+
+	Planes(u16 w, u16 h) : width(w), hight(h)
+	{
+		for(auto &c : ch) c.reset(new u8[(size_t)w * h]);
+	}
+};
+
+
+// Simulates the hardware window position and pattern for one line.
+// Returns the pattern position after the line. The horizontal scaler
+// does not reset it at line starts, the vertical one does.
+static inline u8 makeKernels(Kernel *const kernels, const u16 outLen, const u16 lineLen,
+                      const s16 *const matrix, const u8 patt, const u8 pattLen, u8 pattPos) noexcept
+{
+	s32 pos = 0;
+	for(u16 o = 0; o < outLen; o++)
+	{
+		Kernel &k = kernels[o];
+		k.pattPos = pattPos;
+		for(u8 i = 0; i < 6; i++)
+		{
+			const s32 p = pos - (5 - i);
+			if(p <= 0)             k.idx[i] = 0;           // Output first pixel for lower out of bounds.
+			else if(p >= lineLen)  k.idx[i] = lineLen - 1; // Output last pixel for upper out of bounds.
+			else                   k.idx[i] = p;           // Normal pixel window offset.
+			k.mult[i] = matrix[pattPos + i * 8];
+		}
+
+		if(patt & 1u<<pattPos++)
+		{
+			if(pos == 0) pos = 3; // Hardware loads 3 more pixels after the first.
+			else         pos++;
+		}
+		if(pattPos == pattLen) pattPos = 0;
+	}
+
+	return pattPos;
+}
+
+static inline u8 clampPixel(s32 v) noexcept
+{
+	// 1.14 fixed point. Clamped to 0-255.
+	v = (v > 0x3FC000 ? 0x3FC000 : v);
+	v = (v < 0 ? 0 : v);
+	return v>>14;
+}
+
+// Horizontal pass. tmp must be width x oHight.
+static inline void scaleHorizontal(const Pixel *const in, Planes &tmp, const ScalerParams &params)
+{
+	const u16 oWidth = params.oWidth;
+	const u16 oHight = params.oHight;
+	const u16 width = params.width;
+
+	// Only up to 8 distinct kernel rows exist (one per starting pattern position).
+	std::unique_ptr<Kernel[]> kernels(new Kernel[(size_t)params.hLen * width]);
+	u8 nextPos[8];
+	bool made[8] = {};
+	u8 pattPos = 0;
+	for(u16 h = 0; h < oHight; h++)
+	{
+		const Kernel *const k = &kernels[(size_t)pattPos * width];
+		if(!made[pattPos])
+		{
+			nextPos[pattPos] = makeKernels(&kernels[(size_t)pattPos * width], width, oWidth,
+			                               params.hMatrix, params.hPatt, params.hLen, pattPos);
+			made[pattPos] = true;
+		}
+
+		const Pixel *const line = &in[(size_t)oWidth * h];
+		u8 *const r = &tmp.ch[0][(size_t)width * h];
+		u8 *const g = &tmp.ch[1][(size_t)width * h];
+		u8 *const b = &tmp.ch[2][(size_t)width * h];
+		for(u16 w = 0; w < width; w++)
+		{
+			s32 sr = 0, sg = 0, sb = 0;
+			for(u8 i = 0; i < 6; i++)
+			{
+				const Pixel &p = line[k[w].idx[i]];
+				const s32 mult = k[w].mult[i];
+				sr += p.m_r * mult;
+				sg += p.m_g * mult;
+				sb += p.m_b * mult;
+			}
+			r[w] = clampPixel(sr);
+			g[w] = clampPixel(sg);
+			b[w] = clampPixel(sb);
+		}
+
+		pattPos = nextPos[pattPos];
+	}
+}
+
+// Vertical pass. out must be width x hight.
+static inline void scaleVertical(const Planes &tmp, Planes &out, const ScalerParams &params)
+{
+	const u16 oHight = params.oHight;
+	const u16 width = params.width;
+	const u16 hight = params.hight;
+
+	// Done row by row instead of per column so every tap is
+	// a contiguous input row and the inner loop runs over x without strides.
+	std::unique_ptr<Kernel[]> kernels(new Kernel[hight]);
+	makeKernels(kernels.get(), hight, oHight, params.vMatrix, params.vPatt, params.vLen, 0);
+	for(u16 h = 0; h < hight; h++)
+	{
+		const Kernel &k = kernels[h];
+		for(u8 c = 0; c < 3; c++)
+		{
+			const u8 *rows[6];
+			for(u8 i = 0; i < 6; i++) rows[i] = &tmp.ch[c][(size_t)width * k.idx[i]];
+			const s32 m0 = k.mult[0], m1 = k.mult[1], m2 = k.mult[2];
+			const s32 m3 = k.mult[3], m4 = k.mult[4], m5 = k.mult[5];
+
+			u8 *const o = &out.ch[c][(size_t)width * h];
+			for(u16 w = 0; w < width; w++)
+			{
+				const s32 sum = rows[0][w] * m0 + rows[1][w] * m1 + rows[2][w] * m2 +
+				                rows[3][w] * m3 + rows[4][w] * m4 + rows[5][w] * m5;
+				o[w] = clampPixel(sum);
+			}
+		}
+	}
+}
+
+static inline void scaleFrame(const Pixel *const in, Planes &out, const ScalerParams &params)
+{
+	Planes tmp(params.width, params.oHight);
+	scaleHorizontal(in, tmp, params);
+	scaleVertical(tmp, out, params);
+}
+
+// TODO: More validation.
+static inline bool parseMatrix(const char *const file, ScalerParams &params)
+{
+	char buf[1024] = {};
+	FILE *f = fopen(file, "r");
+	if(f == nullptr) return false;
+	fread(buf, 1023, 1, f);
+	fclose(f);
+
+	// Parse horizontal params.
+	const char *token;
+	if((token = strtok(buf, "\t ,\n\r")) == nullptr) return false;
+	params.hPatt = strtoul(token, nullptr, 2) & 0xFFu;
+
+	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
+	params.hLen = strtoul(token, nullptr, 10) & 0xFFu;
+	if(params.hLen > 8 || params.hLen < 1) return false;
+
+	for(u8 i = 0; i < 48; i++)
+	{
+		if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) break;
+		params.hMatrix[i] = (s16)strtol(token, nullptr, 0) & ~15u; // Bits 0-3 are not used.
+	}
+
+	// Parse vertical params.
+	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
+	params.vPatt = strtoul(token, nullptr, 2) & 0xFFu;
+
+	if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) return false;
+	params.vLen = strtoul(token, nullptr, 10) & 0xFFu;
+	if(params.vLen > 8 || params.vLen < 1) return false;
+
+	for(u8 i = 0; i < 48; i++)
+	{
+		if((token = strtok(nullptr, "\t ,\n\r")) == nullptr) break;
+		params.vMatrix[i] = (s16)strtol(token, nullptr, 0) & ~15u; // Bits 0-3 are not used.
+	}
+
+	return true;
+}
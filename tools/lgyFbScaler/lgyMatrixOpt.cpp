@@ -0,0 +1,539 @@
+/*
+ *   Copyright (C) 2022 profi200
+ *
+ *   This program is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <utility>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "lodepng.h"
+#include "lgyFbScaler.h"
+
+
+#define NDEBUG  (1)
+
+// open_agb_firm only loads the coefficients. The pattern is fixed in setupFrameCapture().
+#define FIRM_PATT  (0b00011011u)
+#define FIRM_LEN   (6u)
+
+
+struct Sample final
+{
+	std::unique_ptr<Pixel[]> in;
+	Planes ref;
+	Planes tmp; // Horizontal pass output for the current horizontal matrix.
+
+
+	Sample(u16 w, u16 h, u16 oHight) : ref(w, h), tmp(w, oHight) {}
+};
+
+class Optimizer final
+{
+	std::vector<std::unique_ptr<Sample>> m_samples;
+	std::vector<std::unique_ptr<Planes>> m_tmp; // Per thread.
+	std::vector<std::unique_ptr<Planes>> m_out; // Per thread.
+	ScalerParams m_params;
+	unsigned m_numThreads;
+	bool m_tmpValid;
+
+
+	static u64 sse(const Planes &a, const Planes &b) noexcept
+	{
+		const size_t num = (size_t)a.width * a.hight;
+		u64 sum = 0;
+		for(u8 c = 0; c < 3; c++)
+		{
+			const u8 *const pa = a.ch[c].get();
+			const u8 *const pb = b.ch[c].get();
+			for(size_t i = 0; i < num; i++)
+			{
+				const s32 d = (s32)pa[i] - pb[i];
+				sum += (u32)(d * d);
+			}
+		}
+
+		return sum;
+	}
+
+	// Runs func(sample, thread) for all samples.
+	template<typename F> void parallelFor(F func)
+	{
+		std::atomic<size_t> next{0};
+		auto worker = [&](unsigned t)
+		{
+			size_t i;
+			while((i = next++) < m_samples.size()) func(*m_samples[i], t);
+		};
+
+		std::vector<std::thread> threads;
+		for(unsigned t = 1; t < m_numThreads; t++) threads.emplace_back(worker, t);
+		worker(0);
+		for(auto &t : threads) t.join();
+	}
+
+	template<typename F> u64 parallelSum(F func)
+	{
+		std::atomic<u64> total{0};
+		parallelFor([&](Sample &s, unsigned t) { total += func(s, t); });
+
+		return total;
+	}
+
+	void updateTmp(void)
+	{
+		if(m_tmpValid) return;
+
+		parallelSum([&](Sample &s, unsigned) { scaleHorizontal(s.in.get(), s.tmp, m_params); return (u64)0; });
+		m_tmpValid = true;
+	}
+
+	// Only the vertical pass needs to run while tuning vertical taps.
+	u64 evalVertical(void)
+	{
+		updateTmp();
+		return parallelSum([&](Sample &s, unsigned t)
+		{
+			scaleVertical(s.tmp, *m_out[t], m_params);
+			return sse(*m_out[t], s.ref);
+		});
+	}
+
+	u64 evalFull(void)
+	{
+		return parallelSum([&](Sample &s, unsigned t)
+		{
+			scaleHorizontal(s.in.get(), *m_tmp[t], m_params);
+			scaleVertical(*m_tmp[t], *m_out[t], m_params);
+			return sse(*m_out[t], s.ref);
+		});
+	}
+
+	// Normal equations for the 6 taps of every used pattern position.
+	// Unknown u = pattPos * 6 + tap.
+	struct Normal final
+	{
+		u32 n;
+		double ata[48 * 48];
+		double atb[48];
+
+
+		explicit Normal(u32 num) : n(num), ata(), atb() {}
+
+		void add(const double *const f, const u8 *const idx, const u8 cnt, const double b) noexcept
+		{
+			for(u8 a = 0; a < cnt; a++)
+			{
+				atb[idx[a]] += f[a] * b;
+				for(u8 c = 0; c < cnt; c++) ata[idx[a] * n + idx[c]] += f[a] * f[c];
+			}
+		}
+
+		void merge(const Normal &o) noexcept
+		{
+			for(u32 i = 0; i < n * n; i++) ata[i] += o.ata[i];
+			for(u32 i = 0; i < n; i++) atb[i] += o.atb[i];
+		}
+
+		// Gaussian elimination with a little ridge for taps that never differ (edges).
+		void solve(double *const x) noexcept
+		{
+			double trace = 0;
+			for(u32 i = 0; i < n; i++) trace += ata[i * n + i];
+			for(u32 i = 0; i < n; i++) ata[i * n + i] += trace / n * 1e-9 + 1e-12;
+
+			for(u32 col = 0; col < n; col++)
+			{
+				u32 piv = col;
+				for(u32 r = col + 1; r < n; r++)
+					if(std::fabs(ata[r * n + col]) > std::fabs(ata[piv * n + col])) piv = r;
+				for(u32 c = 0; c < n; c++) std::swap(ata[col * n + c], ata[piv * n + c]);
+				std::swap(atb[col], atb[piv]);
+
+				for(u32 r = col + 1; r < n; r++)
+				{
+					const double m = ata[r * n + col] / ata[col * n + col];
+					for(u32 c = col; c < n; c++) ata[r * n + c] -= m * ata[col * n + c];
+					atb[r] -= m * atb[col];
+				}
+			}
+			for(u32 col = n; col-- > 0;)
+			{
+				double v = atb[col];
+				for(u32 c = col + 1; c < n; c++) v -= ata[col * n + c] * x[c];
+				x[col] = v / ata[col * n + col];
+			}
+		}
+	};
+
+	static s16 quantize(const double v) noexcept
+	{
+		// Bits 0-3 are not used.
+		double q = std::round(v / 16) * 16;
+		q = (q < -0x8000 ? -0x8000 : (q > 0x7FF0 ? 0x7FF0 : q));
+		return (s16)q;
+	}
+
+	void storeSolution(const Normal &merged, s16 *const matrix, const u8 len)
+	{
+		std::unique_ptr<Normal> sys(new Normal(merged));
+		double x[48];
+		sys->solve(x);
+		for(u8 p = 0; p < len; p++)
+			for(u8 i = 0; i < 6; i++) matrix[p + i * 8] = quantize(x[p * 6 + i]);
+	}
+
+	// Target sum in 1.14 fixed point. The middle of the output value.
+	static double target(const u8 ref) noexcept { return ref * 16384.0 + 8192; }
+
+	// With the horizontal pass fixed the output is linear in the vertical taps
+	// (before clamping). Solved exactly from the cached horizontal output.
+	void solveVertical(void)
+	{
+		updateTmp();
+		const u16 width = m_params.width;
+		const u16 hight = m_params.hight;
+		std::unique_ptr<Kernel[]> kv(new Kernel[hight]);
+		makeKernels(kv.get(), hight, m_params.oHight, m_params.vMatrix, m_params.vPatt, m_params.vLen, 0);
+
+		const u32 n = m_params.vLen * 6;
+		std::vector<std::unique_ptr<Normal>> normals;
+		for(unsigned t = 0; t < m_numThreads; t++) normals.emplace_back(new Normal(n));
+		parallelFor([&](Sample &s, unsigned t)
+		{
+			Normal &sys = *normals[t];
+			for(u16 h = 0; h < hight; h++)
+			{
+				const Kernel &k = kv[h];
+				u8 idx[6];
+				for(u8 i = 0; i < 6; i++) idx[i] = k.pattPos * 6 + i;
+				for(u8 c = 0; c < 3; c++)
+				{
+					for(u16 w = 0; w < width; w++)
+					{
+						double f[6];
+						for(u8 i = 0; i < 6; i++) f[i] = s.tmp.ch[c][(size_t)width * k.idx[i] + w];
+						sys.add(f, idx, 6, target(s.ref.ch[c][(size_t)width * h + w]));
+					}
+				}
+			}
+		});
+
+		for(unsigned t = 1; t < m_numThreads; t++) normals[0]->merge(*normals[t]);
+		storeSolution(*normals[0], m_params.vMatrix, m_params.vLen);
+	}
+
+	// With the vertical taps fixed the output is linear in the horizontal taps
+	// except for the rounding between the passes.
+	void solveHorizontal(void)
+	{
+		const u16 oWidth = m_params.oWidth;
+		const u16 oHight = m_params.oHight;
+		const u16 width = m_params.width;
+		const u16 hight = m_params.hight;
+		std::unique_ptr<Kernel[]> kv(new Kernel[hight]);
+		makeKernels(kv.get(), hight, oHight, m_params.vMatrix, m_params.vPatt, m_params.vLen, 0);
+
+		// The pattern position carries over between lines.
+		std::unique_ptr<Kernel[]> kh(new Kernel[(size_t)oHight * width]);
+		u8 pattPos = 0;
+		for(u16 h = 0; h < oHight; h++)
+			pattPos = makeKernels(&kh[(size_t)width * h], width, oWidth, m_params.hMatrix, m_params.hPatt, m_params.hLen, pattPos);
+
+		const u32 n = m_params.hLen * 6;
+		std::vector<std::unique_ptr<Normal>> normals;
+		for(unsigned t = 0; t < m_numThreads; t++) normals.emplace_back(new Normal(n));
+		parallelFor([&](Sample &s, unsigned t)
+		{
+			Normal &sys = *normals[t];
+			const Pixel *const in = s.in.get();
+			for(u16 h = 0; h < hight; h++)
+			{
+				const Kernel &k = kv[h];
+				for(u8 c = 0; c < 3; c++)
+				{
+					for(u16 w = 0; w < width; w++)
+					{
+						double dense[48] = {};
+						bool seen[48] = {}; // Contributions can be 0 so dense can't tell.
+						u8 idx[48];
+						u8 cnt = 0;
+						for(u8 i = 0; i < 6; i++)
+						{
+							const u16 row = k.idx[i];
+							const double v = k.mult[i] / 16384.0;
+							if(v == 0) continue;
+
+							const Kernel &kk = kh[(size_t)width * row + w];
+							const u8 *const line = reinterpret_cast<const u8*>(&in[(size_t)oWidth * row]);
+							for(u8 j = 0; j < 6; j++)
+							{
+								const u8 u = kk.pattPos * 6 + j;
+								if(!seen[u])
+								{
+									seen[u] = true;
+									idx[cnt++] = u;
+								}
+								dense[u] += v * line[kk.idx[j] * 4 + c];
+							}
+						}
+
+						double f[48];
+						for(u8 a = 0; a < cnt; a++) f[a] = dense[idx[a]];
+						sys.add(f, idx, cnt, target(s.ref.ch[c][(size_t)width * h + w]));
+					}
+				}
+			}
+		});
+
+		for(unsigned t = 1; t < m_numThreads; t++) normals[0]->merge(*normals[t]);
+		storeSolution(*normals[0], m_params.hMatrix, m_params.hLen);
+		m_tmpValid = false;
+	}
+
+	// Moves one coefficient by step in both directions for as long as the error goes down.
+	bool tune(s16 &coeff, const s32 step, const bool vertical, u64 &best)
+	{
+		bool improved = false;
+		for(s32 dir = -1; dir <= 1; dir += 2)
+		{
+			while(1)
+			{
+				const s32 old = coeff;
+				const s32 cand = old + dir * step;
+				if(cand < -0x8000 || cand > 0x7FF0) break;
+
+				coeff = cand;
+				if(!vertical) m_tmpValid = false;
+				const u64 err = (vertical ? evalVertical() : evalFull());
+				if(err < best)
+				{
+					best = err;
+					improved = true;
+					continue;
+				}
+
+				coeff = old;
+				break;
+			}
+		}
+		if(!vertical) m_tmpValid = false;
+
+		return improved;
+	}
+
+
+public:
+	Optimizer(const ScalerParams &params, unsigned numThreads) : m_params(params), m_numThreads(numThreads), m_tmpValid(false) {}
+
+	// Returns false if the reference has the wrong size or can't be read.
+	bool addSample(const char *const inPath, const char *const refPath)
+	{
+		unsigned char *inBuf, *refBuf;
+		u32 w, h, rw, rh;
+		if(lodepng_decode32_file(&inBuf, &w, &h, inPath)) return false;
+		if(lodepng_decode32_file(&refBuf, &rw, &rh, refPath))
+		{
+			free(inBuf);
+			return false;
+		}
+
+		// All frames must have the same size.
+		const float scaleX = (float)m_params.hLen / __builtin_popcount(m_params.hPatt);
+		const float scaleY = (float)m_params.vLen / __builtin_popcount(m_params.vPatt);
+		const bool first = m_samples.empty();
+		bool ok = (first ? w <= 512 && h <= 512 : w == m_params.oWidth && h == m_params.oHight);
+		if(ok && first)
+		{
+			m_params.oWidth = w;
+			m_params.oHight = h;
+			m_params.width  = w * scaleX;
+			m_params.hight  = h * scaleY;
+		}
+		ok &= rw == m_params.width && rh == m_params.hight;
+
+		if(ok)
+		{
+			std::unique_ptr<Sample> s(new Sample(rw, rh, h));
+			s->in.reset(new Pixel[(size_t)w * h]);
+			memcpy(s->in.get(), inBuf, sizeof(Pixel) * w * h);
+			for(size_t i = 0; i < (size_t)rw * rh; i++)
+			{
+				const Pixel &p = reinterpret_cast<const Pixel*>(refBuf)[i];
+				s->ref.ch[0][i] = p.m_r;
+				s->ref.ch[1][i] = p.m_g;
+				s->ref.ch[2][i] = p.m_b;
+			}
+			m_samples.push_back(std::move(s));
+		}
+		free(inBuf);
+		free(refBuf);
+
+		return ok;
+	}
+
+	size_t numSamples(void) const noexcept { return m_samples.size(); }
+	const ScalerParams& params(void) const noexcept { return m_params; }
+
+	double rmse(const u64 err) const noexcept
+	{
+		return std::sqrt((double)err / ((double)m_samples.size() * m_params.width * m_params.hight * 3));
+	}
+
+	// Alternating least squares for both passes, then coordinate descent on the
+	// simulated output to deal with clamping and rounding. Steps shrink down to 16.
+	void run(const u32 alsIters, const u32 maxRounds)
+	{
+		for(unsigned t = 0; t < m_numThreads; t++)
+		{
+			m_tmp.emplace_back(new Planes(m_params.width, m_params.oHight));
+			m_out.emplace_back(new Planes(m_params.width, m_params.hight));
+		}
+
+		u64 best = evalFull();
+		printf("Start:        RMSE %.4f\n", rmse(best));
+		for(u32 it = 0; it < alsIters; it++)
+		{
+			const ScalerParams old = m_params;
+			solveVertical();
+			solveHorizontal();
+			const u64 err = evalFull();
+			if(err >= best)
+			{
+				m_params = old;
+				m_tmpValid = false;
+				break;
+			}
+			best = err;
+			printf("LS pass %" PRIu32 ":    RMSE %.4f\n", it + 1, rmse(best));
+		}
+
+		for(s32 step = 0x100; step >= 0x10; step >>= 1)
+		{
+			for(u32 round = 0; round < maxRounds; round++)
+			{
+				bool improved = false;
+
+				// Only the taps of used pattern positions matter.
+				for(u8 i = 0; i < 6; i++)
+					for(u8 p = 0; p < m_params.vLen; p++)
+						improved |= tune(m_params.vMatrix[p + i * 8], step, true, best);
+				for(u8 i = 0; i < 6; i++)
+					for(u8 p = 0; p < m_params.hLen; p++)
+						improved |= tune(m_params.hMatrix[p + i * 8], step, false, best);
+
+				if(!improved) break;
+			}
+			printf("Step 0x%04" PRIX32 ":  RMSE %.4f\n", (u32)step, rmse(best));
+		}
+	}
+};
+
+
+static void printMatrix(const u8 patt, const u8 len, const s16 *const matrix, const bool last)
+{
+	char pattStr[9] = {};
+	for(u8 i = 0; i < 8; i++) pattStr[i] = (patt & 1u<<(7 - i) ? '1' : '0');
+	printf("%s, %u,\n", pattStr, len);
+	for(u8 i = 0; i < 6; i++)
+	{
+		for(u8 p = 0; p < 8; p++)
+		{
+			const s32 v = matrix[p + i * 8];
+			char num[12] = "0";
+			if(v != 0) snprintf(num, sizeof(num), "%s0x%X", (v < 0 ? "-" : ""), (unsigned)(v < 0 ? -v : v));
+			printf("%7s%s%s", num, (p < 7 || i < 5 || !last ? "," : ""), (p < 7 ? " " : ""));
+		}
+		puts("");
+	}
+}
+
+// Compile with "g++ -std=c++17 -s -flto -O3 -fstrict-aliasing -ffunction-sections -Wall -Wextra -pthread -I./lodepng -Wl,--gc-sections ./lodepng/lodepng.cpp ./lgyMatrixOpt.cpp -o ./lgyMatrixOpt"
+// Usage: lgyMatrixOpt inDir refDir start.txt gba_scaler_matrix.bin [threads] [rounds]
+// inDir holds unscaled frames and refDir the target images with the same file names.
+int main(int argc, char const *argv[])
+{
+	namespace fs = std::filesystem;
+
+	if(argc < 5)
+	{
+		fputs("Usage: lgyMatrixOpt inDir refDir start.txt gba_scaler_matrix.bin [threads] [rounds]\n", stderr);
+		return 1;
+	}
+
+	static ScalerParams params = {};
+	if(!parseMatrix(argv[3], params))
+	{
+		fputs("Failed to parse matrix file.\n", stderr);
+		return 2;
+	}
+	if(params.hPatt != FIRM_PATT || params.vPatt != FIRM_PATT || params.hLen != FIRM_LEN || params.vLen != FIRM_LEN)
+	{
+		fputs("Error: open_agb_firm always uses pattern 00011011 with length 6.\n", stderr);
+		return 2;
+	}
+
+	unsigned numThreads = (argc > 5 ? strtoul(argv[5], nullptr, 10) : 0);
+	if(numThreads == 0) numThreads = std::thread::hardware_concurrency();
+	numThreads = (numThreads == 0 ? 1 : numThreads);
+	const u32 maxRounds = (argc > 6 ? strtoul(argv[6], nullptr, 10) : 4);
+
+	Optimizer opt(params, numThreads);
+	std::error_code ec;
+	for(const auto &entry : fs::directory_iterator(argv[1], ec))
+	{
+		if(!entry.is_regular_file() || entry.path().extension() != ".png") continue;
+
+		const std::string refPath = (fs::path(argv[2]) / entry.path().filename()).string();
+		if(!opt.addSample(entry.path().string().c_str(), refPath.c_str()))
+			fprintf(stderr, "Skipping '%s'. Missing reference or wrong size.\n", entry.path().string().c_str());
+	}
+	if(ec || opt.numSamples() == 0)
+	{
+		fputs("No usable input frames.\n", stderr);
+		return 3;
+	}
+	printf("%zu frames, %u threads.\n", opt.numSamples(), numThreads);
+
+	opt.run(8, maxRounds);
+
+	// Vertical first. Same layout as the matrix in setupFrameCapture().
+	const ScalerParams &res = opt.params();
+	s16 matrix[12 * 8];
+	memcpy(matrix, res.vMatrix, sizeof(res.vMatrix));
+	memcpy(&matrix[6 * 8], res.hMatrix, sizeof(res.hMatrix));
+	FILE *const f = fopen(argv[4], "wb");
+	if(f == nullptr || fwrite(matrix, sizeof(matrix), 1, f) != 1)
+	{
+		if(f != nullptr) fclose(f);
+		fprintf(stderr, "Failed to write '%s'.\n", argv[4]);
+		return 4;
+	}
+	fclose(f);
+
+	// Same format as the input (horizontal first) so it can be previewed with lgyFbScaler.
+	puts("");
+	printMatrix(res.hPatt, res.hLen, res.hMatrix, false);
+	puts("");
+	printMatrix(res.vPatt, res.vLen, res.vMatrix, true);
+
+	return 0;
+}